@@ -114,6 +114,7 @@ DolphinPart::DolphinPart(QWidget* parentWidget, QObject* parent, const QVariantL
     // Watch for changes that should result in updates to the
     // status bar text.
     connect(m_view, &DolphinView::itemCountChanged, this, &DolphinPart::updateStatusBar);
+    connect(m_view, &DolphinView::statusBarTextChanged, this, &DolphinPart::updateStatusBar);
     connect(m_view,  &DolphinView::selectionChanged, this, &DolphinPart::updateStatusBar);
 
     m_actionHandler = new DolphinViewActionHandler(actionCollection(), this);
@@ -184,6 +184,8 @@ DolphinViewContainer::DolphinViewContainer(const QUrl& url, QWidget* parent) :
             this, &DolphinViewContainer::slotDirectoryLoadingCanceled);
     connect(m_view, &DolphinView::itemCountChanged,
             this, &DolphinViewContainer::delayedStatusBarUpdate);
+    connect(m_view, &DolphinView::statusBarTextChanged,
+            this, &DolphinViewContainer::delayedStatusBarUpdate);
     connect(m_view, &DolphinView::directoryLoadingProgress,
             this, &DolphinViewContainer::updateDirectoryLoadingProgress);
     connect(m_view, &DolphinView::directorySortingProgress,
@@ -165,10 +165,13 @@ QPixmap KFileItemListView::createDragPixmap(const KItemSet& indexes) const
     int x = 0;
     int y = 0;
 
+    Q_ASSERT(qobject_cast<KFileItemModel*>(model()));
+    const KFileItemModel* fileItemModel = static_cast<KFileItemModel*>(model());
+
     for (int index : indexes) {
-        QPixmap pixmap = model()->data(index).value("iconPixmap").value<QPixmap>();
+        QPixmap pixmap = fileItemModel->data(index, "iconPixmap").value<QPixmap>();
         if (pixmap.isNull()) {
-            QIcon icon = QIcon::fromTheme(model()->data(index).value("iconName").toString());
+            QIcon icon = QIcon::fromTheme(fileItemModel->data(index, "iconName").toString());
             pixmap = icon.pixmap(size, size);
         } else {
             KPixmapModifier::scale(pixmap, QSize(size, size) * dpr);
@@ -26,6 +26,7 @@
 #include "dolphindebug.h"
 #include "private/kfileitemmodeldirlister.h"
 #include "private/kfileitemmodelsortalgorithm.h"
+#include "private/kparallelchunks.h"
 
 #include <KLocalizedString>
 #include <KUrlMimeData>
@@ -44,18 +45,32 @@ KFileItemModel::KFileItemModel(QObject* parent) :
     KItemModelBase("text", parent),
     m_dirLister(nullptr),
     m_sortDirsFirst(true),
+    m_showHiddenFiles(false),
     m_sortRole(NameRole),
     m_sortingProgressPercent(-1),
     m_roles(),
     m_itemData(),
+    m_fileCount(0),
+    m_folderCount(0),
+    m_totalFileSize(0),
     m_items(),
+    m_keyboardSearchIndex(),
+    m_keyboardSearchPrefix(),
+    m_keyboardSearchMatches(),
+    m_validPositionsCount(0),
     m_filter(),
     m_filteredItems(),
     m_requestRole(),
     m_maximumUpdateIntervalTimer(nullptr),
     m_resortAllItemsTimer(nullptr),
+    m_groupsChangedTimer(nullptr),
+    m_itemsToResort(),
     m_pendingItemsToInsert(),
     m_groups(),
+    m_groupValuesDate(),
+    m_nameGroupValues(),
+    m_timeGroupValues(),
+    m_permissionGroupValues(),
     m_expandedDirs(),
     m_urlsToExpand()
 {
@@ -66,6 +81,9 @@ KFileItemModel::KFileItemModel(QObject* parent) :
     m_dirLister = new KFileItemModelDirLister(this);
     m_dirLister->setDelayedMimeTypes(true);
 
+    // Hidden files are filtered by the model, see setShowHiddenFiles().
+    m_dirLister->setShowingDotFiles(true);
+
     const QWidget* parentWidget = qobject_cast<QWidget*>(parent);
     if (parentWidget) {
         m_dirLister->setMainWindow(parentWidget->window());
@@ -108,7 +126,15 @@ KFileItemModel::KFileItemModel(QObject* parent) :
     m_resortAllItemsTimer = new QTimer(this);
     m_resortAllItemsTimer->setInterval(500);
     m_resortAllItemsTimer->setSingleShot(true);
-    connect(m_resortAllItemsTimer, &QTimer::timeout, this, &KFileItemModel::resortAllItems);
+    connect(m_resortAllItemsTimer, &QTimer::timeout, this, &KFileItemModel::resortChangedItems);
+
+    // If the groups are not known when the sort-role value of an item is changed, the
+    // groupsChanged() signal is postponed in the same way, as each emission requires
+    // to determine all groups again.
+    m_groupsChangedTimer = new QTimer(this);
+    m_groupsChangedTimer->setInterval(500);
+    m_groupsChangedTimer->setSingleShot(true);
+    connect(m_groupsChangedTimer, &QTimer::timeout, this, &KFileItemModel::groupsChanged);
 
     connect(GeneralSettings::self(), &GeneralSettings::sortingChoiceChanged, this, &KFileItemModel::slotSortingChoiceChanged);
 }
@@ -127,6 +153,8 @@ void KFileItemModel::loadDirectory(const QUrl &url)
 
 void KFileItemModel::refreshDirectory(const QUrl &url)
 {
+    emit directoryRefreshing();
+
     // Refresh all expanded directories first (Bug 295300)
     QHashIterator<QUrl, QUrl> expandedDirs(m_expandedDirs);
     while (expandedDirs.hasNext()) {
@@ -165,6 +193,32 @@ QHash<QByteArray, QVariant> KFileItemModel::data(int index) const
     return QHash<QByteArray, QVariant>();
 }
 
+QVariant KFileItemModel::data(int index, const QByteArray& role) const
+{
+    if (index >= 0 && index < count()) {
+        ItemData* data = m_itemData.at(index);
+        if (data->values.isEmpty()) {
+            data->values = retrieveData(data->item, data->parent);
+        }
+
+        return data->values.value(role);
+    }
+    return QVariant();
+}
+
+bool KFileItemModel::hasData(int index, const QByteArray& role) const
+{
+    if (index >= 0 && index < count()) {
+        ItemData* data = m_itemData.at(index);
+        if (data->values.isEmpty()) {
+            data->values = retrieveData(data->item, data->parent);
+        }
+
+        return data->values.contains(role);
+    }
+    return false;
+}
+
 bool KFileItemModel::setData(int index, const QHash<QByteArray, QVariant>& values)
 {
     if (index < 0 || index >= count()) {
@@ -193,10 +247,21 @@ bool KFileItemModel::setData(int index, const QHash<QByteArray, QVariant>& value
 
     m_itemData[index]->values = currentValues;
     if (changedRoles.contains("text")) {
-        QUrl url = m_itemData[index]->item.url();
-        url = url.adjusted(QUrl::RemoveFilename);
+        const QUrl oldUrl = m_itemData[index]->item.url();
+        QUrl url = oldUrl.adjusted(QUrl::RemoveFilename);
         url.setPath(url.path() + currentValues["text"].toString());
         m_itemData[index]->item.setUrl(url);
+        m_itemData[index]->textSortKey.reset();
+        m_itemData[index]->caseFoldedText.clear();
+
+        if (m_items.remove(oldUrl) > 0) {
+            m_items.insert(url, m_itemData.at(index));
+        }
+
+        if (!m_keyboardSearchIndex.isEmpty()) {
+            removeFromKeyboardSearchIndex(QSet<const ItemData*>() << m_itemData.at(index));
+            insertIntoKeyboardSearchIndex(QList<ItemData*>() << m_itemData.at(index));
+        }
     }
 
     emitItemsChangedAndTriggerResorting(KItemRangeList() << KItemRange(index, 1), changedRoles);
@@ -204,6 +269,21 @@ bool KFileItemModel::setData(int index, const QHash<QByteArray, QVariant>& value
     return true;
 }
 
+int KFileItemModel::fileCount() const
+{
+    return m_fileCount;
+}
+
+int KFileItemModel::folderCount() const
+{
+    return m_folderCount;
+}
+
+KIO::filesize_t KFileItemModel::totalFileSize() const
+{
+    return m_totalFileSize;
+}
+
 void KFileItemModel::setSortDirectoriesFirst(bool dirsFirst)
 {
     if (dirsFirst != m_sortDirsFirst) {
@@ -219,16 +299,32 @@ bool KFileItemModel::sortDirectoriesFirst() const
 
 void KFileItemModel::setShowHiddenFiles(bool show)
 {
-    m_dirLister->setShowingDotFiles(show);
-    m_dirLister->emitChanges();
+    if (m_showHiddenFiles == show) {
+        return;
+    }
+
+    dispatchPendingItemsToInsert();
+    m_showHiddenFiles = show;
+
     if (show) {
-        dispatchPendingItemsToInsert();
+        // The hidden items are still in m_filteredItems together with
+        // their resolved roles and only need to be merged into the model.
+        applyFilters(CheckFilteredItems);
+    } else {
+        // applyFilters() never hides expanded items, because child items
+        // may not exist without their parent. Collapse hidden folders first.
+        for (int index = 0; index < count(); ++index) {
+            if (isExpanded(index) && m_itemData.at(index)->item.isHidden()) {
+                setExpanded(index, false);
+            }
+        }
+        applyFilters(CheckShownItems);
     }
 }
 
 bool KFileItemModel::showHiddenFiles() const
 {
-    return m_dirLister->showingDotFiles();
+    return m_showHiddenFiles;
 }
 
 void KFileItemModel::setShowDirectoriesOnly(bool enabled)
@@ -281,18 +377,38 @@ QMimeData* KFileItemModel::createMimeData(const KItemSet& indexes) const
 
 int KFileItemModel::indexForKeyboardSearch(const QString& text, int startFromIndex) const
 {
+    if (m_keyboardSearchIndex.isEmpty() && !m_itemData.isEmpty()) {
+        // m_keyboardSearchIndex is built when it is needed for the first time.
+        // Afterwards, it is kept up to date when items are inserted, removed or renamed.
+        m_keyboardSearchIndex.reserve(m_itemData.count());
+        insertIntoKeyboardSearchIndex(m_itemData);
+    }
+
     startFromIndex = qMax(0, startFromIndex);
-    for (int i = startFromIndex; i < count(); ++i) {
-        if (fileItem(i).text().startsWith(text, Qt::CaseInsensitive)) {
-            return i;
+    const QString foldedText = text.toCaseFolded();
+
+    if (m_keyboardSearchMatches.isEmpty() || foldedText != m_keyboardSearchPrefix) {
+        // All items which start with the text are adjacent in m_keyboardSearchIndex.
+        // Their indexes are sorted once, such that cycling through the matches by
+        // typing the same text again only requires a binary search.
+        m_keyboardSearchMatches.clear();
+        auto it = std::lower_bound(m_keyboardSearchIndex.constBegin(), m_keyboardSearchIndex.constEnd(), foldedText,
+                                   [](const KeyboardSearchEntry& entry, const QString& prefix) { return entry.first < prefix; });
+        for (; it != m_keyboardSearchIndex.constEnd() && it->first.startsWith(foldedText); ++it) {
+            m_keyboardSearchMatches.append(indexForItemData(it->second));
         }
+        std::sort(m_keyboardSearchMatches.begin(), m_keyboardSearchMatches.end());
+        m_keyboardSearchPrefix = foldedText;
     }
-    for (int i = 0; i < startFromIndex; ++i) {
-        if (fileItem(i).text().startsWith(text, Qt::CaseInsensitive)) {
-            return i;
-        }
+
+    if (m_keyboardSearchMatches.isEmpty()) {
+        return -1;
     }
-    return -1;
+
+    // Return the first match at or behind startFromIndex, or wrap around and
+    // return the first match in the model.
+    const auto next = std::lower_bound(m_keyboardSearchMatches.constBegin(), m_keyboardSearchMatches.constEnd(), startFromIndex);
+    return next != m_keyboardSearchMatches.constEnd() ? *next : m_keyboardSearchMatches.first();
 }
 
 bool KFileItemModel::supportsDropping(int index) const
@@ -320,37 +436,33 @@ QString KFileItemModel::roleDescription(const QByteArray& role) const
 
 QList<QPair<int, QVariant> > KFileItemModel::groups() const
 {
+    // The groups of the time roles depend on the current date.
+    const QDate currentDate = QDate::currentDate();
+    if (m_groupValuesDate != currentDate) {
+        resetGroups();
+        m_groupValuesDate = currentDate;
+    }
+
     if (!m_itemData.isEmpty() && m_groups.isEmpty()) {
 #ifdef KFILEITEMMODEL_DEBUG
         QElapsedTimer timer;
         timer.start();
 #endif
-        switch (typeForRole(sortRole())) {
-        case NameRole:        m_groups = nameRoleGroups(); break;
-        case SizeRole:        m_groups = sizeRoleGroups(); break;
-        case ModificationTimeRole:
-            m_groups = timeRoleGroups([](const ItemData *item) {
-                return item->item.time(KFileItem::ModificationTime);
-            });
-            break;
-        case CreationTimeRole:
-            m_groups = timeRoleGroups([](const ItemData *item) {
-                return item->item.time(KFileItem::CreationTime);
-            });
-            break;
-        case AccessTimeRole:
-            m_groups = timeRoleGroups([](const ItemData *item) {
-                return item->item.time(KFileItem::AccessTime);
-            });
-            break;
-        case DeletionTimeRole:
-            m_groups = timeRoleGroups([](const ItemData *item) {
-                return item->values.value("deletiontime").toDateTime();
-            });
-            break;
-        case PermissionsRole: m_groups = permissionRoleGroups(); break;
-        case RatingRole:      m_groups = ratingRoleGroups(); break;
-        default:              m_groups = genericStringRoleGroups(sortRole()); break;
+        // Child items are not grouped, see KFileItemModel::isChildItem().
+        QVariant previousValue;
+        bool isFirstGroup = true;
+        const int maxIndex = count() - 1;
+        for (int i = 0; i <= maxIndex; ++i) {
+            if (isChildItem(i)) {
+                continue;
+            }
+
+            const QVariant value = groupValue(m_itemData.at(i));
+            if (isFirstGroup || value != previousValue) {
+                m_groups.append(QPair<int, QVariant>(i, value));
+                previousValue = value;
+                isFirstGroup = false;
+            }
         }
 
 #ifdef KFILEITEMMODEL_DEBUG
@@ -388,30 +500,18 @@ int KFileItemModel::index(const QUrl& url) const
 {
     const QUrl urlToFind = url.adjusted(QUrl::StripTrailingSlash);
 
-    const int itemCount = m_itemData.count();
-    int itemsInHash = m_items.count();
-
-    int index = m_items.value(urlToFind, -1);
-    while (index < 0 && itemsInHash < itemCount) {
-        // Not all URLs are stored yet in m_items. We grow m_items until either
-        // urlToFind is found, or all URLs have been stored in m_items.
-        // Note that we do not add the URLs to m_items one by one, but in
-        // larger blocks. After each block, we check if urlToFind is in
-        // m_items. We could in principle compare urlToFind with each URL while
-        // we are going through m_itemData, but comparing two QUrls will,
-        // unlike calling qHash for the URLs, trigger a parsing of the URLs
-        // which costs both CPU cycles and memory.
-        const int blockSize = 1000;
-        const int currentBlockEnd = qMin(itemsInHash + blockSize, itemCount);
-        for (int i = itemsInHash; i < currentBlockEnd; ++i) {
-            const QUrl nextUrl = m_itemData.at(i)->item.url();
-            m_items.insert(nextUrl, i);
+    if (m_items.isEmpty() && !m_itemData.isEmpty()) {
+        // m_items is populated when it is needed for the first time. Afterwards,
+        // it is kept up to date when items are inserted, removed or renamed.
+        m_items.reserve(m_itemData.count());
+        foreach (ItemData* itemData, m_itemData) {
+            m_items.insert(itemData->item.url(), itemData);
         }
-
-        itemsInHash = currentBlockEnd;
-        index = m_items.value(urlToFind, -1);
     }
 
+    ItemData* itemData = m_items.value(urlToFind);
+    const int index = itemData ? indexForItemData(itemData) : -1;
+
     if (index < 0) {
         // The item could not be found, even though all items from m_itemData
         // should be in m_items now. We print some diagnostic information which
@@ -483,7 +583,7 @@ void KFileItemModel::setRoles(const QSet<QByteArray>& roles)
         }
     }
 
-    m_groups.clear();
+    resetGroups();
     resetRoles();
 
     QSetIterator<QByteArray> it(roles);
@@ -598,7 +698,7 @@ bool KFileItemModel::isExpandable(int index) const
     if (index >= 0 && index < count()) {
         // Call data (instead of accessing m_itemData directly)
         // to ensure that the value is initialized.
-        return data(index).value("isExpandable").toBool();
+        return data(index, "isExpandable").toBool();
     }
     return false;
 }
@@ -664,10 +764,25 @@ void KFileItemModel::expandParentDirectories(const QUrl &url)
 
 void KFileItemModel::setNameFilter(const QString& nameFilter)
 {
-    if (m_filter.pattern() != nameFilter) {
+    const QString oldNameFilter = m_filter.pattern();
+    if (oldNameFilter != nameFilter) {
         dispatchPendingItemsToInsert();
         m_filter.setPattern(nameFilter);
-        applyFilters();
+
+        // While typing in the filter bar, the new pattern usually extends the
+        // old one or is a prefix of it. Then only a part of the items can change
+        // from shown to filtered or vice versa, and only this part is checked.
+        const bool shownItemsStayShown = KFileItemModelFilter::patternImplies(oldNameFilter, nameFilter);
+        const bool filteredItemsStayFiltered = KFileItemModelFilter::patternImplies(nameFilter, oldNameFilter);
+        if (shownItemsStayShown && filteredItemsStayFiltered) {
+            return;
+        } else if (shownItemsStayShown) {
+            applyFilters(CheckFilteredItems);
+        } else if (filteredItemsStayFiltered) {
+            applyFilters(CheckShownItems);
+        } else {
+            applyFilters(CheckAllItems);
+        }
     }
 }
 
@@ -691,45 +806,109 @@ QStringList KFileItemModel::mimeTypeFilters() const
 }
 
 
-void KFileItemModel::applyFilters()
+void KFileItemModel::applyFilters(ApplyFiltersBehavior behavior)
 {
-    // Check which shown items from m_itemData must get
-    // hidden and hence moved to m_filteredItems.
-    QVector<int> newFilteredIndexes;
+    // The items which are hidden in this call need not be checked again below.
+    const QList<ItemData*> filteredItems = (behavior == CheckShownItems) ? QList<ItemData*>() : m_filteredItems.values();
 
-    const int itemCount = m_itemData.count();
-    for (int index = 0; index < itemCount; ++index) {
-        ItemData* itemData = m_itemData.at(index);
-
-        // Only filter non-expanded items as child items may never
-        // exist without a parent item
-        if (!itemData->values.value("isExpanded").toBool()) {
-            const KFileItem item = itemData->item;
-            if (!m_filter.matches(item)) {
+    if (behavior != CheckFilteredItems) {
+        // Check which shown items from m_itemData must get
+        // hidden and hence moved to m_filteredItems.
+        QVector<int> newFilteredIndexes;
+
+        const QVector<bool> matches = matchesFilter(m_itemData);
+        const int itemCount = m_itemData.count();
+        for (int index = 0; index < itemCount; ++index) {
+            ItemData* itemData = m_itemData.at(index);
+
+            // Only filter non-expanded items as child items may never
+            // exist without a parent item
+            if (!matches.at(index) && !itemData->values.value("isExpanded").toBool()) {
+                // Remember the position, such that the items can be shown
+                // again without sorting them, see below.
+                itemData->filteredPosition = index;
                 newFilteredIndexes.append(index);
-                m_filteredItems.insert(item, itemData);
+                m_filteredItems.insert(itemData->item, itemData);
             }
         }
+
+        const KItemRangeList removedRanges = KItemRangeList::fromSortedContainer(newFilteredIndexes);
+        removeItems(removedRanges, KeepItemData);
     }
 
-    const KItemRangeList removedRanges = KItemRangeList::fromSortedContainer(newFilteredIndexes);
-    removeItems(removedRanges, KeepItemData);
+    if (behavior != CheckShownItems) {
+        // Check which hidden items from m_filteredItems should
+        // get visible again and hence removed from m_filteredItems.
+        QList<ItemData*> newVisibleItems;
 
-    // Check which hidden items from m_filteredItems should
-    // get visible again and hence removed from m_filteredItems.
-    QList<ItemData*> newVisibleItems;
+        const QVector<bool> matches = matchesFilter(filteredItems);
+        for (int i = 0; i < filteredItems.count(); ++i) {
+            if (matches.at(i)) {
+                ItemData* itemData = filteredItems.at(i);
+                newVisibleItems.append(itemData);
+                m_filteredItems.remove(itemData->item);
+            }
+        }
 
-    QHash<KFileItem, ItemData*>::iterator it = m_filteredItems.begin();
-    while (it != m_filteredItems.end()) {
-        if (m_filter.matches(it.key())) {
-            newVisibleItems.append(it.value());
-            it = m_filteredItems.erase(it);
-        } else {
-            ++it;
+        // If the items have been hidden at the same time and the sorting has not
+        // changed since then, ordering them by their old positions sorts them,
+        // and insertItems() can merge them into m_itemData without sorting.
+        std::sort(newVisibleItems.begin(), newVisibleItems.end(), [](const ItemData* a, const ItemData* b) {
+            return a->filteredPosition < b->filteredPosition;
+        });
+
+        insertItems(newVisibleItems);
+    }
+}
+
+QVector<bool> KFileItemModel::matchesFilter(const QList<ItemData*>& items) const
+{
+    const int count = items.count();
+    QVector<bool> matches(count, true);
+    if (!m_filter.hasSetFilters() && m_showHiddenFiles) {
+        return matches;
+    }
+
+    // Matching the names with the pattern is reentrant, so it can be done in
+    // parallel. The MIME types are checked afterwards in the main thread,
+    // because checking them might determine the MIME type of the KFileItem.
+    if (!m_filter.pattern().isEmpty()) {
+        bool* matchesData = matches.data();
+        auto match = [this, &items, matchesData](int first, int last) {
+            for (int index = first; index <= last; ++index) {
+                ItemData* itemData = items.at(index);
+                matchesData[index] = m_filter.matchesPattern(itemData->item, caseFoldedText(itemData));
+            }
+        };
+
+        processInChunks(count, match);
+    }
+
+    if (!m_filter.mimeTypes().isEmpty()) {
+        for (int index = 0; index < count; ++index) {
+            if (matches.at(index) && !m_filter.matchesType(items.at(index)->item)) {
+                matches[index] = false;
+            }
+        }
+    }
+
+    if (!m_showHiddenFiles) {
+        for (int index = 0; index < count; ++index) {
+            if (matches.at(index) && items.at(index)->item.isHidden()) {
+                matches[index] = false;
+            }
         }
     }
 
-    insertItems(newVisibleItems);
+    return matches;
+}
+
+const QString& KFileItemModel::caseFoldedText(ItemData* itemData)
+{
+    if (itemData->caseFoldedText.isNull()) {
+        itemData->caseFoldedText = itemData->item.text().toCaseFolded();
+    }
+    return itemData->caseFoldedText;
 }
 
 void KFileItemModel::removeFilteredChildren(const KItemRangeList& itemRanges)
@@ -797,6 +976,20 @@ void KFileItemModel::onSortRoleChanged(const QByteArray& current, const QByteArr
 {
     Q_UNUSED(previous)
     m_sortRole = typeForRole(current);
+    resetGroups();
+
+    if (m_sortRole == ModificationTimeRole || m_sortRole == CreationTimeRole || m_sortRole == AccessTimeRole) {
+        // ItemData::sortTime only contains the time for the previous sort role
+        foreach (ItemData* itemData, m_itemData) {
+            itemData->sortTime = sortTime(itemData->item);
+        }
+        foreach (ItemData* itemData, m_filteredItems) {
+            itemData->sortTime = sortTime(itemData->item);
+        }
+        foreach (ItemData* itemData, m_pendingItemsToInsert) {
+            itemData->sortTime = sortTime(itemData->item);
+        }
+    }
 
     if (!m_requestRole[m_sortRole]) {
         QSet<QByteArray> newRoles = m_roles;
@@ -838,11 +1031,20 @@ void KFileItemModel::loadSortingSettings()
     // Workaround for bug https://bugreports.qt.io/browse/QTBUG-69361
     // Force the clean state of QCollator in single thread to avoid thread safety problems in sort
     m_collator.compare(QString(), QString());
+
+    // The sort keys depend on the settings of the collator.
+    resetSortKeys();
 }
 
 void KFileItemModel::resortAllItems()
 {
     m_resortAllItemsTimer->stop();
+    m_groupsChangedTimer->stop();
+    if (!m_itemsToResort.isEmpty()) {
+        // The groups of the changed items are not known anymore after resorting.
+        m_groups.clear();
+        m_itemsToResort.clear();
+    }
 
     const int itemCount = count();
     if (itemCount <= 0) {
@@ -856,52 +1058,139 @@ void KFileItemModel::resortAllItems()
     qCDebug(DolphinDebug) << "Resorting" << itemCount << "items";
 #endif
 
-    // Remember the order of the current URLs so
-    // that it can be determined which indexes have
-    // been moved because of the resorting.
-    QList<QUrl> oldUrls;
-    oldUrls.reserve(itemCount);
-    foreach (const ItemData* itemData, m_itemData) {
-        oldUrls.append(itemData->item.url());
-    }
-
-    m_items.clear();
-    m_items.reserve(itemCount);
+    // Remember the current order so that it can be determined
+    // which indexes have been moved because of the resorting.
+    const QList<ItemData*> oldItemData = m_itemData;
 
     // Resort the items
     sort(m_itemData.begin(), m_itemData.end());
-    for (int i = 0; i < itemCount; ++i) {
-        m_items.insert(m_itemData.at(i)->item.url(), i);
+
+    emitItemsMovedAfterResorting(oldItemData);
+
+#ifdef KFILEITEMMODEL_DEBUG
+    qCDebug(DolphinDebug) << "[TIME] Resorting of" << itemCount << "items:" << timer.elapsed();
+#endif
+}
+
+void KFileItemModel::resortChangedItems()
+{
+    m_resortAllItemsTimer->stop();
+
+    const int itemCount = count();
+    if (itemCount <= 0) {
+        m_itemsToResort.clear();
+        return;
+    }
+
+    if (m_itemsToResort.count() > itemCount / 4) {
+        // Sorting everything is cheaper than re-inserting many items one by one.
+        resortAllItems();
+        return;
+    }
+
+#ifdef KFILEITEMMODEL_DEBUG
+    QElapsedTimer timer;
+    timer.start();
+    qCDebug(DolphinDebug) << "===========================================================";
+    qCDebug(DolphinDebug) << "Resorting" << m_itemsToResort.count() << "of" << itemCount << "items";
+#endif
+
+    const QList<ItemData*> oldItemData = m_itemData;
+
+    // Take the changed items out of the list. The remaining items are
+    // still sorted, so the changed items can be re-inserted with a binary search.
+    QList<ItemData*> changedItems;
+    changedItems.reserve(m_itemsToResort.count());
+    QList<ItemData*> sortedItems;
+    sortedItems.reserve(itemCount);
+    foreach (ItemData* itemData, m_itemData) {
+        if (m_itemsToResort.contains(itemData)) {
+            changedItems.append(itemData);
+        } else {
+            sortedItems.append(itemData);
+        }
+    }
+    m_itemsToResort.clear();
+
+    sort(changedItems.begin(), changedItems.end());
+
+    auto lessThanFunction = [this](const ItemData* a, const ItemData* b) {
+        return lessThan(a, b, m_collator);
+    };
+
+    m_itemData.clear();
+    m_itemData.reserve(itemCount);
+    QVector<int> changedIndexes;
+    changedIndexes.reserve(changedItems.count());
+    QList<ItemData*>::const_iterator sortedIt = sortedItems.constBegin();
+    foreach (ItemData* changedItem, changedItems) {
+        const QList<ItemData*>::const_iterator insertPos =
+            std::upper_bound(sortedIt, sortedItems.constEnd(), changedItem, lessThanFunction);
+        while (sortedIt != insertPos) {
+            m_itemData.append(*sortedIt);
+            ++sortedIt;
+        }
+        changedIndexes.append(m_itemData.count());
+        m_itemData.append(changedItem);
+    }
+    while (sortedIt != sortedItems.constEnd()) {
+        m_itemData.append(*sortedIt);
+        ++sortedIt;
+    }
+
+    // The groups of the changed items might have changed even if
+    // they are still at their previous positions.
+    foreach (int index, changedIndexes) {
+        updateGroups(index, index + 1);
     }
 
+    emitItemsMovedAfterResorting(oldItemData);
+
+#ifdef KFILEITEMMODEL_DEBUG
+    qCDebug(DolphinDebug) << "[TIME] Resorting of" << changedItems.count() << "items:" << timer.elapsed();
+#endif
+}
+
+void KFileItemModel::emitItemsMovedAfterResorting(const QList<ItemData*>& oldItemData)
+{
+    const int itemCount = m_itemData.count();
+    Q_ASSERT(oldItemData.count() == itemCount);
+
     // Determine the first index that has been moved.
     int firstMovedIndex = 0;
     while (firstMovedIndex < itemCount
-           && firstMovedIndex == m_items.value(oldUrls.at(firstMovedIndex))) {
+           && oldItemData.at(firstMovedIndex) == m_itemData.at(firstMovedIndex)) {
         ++firstMovedIndex;
     }
 
     const bool itemsHaveMoved = firstMovedIndex < itemCount;
     if (itemsHaveMoved) {
-        m_groups.clear();
-
         int lastMovedIndex = itemCount - 1;
         while (lastMovedIndex > firstMovedIndex
-               && lastMovedIndex == m_items.value(oldUrls.at(lastMovedIndex))) {
+               && oldItemData.at(lastMovedIndex) == m_itemData.at(lastMovedIndex)) {
             --lastMovedIndex;
         }
 
         Q_ASSERT(firstMovedIndex <= lastMovedIndex);
 
+        // Only the items between firstMovedIndex and lastMovedIndex have been
+        // permuted. Store their new positions in the ItemData.
+        const int movedItemsCount = lastMovedIndex - firstMovedIndex + 1;
+        for (int i = firstMovedIndex; i <= lastMovedIndex; ++i) {
+            m_itemData.at(i)->position = i;
+        }
+        m_keyboardSearchMatches.clear();
+
+        // The groups outside of the moved range and its successor are unchanged.
+        updateGroups(firstMovedIndex, lastMovedIndex + 1);
+
         // Create a list movedToIndexes, which has the property that
         // movedToIndexes[i] is the new index of the item with the old index
         // firstMovedIndex + i.
-        const int movedItemsCount = lastMovedIndex - firstMovedIndex + 1;
         QList<int> movedToIndexes;
         movedToIndexes.reserve(movedItemsCount);
         for (int i = firstMovedIndex; i <= lastMovedIndex; ++i) {
-            const int newIndex = m_items.value(oldUrls.at(i));
-            movedToIndexes.append(newIndex);
+            movedToIndexes.append(oldItemData.at(i)->position);
         }
 
         emit itemsMoved(KItemRange(firstMovedIndex, movedItemsCount), movedToIndexes);
@@ -909,14 +1198,9 @@ void KFileItemModel::resortAllItems()
         // The groups might have changed even if the order of the items has not.
         const QList<QPair<int, QVariant> > oldGroups = m_groups;
         m_groups.clear();
-        if (groups() != oldGroups) {
-            emit groupsChanged();
-        }
+        groups();
+        emitGroupsChanged(oldGroups);
     }
-
-#ifdef KFILEITEMMODEL_DEBUG
-    qCDebug(DolphinDebug) << "[TIME] Resorting of" << itemCount << "items:" << timer.elapsed();
-#endif
 }
 
 void KFileItemModel::slotCompleted()
@@ -997,14 +1281,16 @@ void KFileItemModel::slotItemsAdded(const QUrl &directoryUrl, const KFileItemLis
 
     QList<ItemData*> itemDataList = createItemDataList(parentUrl, items);
 
-    if (!m_filter.hasSetFilters()) {
+    if (!m_filter.hasSetFilters() && m_showHiddenFiles) {
         m_pendingItemsToInsert.append(itemDataList);
     } else {
-        // The name or type filter is active. Hide filtered items
-        // before inserting them into the model and remember
-        // the filtered items in m_filteredItems.
-        foreach (ItemData* itemData, itemDataList) {
-            if (m_filter.matches(itemData->item)) {
+        // The name or type filter is active, or hidden files are not
+        // shown. Hide filtered items before inserting them into the
+        // model and remember the filtered items in m_filteredItems.
+        const QVector<bool> matches = matchesFilter(itemDataList);
+        for (int i = 0; i < itemDataList.count(); ++i) {
+            ItemData* itemData = itemDataList.at(i);
+            if (matches.at(i)) {
                 m_pendingItemsToInsert.append(itemData);
             } else {
                 m_filteredItems.insert(itemData->item, itemData);
@@ -1080,14 +1366,29 @@ void KFileItemModel::slotRefreshItems(const QList<QPair<KFileItem, KFileItem> >&
 
     QSet<QByteArray> changedRoles;
 
+    // Items whose text has changed must be moved in m_keyboardSearchIndex.
+    QList<ItemData*> renamedItems;
+
+    // True if an item has been renamed to or from a hidden file name.
+    bool hiddenStateChanged = false;
+
     QListIterator<QPair<KFileItem, KFileItem> > it(items);
     while (it.hasNext()) {
         const QPair<KFileItem, KFileItem>& itemPair = it.next();
         const KFileItem& oldItem = itemPair.first;
         const KFileItem& newItem = itemPair.second;
+        if (oldItem.isHidden() != newItem.isHidden()) {
+            hiddenStateChanged = true;
+        }
+
         const int indexForItem = index(oldItem);
         if (indexForItem >= 0) {
+            updateItemCounters(m_itemData.at(indexForItem), false);
             m_itemData[indexForItem]->item = newItem;
+            m_itemData[indexForItem]->textSortKey.reset();
+            m_itemData[indexForItem]->caseFoldedText.clear();
+            updateTypedValues(m_itemData[indexForItem]);
+            updateItemCounters(m_itemData.at(indexForItem), true);
 
             // Keep old values as long as possible if they could not retrieved synchronously yet.
             // The update of the values will be done asynchronously by KFileItemModelRolesUpdater.
@@ -1102,8 +1403,13 @@ void KFileItemModel::slotRefreshItems(const QList<QPair<KFileItem, KFileItem> >&
                 }
             }
 
-            m_items.remove(oldItem.url());
-            m_items.insert(newItem.url(), indexForItem);
+            if (oldItem.url() != newItem.url()) {
+                m_items.remove(oldItem.url());
+                m_items.insert(newItem.url(), m_itemData.at(indexForItem));
+            }
+            if (oldItem.text() != newItem.text()) {
+                renamedItems.append(m_itemData.at(indexForItem));
+            }
             indexes.append(indexForItem);
         } else {
             // Check if 'oldItem' is one of the filtered items.
@@ -1111,6 +1417,9 @@ void KFileItemModel::slotRefreshItems(const QList<QPair<KFileItem, KFileItem> >&
             if (it != m_filteredItems.end()) {
                 ItemData* itemData = it.value();
                 itemData->item = newItem;
+                itemData->textSortKey.reset();
+                itemData->caseFoldedText.clear();
+                updateTypedValues(itemData);
 
                 // The data stored in 'values' might have changed. Therefore, we clear
                 // 'values' and re-populate it the next time it is requested via data(int).
@@ -1122,16 +1431,29 @@ void KFileItemModel::slotRefreshItems(const QList<QPair<KFileItem, KFileItem> >&
         }
     }
 
-    // If the changed items have been created recently, they might not be in m_items yet.
+    if (!renamedItems.isEmpty() && !m_keyboardSearchIndex.isEmpty()) {
+        QSet<const ItemData*> renamedItemsSet;
+        foreach (const ItemData* itemData, renamedItems) {
+            renamedItemsSet.insert(itemData);
+        }
+        removeFromKeyboardSearchIndex(renamedItemsSet);
+        insertIntoKeyboardSearchIndex(renamedItems);
+    }
+
+    // If the changed items have been created recently, they might not be in the model yet.
     // In that case, the list 'indexes' might be empty.
-    if (indexes.isEmpty()) {
-        return;
+    if (!indexes.isEmpty()) {
+        // Extract the item-ranges out of the changed indexes
+        std::sort(indexes.begin(), indexes.end());
+        const KItemRangeList itemRangeList = KItemRangeList::fromSortedContainer(indexes);
+        emitItemsChangedAndTriggerResorting(itemRangeList, changedRoles);
     }
 
-    // Extract the item-ranges out of the changed indexes
-    std::sort(indexes.begin(), indexes.end());
-    const KItemRangeList itemRangeList = KItemRangeList::fromSortedContainer(indexes);
-    emitItemsChangedAndTriggerResorting(itemRangeList, changedRoles);
+    if (hiddenStateChanged && !m_showHiddenFiles) {
+        // The dir lister always lists hidden files, so items that became
+        // hidden or visible must be moved from or to m_filteredItems here.
+        applyFilters(CheckAllItems);
+    }
 }
 
 void KFileItemModel::slotClear()
@@ -1146,6 +1468,8 @@ void KFileItemModel::slotClear()
 
     m_maximumUpdateIntervalTimer->stop();
     m_resortAllItemsTimer->stop();
+    m_groupsChangedTimer->stop();
+    m_itemsToResort.clear();
 
     qDeleteAll(m_pendingItemsToInsert);
     m_pendingItemsToInsert.clear();
@@ -1155,6 +1479,12 @@ void KFileItemModel::slotClear()
         qDeleteAll(m_itemData);
         m_itemData.clear();
         m_items.clear();
+        m_keyboardSearchIndex.clear();
+        m_keyboardSearchMatches.clear();
+        m_validPositionsCount = 0;
+        m_fileCount = 0;
+        m_folderCount = 0;
+        m_totalFileSize = 0;
         emit itemsRemoved(KItemRangeList() << KItemRange(0, removedCount));
     }
 
@@ -1164,6 +1494,8 @@ void KFileItemModel::slotClear()
 void KFileItemModel::slotSortingChoiceChanged()
 {
     loadSortingSettings();
+    // The name groups depend on the collator.
+    resetGroups();
     resortAllItems();
 }
 
@@ -1175,6 +1507,25 @@ void KFileItemModel::dispatchPendingItemsToInsert()
     }
 }
 
+int KFileItemModel::indexForItemData(ItemData* itemData) const
+{
+    const int itemCount = m_itemData.count();
+    const int position = itemData->position;
+    if (position >= 0 && position < itemCount && m_itemData.at(position) == itemData) {
+        return position;
+    }
+
+    // The position is outdated. Update the positions of all items behind the
+    // last item with a valid position, such that further calls are O(1).
+    for (int i = m_validPositionsCount; i < itemCount; ++i) {
+        m_itemData.at(i)->position = i;
+    }
+    m_validPositionsCount = itemCount;
+
+    Q_ASSERT(m_itemData.at(itemData->position) == itemData);
+    return itemData->position;
+}
+
 void KFileItemModel::insertItems(QList<ItemData*>& newItems)
 {
     if (newItems.isEmpty()) {
@@ -1188,16 +1539,21 @@ void KFileItemModel::insertItems(QList<ItemData*>& newItems)
     qCDebug(DolphinDebug) << "Inserting" << newItems.count() << "items";
 #endif
 
-    m_groups.clear();
     prepareItemsForSorting(newItems);
 
-    // Natural sorting of items can be very slow. However, it becomes much faster
+    // Items which are shown again by applyFilters() are often sorted already.
+    // Checking this is cheap compared to sorting them again.
+    updateSortKeys(newItems.begin(), newItems.end());
+    const bool newItemsSorted = std::is_sorted(newItems.begin(), newItems.end(),
+                                               [this](const ItemData* a, const ItemData* b) { return lessThan(a, b, m_collator); });
+
+    // Natural sorting of role values can be very slow. However, it becomes much faster
     // if the input sequence is already mostly sorted. Therefore, we first sort
     // 'newItems' according to the QStrings using QString::operator<(), which is quite fast.
-    if (m_naturalSorting) {
-        if (m_sortRole == NameRole) {
-            parallelMergeSort(newItems.begin(), newItems.end(), nameLessThan, QThread::idealThreadCount());
-        } else if (isRoleValueNatural(m_sortRole)) {
+    // Sorting by name does not need this step, because the names are compared by
+    // their precalculated collation sort keys (see KFileItemModel::textCompare()).
+    if (m_naturalSorting && !newItemsSorted) {
+        if (isRoleValueNatural(m_sortRole)) {
             auto lambdaLessThan = [&] (const KFileItemModel::ItemData* a, const KFileItemModel::ItemData* b)
             {
                 const QByteArray role = roleForType(m_sortRole);
@@ -1207,7 +1563,9 @@ void KFileItemModel::insertItems(QList<ItemData*>& newItems)
         }
     }
 
-    sort(newItems.begin(), newItems.end());
+    if (!newItemsSorted) {
+        sort(newItems.begin(), newItems.end());
+    }
 
 #ifdef KFILEITEMMODEL_DEBUG
     qCDebug(DolphinDebug) << "[TIME] Sorting:" << timer.elapsed();
@@ -1218,6 +1576,18 @@ void KFileItemModel::insertItems(QList<ItemData*>& newItems)
     const int newItemCount = newItems.count();
     const int totalItemCount = existingItemCount + newItemCount;
 
+    foreach (const ItemData* itemData, newItems) {
+        updateItemCounters(itemData, true);
+    }
+
+    if (!m_itemsToResort.isEmpty()) {
+        // The new items have been merged into a list that is not completely
+        // sorted, so they might not be at their correct positions either.
+        foreach (const ItemData* itemData, newItems) {
+            m_itemsToResort.insert(itemData);
+        }
+    }
+
     if (existingItemCount == 0) {
         // Optimization for the common special case that there are no
         // items in the model yet. Happens, e.g., when entering a folder.
@@ -1267,9 +1637,19 @@ void KFileItemModel::insertItems(QList<ItemData*>& newItems)
         std::reverse(itemRanges.begin(), itemRanges.end());
     }
 
-    // The indexes in m_items are not correct anymore. Therefore, we clear m_items.
-    // It will be re-populated with the updated indices if index(const QUrl&) is called.
-    m_items.clear();
+    // The positions of the items behind the first inserted item have changed.
+    // They will be updated if index(const QUrl&) is called.
+    m_validPositionsCount = qMin(m_validPositionsCount, itemRanges.first().index);
+    if (!m_items.isEmpty()) {
+        foreach (ItemData* itemData, newItems) {
+            m_items.insert(itemData->item.url(), itemData);
+        }
+    }
+    if (!m_keyboardSearchIndex.isEmpty()) {
+        insertIntoKeyboardSearchIndex(newItems);
+    }
+
+    updateGroupsAfterInserting(itemRanges);
 
     emit itemsInserted(itemRanges);
 
@@ -1284,14 +1664,28 @@ void KFileItemModel::removeItems(const KItemRangeList& itemRanges, RemoveItemsBe
         return;
     }
 
-    m_groups.clear();
-
     // Step 1: Remove the items from m_itemData, and free the ItemData.
     int removedItemsCount = 0;
     foreach (const KItemRange& range, itemRanges) {
         removedItemsCount += range.count;
+    }
 
+    if (!m_keyboardSearchIndex.isEmpty()) {
+        QSet<const ItemData*> removedItems;
+        removedItems.reserve(removedItemsCount);
+        foreach (const KItemRange& range, itemRanges) {
+            for (int index = range.index; index < range.index + range.count; ++index) {
+                removedItems.insert(m_itemData.at(index));
+            }
+        }
+        removeFromKeyboardSearchIndex(removedItems);
+    }
+
+    foreach (const KItemRange& range, itemRanges) {
         for (int index = range.index; index < range.index + range.count; ++index) {
+            updateItemCounters(m_itemData.at(index), false);
+            m_itemsToResort.remove(m_itemData.at(index));
+            m_items.remove(m_itemData.at(index)->item.url());
             if (behavior == DeleteItemData) {
                 delete m_itemData.at(index);
             }
@@ -1320,13 +1714,44 @@ void KFileItemModel::removeItems(const KItemRangeList& itemRanges, RemoveItemsBe
 
     m_itemData.erase(m_itemData.end() - removedItemsCount, m_itemData.end());
 
-    // The indexes in m_items are not correct anymore. Therefore, we clear m_items.
-    // It will be re-populated with the updated indices if index(const QUrl&) is called.
-    m_items.clear();
+    // The positions of the items behind the first removed item have changed.
+    // They will be updated if index(const QUrl&) is called.
+    m_validPositionsCount = qMin(m_validPositionsCount, itemRanges.first().index);
+
+    updateGroupsAfterRemoving(itemRanges);
 
     emit itemsRemoved(itemRanges);
 }
 
+void KFileItemModel::insertIntoKeyboardSearchIndex(const QList<ItemData*>& items) const
+{
+    const auto lessThan = [](const KeyboardSearchEntry& a, const KeyboardSearchEntry& b) {
+        return a.first < b.first || (a.first == b.first && std::less<const ItemData*>()(a.second, b.second));
+    };
+
+    // Append the new entries, sort them and merge them with the existing
+    // entries, such that inserting k items into n entries is O(n + k log k).
+    const int oldCount = m_keyboardSearchIndex.count();
+    foreach (ItemData* itemData, items) {
+        m_keyboardSearchIndex.append(qMakePair(caseFoldedText(itemData), itemData));
+    }
+
+    const auto middle = m_keyboardSearchIndex.begin() + oldCount;
+    std::sort(middle, m_keyboardSearchIndex.end(), lessThan);
+    std::inplace_merge(m_keyboardSearchIndex.begin(), middle, m_keyboardSearchIndex.end(), lessThan);
+
+    // The matches of the last search are outdated
+    m_keyboardSearchMatches.clear();
+}
+
+void KFileItemModel::removeFromKeyboardSearchIndex(const QSet<const ItemData*>& items)
+{
+    const auto newEnd = std::remove_if(m_keyboardSearchIndex.begin(), m_keyboardSearchIndex.end(),
+                                       [&items](const KeyboardSearchEntry& entry) { return items.contains(entry.second); });
+    m_keyboardSearchIndex.erase(newEnd, m_keyboardSearchIndex.end());
+    m_keyboardSearchMatches.clear();
+}
+
 QList<KFileItemModel::ItemData*> KFileItemModel::createItemDataList(const QUrl& parentUrl, const KFileItemList& items) const
 {
     if (m_sortRole == TypeRole) {
@@ -1346,6 +1771,9 @@ QList<KFileItemModel::ItemData*> KFileItemModel::createItemDataList(const QUrl&
         ItemData* itemData = new ItemData();
         itemData->item = item;
         itemData->parent = parentItem;
+        itemData->position = -1;
+        itemData->filteredPosition = -1;
+        updateTypedValues(itemData);
         itemDataList.append(itemData);
     }
 
@@ -1394,18 +1822,51 @@ void KFileItemModel::prepareItemsForSorting(QList<ItemData*>& itemDataList)
 
 int KFileItemModel::expandedParentsCount(const ItemData* data)
 {
-    // The hash 'values' is only guaranteed to contain the key "expandedParentsCount"
-    // if the corresponding item is expanded, and it is not a top-level item.
-    const ItemData* parent = data->parent;
-    if (parent) {
-        if (parent->parent) {
-            Q_ASSERT(parent->values.contains("expandedParentsCount"));
-            return parent->values.value("expandedParentsCount").toInt() + 1;
+    return data->expandedParentsCount;
+}
+
+void KFileItemModel::updateTypedValues(ItemData* itemData) const
+{
+    const KFileItem& item = itemData->item;
+
+    itemData->sortTime = sortTime(item);
+    itemData->isDir = item.isDir();
+    itemData->size = itemData->isDir ? 0 : item.size();
+
+    const ItemData* parent = itemData->parent;
+    itemData->expandedParentsCount = parent ? parent->expandedParentsCount + 1 : 0;
+
+    itemData->groupValue = QVariant();
+}
+
+qint64 KFileItemModel::sortTime(const KFileItem& item) const
+{
+    // Don't use KFileItem::time() as this is too expensive when having several
+    // thousands of items. Instead read the raw numbers from the UDSEntry directly.
+    switch (m_sortRole) {
+    case ModificationTimeRole:
+        return item.entry().numberValue(KIO::UDSEntry::UDS_MODIFICATION_TIME, -1);
+    case CreationTimeRole:
+        return item.entry().numberValue(KIO::UDSEntry::UDS_CREATION_TIME, -1);
+    case AccessTimeRole:
+        return item.entry().numberValue(KIO::UDSEntry::UDS_ACCESS_TIME, -1);
+    default:
+        return -1;
+    }
+}
+
+void KFileItemModel::updateItemCounters(const ItemData* itemData, bool add)
+{
+    const int delta = add ? 1 : -1;
+    if (itemData->isDir) {
+        m_folderCount += delta;
+    } else {
+        m_fileCount += delta;
+        if (add) {
+            m_totalFileSize += itemData->size;
         } else {
-            return 1;
+            m_totalFileSize -= itemData->size;
         }
-    } else {
-        return 0;
     }
 }
 
@@ -1442,6 +1903,14 @@ void KFileItemModel::emitItemsChangedAndTriggerResorting(const KItemRangeList& i
 {
     emit itemsChanged(itemRanges, changedRoles);
 
+    if (changedRoles.contains(sortRole())) {
+        foreach (const KItemRange& range, itemRanges) {
+            for (int index = range.index; index < range.index + range.count; ++index) {
+                m_itemData.at(index)->groupValue = QVariant();
+            }
+        }
+    }
+
     // Trigger a resorting if necessary. Note that this can happen even if the sort
     // role has not changed at all because the file name can be used as a fallback.
     if (changedRoles.contains(sortRole()) || changedRoles.contains(roleForType(NameRole))) {
@@ -1455,7 +1924,12 @@ void KFileItemModel::emitItemsChangedAndTriggerResorting(const KItemRangeList& i
             // (a)  The first item in the range is "lessThan" its predecessor,
             // (b)  the successor of the last item is "lessThan" the last item, or
             // (c)  the internal order of the items in the range is incorrect.
-            if (first > 0
+            // The checks (a) and (b) are only meaningful if the neighbors are
+            // at their correct positions themselves.
+            if ((first > 0 && m_itemsToResort.contains(m_itemData.at(first - 1)))
+                || (last < count() - 1 && m_itemsToResort.contains(m_itemData.at(last + 1)))) {
+                needsResorting = true;
+            } else if (first > 0
                 && lessThan(m_itemData.at(first), m_itemData.at(first - 1), m_collator)) {
                 needsResorting = true;
             } else if (last < count() - 1
@@ -1471,22 +1945,50 @@ void KFileItemModel::emitItemsChangedAndTriggerResorting(const KItemRangeList& i
             }
 
             if (needsResorting) {
+                // Only the items in the range must be moved. All other items
+                // are still sorted relative to each other.
+                for (int index = first; index <= last; ++index) {
+                    m_itemsToResort.insert(m_itemData.at(index));
+                }
                 m_resortAllItemsTimer->start();
-                return;
             }
         }
+
+        if (m_resortAllItemsTimer->isActive()) {
+            if (groupedSorting() && changedRoles.contains(sortRole())) {
+                // The groups of all changed items are updated after resorting.
+                foreach (const KItemRange& range, itemRanges) {
+                    for (int index = range.index; index < range.index + range.count; ++index) {
+                        m_itemsToResort.insert(m_itemData.at(index));
+                    }
+                }
+            }
+            return;
+        }
     }
 
     if (groupedSorting() && changedRoles.contains(sortRole())) {
-        // The position is still correct, but the groups might have changed
-        // if the changed item is either the first or the last item in a
-        // group.
-        // In principle, we could try to find out if the item really is the
-        // first or last one in its group and then update the groups
-        // (possibly with a delayed timer to make sure that we don't
-        // re-calculate the groups very often if items are updated one by
-        // one), but starting m_resortAllItemsTimer is easier.
-        m_resortAllItemsTimer->start();
+        // The positions are still correct, but the groups might have changed
+        // if a changed item is either the first or the last item in a group.
+        // Only the group boundaries at the changed items and their successors
+        // must be checked.
+        if (m_groups.isEmpty()) {
+            // The groups have not been determined yet, so it is unknown
+            // whether they have changed.
+            m_groupsChangedTimer->start();
+        } else {
+            const QList<QPair<int, QVariant> > oldGroups = m_groups;
+            foreach (const KItemRange& range, itemRanges) {
+                updateGroups(range.index, range.index + range.count);
+            }
+
+            if (m_groups.isEmpty()) {
+                // The groups have been cleared, e.g. because of expanded folders
+                m_groupsChangedTimer->start();
+            } else {
+                emitGroupsChanged(oldGroups);
+            }
+        }
     }
 }
 
@@ -1716,8 +2218,8 @@ bool KFileItemModel::lessThan(const ItemData* a, const ItemData* b, const QColla
     }
 
     if (m_sortDirsFirst || m_sortRole == SizeRole) {
-        const bool isDirA = a->item.isDir();
-        const bool isDirB = b->item.isDir();
+        const bool isDirA = a->isDir;
+        const bool isDirB = b->isDir;
         if (isDirA && !isDirB) {
             return true;
         } else if (!isDirA && isDirB) {
@@ -1738,6 +2240,8 @@ void KFileItemModel::sort(const QList<KFileItemModel::ItemData*>::iterator &begi
         return lessThan(a, b, m_collator);
     };
 
+    updateSortKeys(begin, end);
+
     if (m_sortRole == NameRole || isRoleValueNatural(m_sortRole)) {
         // Sorting by string can be expensive, in particular if natural sorting is
         // enabled. Use all CPU cores to speed up the sorting process.
@@ -1764,9 +2268,9 @@ int KFileItemModel::sortRoleCompare(const ItemData* a, const ItemData* b, const
         break;
 
     case SizeRole: {
-        if (itemA.isDir()) {
+        if (a->isDir) {
             // See "if (m_sortFoldersFirst || m_sortRole == SizeRole)" in KFileItemModel::lessThan():
-            Q_ASSERT(itemB.isDir());
+            Q_ASSERT(b->isDir);
 
             QVariant valueA, valueB;
             if (DetailsModeSettings::directorySizeCount()) {
@@ -1792,9 +2296,9 @@ int KFileItemModel::sortRoleCompare(const ItemData* a, const ItemData* b, const
             }
         } else {
             // See "if (m_sortFoldersFirst || m_sortRole == SizeRole)" in KFileItemModel::lessThan():
-            Q_ASSERT(!itemB.isDir());
-            const KIO::filesize_t sizeA = itemA.size();
-            const KIO::filesize_t sizeB = itemB.size();
+            Q_ASSERT(!b->isDir);
+            const KIO::filesize_t sizeA = a->size;
+            const KIO::filesize_t sizeB = b->size;
             if (sizeA > sizeB) {
                 result = +1;
             } else if (sizeA < sizeB) {
@@ -1806,20 +2310,11 @@ int KFileItemModel::sortRoleCompare(const ItemData* a, const ItemData* b, const
         break;
     }
 
-    case ModificationTimeRole: {
-        const long long dateTimeA = itemA.entry().numberValue(KIO::UDSEntry::UDS_MODIFICATION_TIME, -1);
-        const long long dateTimeB = itemB.entry().numberValue(KIO::UDSEntry::UDS_MODIFICATION_TIME, -1);
-        if (dateTimeA < dateTimeB) {
-            result = -1;
-        } else if (dateTimeA > dateTimeB) {
-            result = +1;
-        }
-        break;
-    }
-
-    case CreationTimeRole: {
-        const long long dateTimeA = itemA.entry().numberValue(KIO::UDSEntry::UDS_CREATION_TIME, -1);
-        const long long dateTimeB = itemB.entry().numberValue(KIO::UDSEntry::UDS_CREATION_TIME, -1);
+    case ModificationTimeRole:
+    case CreationTimeRole:
+    case AccessTimeRole: {
+        const qint64 dateTimeA = a->sortTime;
+        const qint64 dateTimeB = b->sortTime;
         if (dateTimeA < dateTimeB) {
             result = -1;
         } else if (dateTimeA > dateTimeB) {
@@ -1846,7 +2341,8 @@ int KFileItemModel::sortRoleCompare(const ItemData* a, const ItemData* b, const
     case LineCountRole:
     case TrackRole:
     case ReleaseYearRole: {
-        result = a->values.value(roleForType(m_sortRole)).toInt() - b->values.value(roleForType(m_sortRole)).toInt();
+        const QByteArray role = sortRole();
+        result = a->values.value(role).toInt() - b->values.value(role).toInt();
         break;
     }
 
@@ -1874,7 +2370,7 @@ int KFileItemModel::sortRoleCompare(const ItemData* a, const ItemData* b, const
     }
 
     // Fallback #1: Compare the text of the items
-    result = stringCompare(itemA.text(), itemB.text(), collator);
+    result = textCompare(a, b, collator);
     if (result != 0) {
         return result;
     }
@@ -1893,9 +2389,8 @@ int KFileItemModel::sortRoleCompare(const ItemData* a, const ItemData* b, const
 
 int KFileItemModel::stringCompare(const QString& a, const QString& b, const QCollator& collator) const
 {
-    QMutexLocker collatorLock(s_collatorMutex());
-
     if (m_naturalSorting) {
+        QMutexLocker collatorLock(s_collatorMutex());
         return collator.compare(a, b);
     }
 
@@ -1910,397 +2405,510 @@ int KFileItemModel::stringCompare(const QString& a, const QString& b, const QCol
     return QString::compare(a, b, Qt::CaseSensitive);
 }
 
-QList<QPair<int, QVariant> > KFileItemModel::nameRoleGroups() const
+int KFileItemModel::textCompare(const ItemData* a, const ItemData* b, const QCollator& collator) const
 {
-    Q_ASSERT(!m_itemData.isEmpty());
-
-    const int maxIndex = count() - 1;
-    QList<QPair<int, QVariant> > groups;
+    if (m_naturalSorting && a->textSortKey && b->textSortKey) {
+        // Comparing the sort keys is reentrant, no locking of the collator is required.
+        return a->textSortKey->compare(*b->textSortKey);
+    }
 
-    QString groupValue;
-    QChar firstChar;
-    for (int i = 0; i <= maxIndex; ++i) {
-        if (isChildItem(i)) {
-            continue;
-        }
+    return stringCompare(a->item.text(), b->item.text(), collator);
+}
 
-        const QString name = m_itemData.at(i)->item.text();
+void KFileItemModel::updateSortKeys(const QList<ItemData*>::iterator& begin, const QList<ItemData*>::iterator& end) const
+{
+    if (!m_naturalSorting) {
+        return;
+    }
 
-        // Use the first character of the name as group indication
-        QChar newFirstChar = name.at(0).toUpper();
-        if (newFirstChar == QLatin1Char('~') && name.length() > 1) {
-            newFirstChar = name.at(1).toUpper();
+    // Calculating a sort key is about as expensive as a single comparison with
+    // QCollator::compare(). As the keys are stored in the ItemData, each key is
+    // calculated only once instead of O(log(n)) times while sorting.
+    QMutexLocker collatorLock(s_collatorMutex());
+    for (QList<ItemData*>::iterator it = begin; it != end; ++it) {
+        ItemData* itemData = *it;
+        if (!itemData->textSortKey) {
+            itemData->textSortKey.reset(new QCollatorSortKey(m_collator.sortKey(itemData->item.text())));
         }
+    }
+}
 
-        if (firstChar != newFirstChar) {
-            QString newGroupValue;
-            if (newFirstChar.isLetter()) {
+void KFileItemModel::resetSortKeys()
+{
+    foreach (ItemData* itemData, m_itemData) {
+        itemData->textSortKey.reset();
+    }
+    foreach (ItemData* itemData, m_pendingItemsToInsert) {
+        itemData->textSortKey.reset();
+    }
+    foreach (ItemData* itemData, m_filteredItems) {
+        itemData->textSortKey.reset();
+    }
+}
 
-                if (m_collator.compare(newFirstChar, QChar(QLatin1Char('A'))) >= 0 && m_collator.compare(newFirstChar, QChar(QLatin1Char('Z'))) <= 0) {
-                    // WARNING! Symbols based on latin 'Z' like 'Z' with acute are treated wrong as non Latin and put in a new group.
+QVariant KFileItemModel::groupValue(ItemData* itemData) const
+{
+    if (!itemData->groupValue.isValid()) {
+        switch (m_sortRole) {
+        case NameRole:
+            itemData->groupValue = nameGroupValue(itemData);
+            break;
+        case SizeRole:
+            itemData->groupValue = sizeGroupValue(itemData);
+            break;
+        case ModificationTimeRole:
+            itemData->groupValue = timeGroupValue(itemData->item.time(KFileItem::ModificationTime));
+            break;
+        case CreationTimeRole:
+            itemData->groupValue = timeGroupValue(itemData->item.time(KFileItem::CreationTime));
+            break;
+        case AccessTimeRole:
+            itemData->groupValue = timeGroupValue(itemData->item.time(KFileItem::AccessTime));
+            break;
+        case DeletionTimeRole:
+            itemData->groupValue = timeGroupValue(itemData->values.value("deletiontime").toDateTime());
+            break;
+        case PermissionsRole:
+            itemData->groupValue = permissionGroupValue(itemData);
+            break;
+        case RatingRole:
+            itemData->groupValue = itemData->values.value("rating", 0).toInt();
+            break;
+        default:
+            itemData->groupValue = itemData->values.value(sortRole()).toString();
+            break;
+        }
+    }
 
-                    // Try to find a matching group in the range 'A' to 'Z'.
-                    static std::vector<QChar> lettersAtoZ;
-                    lettersAtoZ.reserve('Z' - 'A' + 1);
-                    if (lettersAtoZ.empty()) {
-                        for (char c = 'A'; c <= 'Z'; ++c) {
-                            lettersAtoZ.push_back(QLatin1Char(c));
-                        }
-                    }
+    return itemData->groupValue;
+}
 
-                    auto localeAwareLessThan = [this](QChar c1, QChar c2) -> bool {
-                        return m_collator.compare(c1, c2) < 0;
-                    };
+void KFileItemModel::updateGroups(int firstIndex, int lastIndex) const
+{
+    if (m_groups.isEmpty()) {
+        // The groups have not been determined yet. This is done
+        // for all items the next time groups() is called.
+        return;
+    }
 
-                    std::vector<QChar>::iterator it = std::lower_bound(lettersAtoZ.begin(), lettersAtoZ.end(), newFirstChar, localeAwareLessThan);
-                    if (it != lettersAtoZ.end()) {
-                        if (localeAwareLessThan(newFirstChar, *it)) {
-                            // newFirstChar belongs to the group preceding *it.
-                            // Example: for an umlaut 'A' in the German locale, *it would be 'B' now.
-                            --it;
-                        }
-                        newGroupValue = *it;
-                    }
+    if (!m_expandedDirs.isEmpty()) {
+        // Child items are not grouped, so the predecessor of an item in its
+        // group might be far away. Expanded folders in grouped views are
+        // rare, therefore the groups are just determined again from scratch.
+        m_groups.clear();
+        return;
+    }
 
-                } else {
-                    // Symbols from non Latin-based scripts
-                    newGroupValue = newFirstChar;
-                }
-            } else if (newFirstChar >= QLatin1Char('0') && newFirstChar <= QLatin1Char('9')) {
-                // Apply group '0 - 9' for any name that starts with a digit
-                newGroupValue = i18nc("@title:group Groups that start with a digit", "0 - 9");
-            } else {
-                newGroupValue = i18nc("@title:group", "Others");
-            }
+    firstIndex = qMax(firstIndex, 0);
+    lastIndex = qMin(lastIndex, count() - 1);
+    if (firstIndex > lastIndex) {
+        return;
+    }
 
-            if (newGroupValue != groupValue) {
-                groupValue = newGroupValue;
-                groups.append(QPair<int, QVariant>(i, newGroupValue));
-            }
+    // Remove the old group boundaries inside the range...
+    auto groupLessThan = [](const QPair<int, QVariant>& group, int index) {
+        return group.first < index;
+    };
+    QList<QPair<int, QVariant> >::iterator it = std::lower_bound(m_groups.begin(), m_groups.end(), firstIndex, groupLessThan);
+    while (it != m_groups.end() && it->first <= lastIndex) {
+        it = m_groups.erase(it);
+    }
 
-            firstChar = newFirstChar;
+    // ...and insert the new ones.
+    QVariant previousValue = firstIndex > 0 ? groupValue(m_itemData.at(firstIndex - 1)) : QVariant();
+    for (int i = firstIndex; i <= lastIndex; ++i) {
+        const QVariant value = groupValue(m_itemData.at(i));
+        if (i == 0 || value != previousValue) {
+            it = m_groups.insert(it, QPair<int, QVariant>(i, value));
+            ++it;
         }
+        previousValue = value;
     }
-    return groups;
 }
 
-QList<QPair<int, QVariant> > KFileItemModel::sizeRoleGroups() const
+void KFileItemModel::updateGroupsAfterInserting(const KItemRangeList& itemRanges)
 {
-    Q_ASSERT(!m_itemData.isEmpty());
-
-    const int maxIndex = count() - 1;
-    QList<QPair<int, QVariant> > groups;
-
-    QString groupValue;
-    for (int i = 0; i <= maxIndex; ++i) {
-        if (isChildItem(i)) {
-            continue;
-        }
-
-        const KFileItem& item = m_itemData.at(i)->item;
-        const KIO::filesize_t fileSize = !item.isNull() ? item.size() : ~0U;
-        QString newGroupValue;
-        if (!item.isNull() && item.isDir()) {
-            newGroupValue = i18nc("@title:group Size", "Folders");
-        } else if (fileSize < 5 * 1024 * 1024) {
-            newGroupValue = i18nc("@title:group Size", "Small");
-        } else if (fileSize < 10 * 1024 * 1024) {
-            newGroupValue = i18nc("@title:group Size", "Medium");
-        } else {
-            newGroupValue = i18nc("@title:group Size", "Big");
-        }
+    if (m_groups.isEmpty()) {
+        return;
+    }
 
-        if (newGroupValue != groupValue) {
-            groupValue = newGroupValue;
-            groups.append(QPair<int, QVariant>(i, newGroupValue));
+    // Move the existing group boundaries behind the inserted items. Note that
+    // the indexes in itemRanges refer to the model before the insertion.
+    int insertedCount = 0;
+    int rangeIndex = 0;
+    for (int i = 0; i < m_groups.count(); ++i) {
+        while (rangeIndex < itemRanges.count() && itemRanges.at(rangeIndex).index <= m_groups.at(i).first) {
+            insertedCount += itemRanges.at(rangeIndex).count;
+            ++rangeIndex;
         }
+        m_groups[i].first += insertedCount;
     }
 
-    return groups;
+    // Only the inserted items and their successors might start a new group.
+    insertedCount = 0;
+    foreach (const KItemRange& range, itemRanges) {
+        const int firstIndex = range.index + insertedCount;
+        updateGroups(firstIndex, firstIndex + range.count);
+        insertedCount += range.count;
+    }
 }
 
-QList<QPair<int, QVariant> > KFileItemModel::timeRoleGroups(const std::function<QDateTime(const ItemData *)> &fileTimeCb) const
+void KFileItemModel::updateGroupsAfterRemoving(const KItemRangeList& itemRanges)
 {
-    Q_ASSERT(!m_itemData.isEmpty());
+    if (m_groups.isEmpty()) {
+        return;
+    }
 
-    const int maxIndex = count() - 1;
+    // Drop the group boundaries of removed items, and move the other ones.
+    // Note that the indexes in itemRanges refer to the model before the removal.
     QList<QPair<int, QVariant> > groups;
-
-    const QDate currentDate = QDate::currentDate();
-
-    QDate previousFileDate;
-    QString groupValue;
-    for (int i = 0; i <= maxIndex; ++i) {
-        if (isChildItem(i)) {
+    groups.reserve(m_groups.count());
+    int removedCount = 0;
+    int rangeIndex = 0;
+    foreach (const QPair<int, QVariant>& group, m_groups) {
+        while (rangeIndex < itemRanges.count()
+               && itemRanges.at(rangeIndex).index + itemRanges.at(rangeIndex).count <= group.first) {
+            removedCount += itemRanges.at(rangeIndex).count;
+            ++rangeIndex;
+        }
+        if (rangeIndex < itemRanges.count() && itemRanges.at(rangeIndex).index <= group.first) {
             continue;
         }
+        groups.append(QPair<int, QVariant>(group.first - removedCount, group.second));
+    }
+    m_groups = groups;
 
-        const QDateTime fileTime = fileTimeCb(m_itemData.at(i));
-        const QDate fileDate = fileTime.date();
-        if (fileDate == previousFileDate) {
-            // The current item is in the same group as the previous item
-            continue;
-        }
-        previousFileDate = fileDate;
-
-        const int daysDistance = fileDate.daysTo(currentDate);
+    // Only the successors of the removed items might start a new group.
+    removedCount = 0;
+    foreach (const KItemRange& range, itemRanges) {
+        const int index = range.index - removedCount;
+        updateGroups(index, index);
+        removedCount += range.count;
+    }
+}
 
-        QString newGroupValue;
-        if (currentDate.year() == fileDate.year() &&
-            currentDate.month() == fileDate.month()) {
+void KFileItemModel::emitGroupsChanged(const QList<QPair<int, QVariant> >& oldGroups)
+{
+    if (m_groups == oldGroups) {
+        return;
+    }
 
-            switch (daysDistance / 7) {
-            case 0:
-                switch (daysDistance) {
-                case 0:  newGroupValue = i18nc("@title:group Date", "Today"); break;
-                case 1:  newGroupValue = i18nc("@title:group Date", "Yesterday"); break;
-                default:
-                    newGroupValue = fileTime.toString(
-                        i18nc("@title:group Date: The week day name: dddd", "dddd"));
-                    newGroupValue = i18nc("Can be used to script translation of \"dddd\""
-                        "with context @title:group Date", "%1", newGroupValue);
-                }
-                break;
-            case 1:
-                newGroupValue = i18nc("@title:group Date", "One Week Ago");
-                break;
-            case 2:
-                newGroupValue = i18nc("@title:group Date", "Two Weeks Ago");
-                break;
-            case 3:
-                newGroupValue = i18nc("@title:group Date", "Three Weeks Ago");
+    if (m_groups.count() == oldGroups.count()) {
+        // If the first items of all groups are unchanged, it is sufficient
+        // to update the headers of the groups with changed values.
+        KItemRangeList changedGroups;
+        const int groupCount = m_groups.count();
+        for (int i = 0; i < groupCount; ++i) {
+            const QPair<int, QVariant>& group = m_groups.at(i);
+            if (group.first != oldGroups.at(i).first) {
+                changedGroups.clear();
                 break;
-            case 4:
-            case 5:
-                newGroupValue = i18nc("@title:group Date", "Earlier this Month");
-                break;
-            default:
-                Q_ASSERT(false);
             }
-        } else {
-            const QDate lastMonthDate = currentDate.addMonths(-1);
-            if  (lastMonthDate.year() == fileDate.year() &&
-                 lastMonthDate.month() == fileDate.month()) {
-
-                if (daysDistance == 1) {
-                    const KLocalizedString format = ki18nc("@title:group Date: "
-                                                    "MMMM is full month name in current locale, and yyyy is "
-                                                    "full year number", "'Yesterday' (MMMM, yyyy)");
-                    const QString translatedFormat = format.toString();
-                    if (translatedFormat.count(QLatin1Char('\'')) == 2) {
-                        newGroupValue = fileTime.toString(translatedFormat);
-                        newGroupValue = i18nc("Can be used to script translation of "
-                            "\"'Yesterday' (MMMM, yyyy)\" with context @title:group Date",
-                            "%1", newGroupValue);
-                    } else {
-                        qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
-                        const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
-                        newGroupValue = fileTime.toString(untranslatedFormat);
-                    }
-                } else if (daysDistance <= 7) {
-                    newGroupValue = fileTime.toString(i18nc("@title:group Date: "
-                        "The week day name: dddd, MMMM is full month name "
-                        "in current locale, and yyyy is full year number",
-                        "dddd (MMMM, yyyy)"));
-                    newGroupValue = i18nc("Can be used to script translation of "
-                        "\"dddd (MMMM, yyyy)\" with context @title:group Date",
-                        "%1", newGroupValue);
-                } else if (daysDistance <= 7 * 2) {
-                    const KLocalizedString format = ki18nc("@title:group Date: "
-                                                           "MMMM is full month name in current locale, and yyyy is "
-                                                           "full year number", "'One Week Ago' (MMMM, yyyy)");
-                    const QString translatedFormat = format.toString();
-                    if (translatedFormat.count(QLatin1Char('\'')) == 2) {
-                        newGroupValue = fileTime.toString(translatedFormat);
-                        newGroupValue = i18nc("Can be used to script translation of "
-                            "\"'One Week Ago' (MMMM, yyyy)\" with context @title:group Date",
-                            "%1", newGroupValue);
-                    } else {
-                        qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
-                        const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
-                        newGroupValue = fileTime.toString(untranslatedFormat);
-                    }
-                } else if (daysDistance <= 7 * 3) {
-                    const KLocalizedString format = ki18nc("@title:group Date: "
-                                                           "MMMM is full month name in current locale, and yyyy is "
-                                                           "full year number", "'Two Weeks Ago' (MMMM, yyyy)");
-                    const QString translatedFormat = format.toString();
-                    if (translatedFormat.count(QLatin1Char('\'')) == 2) {
-                        newGroupValue = fileTime.toString(translatedFormat);
-                        newGroupValue = i18nc("Can be used to script translation of "
-                            "\"'Two Weeks Ago' (MMMM, yyyy)\" with context @title:group Date",
-                            "%1", newGroupValue);
-                    } else {
-                        qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
-                        const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
-                        newGroupValue = fileTime.toString(untranslatedFormat);
-                    }
-                } else if (daysDistance <= 7 * 4) {
-                    const KLocalizedString format = ki18nc("@title:group Date: "
-                                                           "MMMM is full month name in current locale, and yyyy is "
-                                                           "full year number", "'Three Weeks Ago' (MMMM, yyyy)");
-                    const QString translatedFormat = format.toString();
-                    if (translatedFormat.count(QLatin1Char('\'')) == 2) {
-                        newGroupValue = fileTime.toString(translatedFormat);
-                        newGroupValue = i18nc("Can be used to script translation of "
-                            "\"'Three Weeks Ago' (MMMM, yyyy)\" with context @title:group Date",
-                            "%1", newGroupValue);
-                    } else {
-                        qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
-                        const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
-                        newGroupValue = fileTime.toString(untranslatedFormat);
-                    }
-                } else {
-                    const KLocalizedString format = ki18nc("@title:group Date: "
-                                                           "MMMM is full month name in current locale, and yyyy is "
-                                                           "full year number", "'Earlier on' MMMM, yyyy");
-                    const QString translatedFormat = format.toString();
-                    if (translatedFormat.count(QLatin1Char('\'')) == 2) {
-                        newGroupValue = fileTime.toString(translatedFormat);
-                        newGroupValue = i18nc("Can be used to script translation of "
-                            "\"'Earlier on' MMMM, yyyy\" with context @title:group Date",
-                            "%1", newGroupValue);
-                    } else {
-                        qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
-                        const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
-                        newGroupValue = fileTime.toString(untranslatedFormat);
-                    }
-                }
-            } else {
-                newGroupValue = fileTime.toString(i18nc("@title:group "
-                    "The month and year: MMMM is full month name in current locale, "
-                    "and yyyy is full year number", "MMMM, yyyy"));
-                newGroupValue = i18nc("Can be used to script translation of "
-                    "\"MMMM, yyyy\" with context @title:group Date",
-                    "%1", newGroupValue);
+            if (group.second != oldGroups.at(i).second) {
+                const int nextGroupIndex = (i + 1 < groupCount) ? m_groups.at(i + 1).first : count();
+                changedGroups << KItemRange(group.first, nextGroupIndex - group.first);
             }
         }
 
-        if (newGroupValue != groupValue) {
-            groupValue = newGroupValue;
-            groups.append(QPair<int, QVariant>(i, newGroupValue));
+        if (!changedGroups.isEmpty()) {
+            emit groupValuesChanged(changedGroups);
+            return;
         }
     }
 
-    return groups;
+    emit groupsChanged();
 }
 
-QList<QPair<int, QVariant> > KFileItemModel::permissionRoleGroups() const
+void KFileItemModel::resetGroups() const
 {
-    Q_ASSERT(!m_itemData.isEmpty());
+    m_groups.clear();
+    m_nameGroupValues.clear();
+    m_timeGroupValues.clear();
+    m_permissionGroupValues.clear();
 
-    const int maxIndex = count() - 1;
-    QList<QPair<int, QVariant> > groups;
+    foreach (ItemData* itemData, m_itemData) {
+        itemData->groupValue = QVariant();
+    }
+    foreach (ItemData* itemData, m_filteredItems) {
+        itemData->groupValue = QVariant();
+    }
+}
 
-    QString permissionsString;
-    QString groupValue;
-    for (int i = 0; i <= maxIndex; ++i) {
-        if (isChildItem(i)) {
-            continue;
-        }
+QString KFileItemModel::nameGroupValue(const ItemData* itemData) const
+{
+    const QString name = itemData->item.text();
 
-        const ItemData* itemData = m_itemData.at(i);
-        const QString newPermissionsString = itemData->values.value("permissions").toString();
-        if (newPermissionsString == permissionsString) {
-            continue;
-        }
-        permissionsString = newPermissionsString;
+    // Use the first character of the name as group indication
+    QChar firstChar = name.at(0).toUpper();
+    if (firstChar == QLatin1Char('~') && name.length() > 1) {
+        firstChar = name.at(1).toUpper();
+    }
 
-        const QFileInfo info(itemData->item.url().toLocalFile());
+    // Determining the group requires several locale aware comparisons.
+    // Therefore, the group is only determined once for each character.
+    const QHash<QChar, QString>::const_iterator cachedValue = m_nameGroupValues.constFind(firstChar);
+    if (cachedValue != m_nameGroupValues.constEnd()) {
+        return cachedValue.value();
+    }
 
-        // Set user string
-        QString user;
-        if (info.permission(QFile::ReadUser)) {
-            user = i18nc("@item:intext Access permission, concatenated", "Read, ");
-        }
-        if (info.permission(QFile::WriteUser)) {
-            user += i18nc("@item:intext Access permission, concatenated", "Write, ");
-        }
-        if (info.permission(QFile::ExeUser)) {
-            user += i18nc("@item:intext Access permission, concatenated", "Execute, ");
-        }
-        user = user.isEmpty() ? i18nc("@item:intext Access permission, concatenated", "Forbidden") : user.mid(0, user.count() - 2);
+    QString groupValue;
+    if (firstChar.isLetter()) {
 
-        // Set group string
-        QString group;
-        if (info.permission(QFile::ReadGroup)) {
-            group = i18nc("@item:intext Access permission, concatenated", "Read, ");
-        }
-        if (info.permission(QFile::WriteGroup)) {
-            group += i18nc("@item:intext Access permission, concatenated", "Write, ");
-        }
-        if (info.permission(QFile::ExeGroup)) {
-            group += i18nc("@item:intext Access permission, concatenated", "Execute, ");
-        }
-        group = group.isEmpty() ? i18nc("@item:intext Access permission, concatenated", "Forbidden") : group.mid(0, group.count() - 2);
+        if (m_collator.compare(firstChar, QChar(QLatin1Char('A'))) >= 0 && m_collator.compare(firstChar, QChar(QLatin1Char('Z'))) <= 0) {
+            // WARNING! Symbols based on latin 'Z' like 'Z' with acute are treated wrong as non Latin and put in a new group.
 
-        // Set others string
-        QString others;
-        if (info.permission(QFile::ReadOther)) {
-            others = i18nc("@item:intext Access permission, concatenated", "Read, ");
-        }
-        if (info.permission(QFile::WriteOther)) {
-            others += i18nc("@item:intext Access permission, concatenated", "Write, ");
-        }
-        if (info.permission(QFile::ExeOther)) {
-            others += i18nc("@item:intext Access permission, concatenated", "Execute, ");
-        }
-        others = others.isEmpty() ? i18nc("@item:intext Access permission, concatenated", "Forbidden") : others.mid(0, others.count() - 2);
+            // Try to find a matching group in the range 'A' to 'Z'.
+            static std::vector<QChar> lettersAtoZ;
+            lettersAtoZ.reserve('Z' - 'A' + 1);
+            if (lettersAtoZ.empty()) {
+                for (char c = 'A'; c <= 'Z'; ++c) {
+                    lettersAtoZ.push_back(QLatin1Char(c));
+                }
+            }
+
+            auto localeAwareLessThan = [this](QChar c1, QChar c2) -> bool {
+                return m_collator.compare(c1, c2) < 0;
+            };
 
-        const QString newGroupValue = i18nc("@title:group Files and folders by permissions", "User: %1 | Group: %2 | Others: %3", user, group, others);
-        if (newGroupValue != groupValue) {
-            groupValue = newGroupValue;
-            groups.append(QPair<int, QVariant>(i, newGroupValue));
+            std::vector<QChar>::iterator it = std::lower_bound(lettersAtoZ.begin(), lettersAtoZ.end(), firstChar, localeAwareLessThan);
+            if (it != lettersAtoZ.end()) {
+                if (localeAwareLessThan(firstChar, *it)) {
+                    // firstChar belongs to the group preceding *it.
+                    // Example: for an umlaut 'A' in the German locale, *it would be 'B' now.
+                    --it;
+                }
+                groupValue = *it;
+            }
+
+        } else {
+            // Symbols from non Latin-based scripts
+            groupValue = firstChar;
         }
+    } else if (firstChar >= QLatin1Char('0') && firstChar <= QLatin1Char('9')) {
+        // Apply group '0 - 9' for any name that starts with a digit
+        groupValue = i18nc("@title:group Groups that start with a digit", "0 - 9");
+    } else {
+        groupValue = i18nc("@title:group", "Others");
     }
 
-    return groups;
+    m_nameGroupValues.insert(firstChar, groupValue);
+    return groupValue;
+}
+
+QString KFileItemModel::sizeGroupValue(const ItemData* itemData) const
+{
+    const KIO::filesize_t fileSize = itemData->size;
+    if (itemData->isDir) {
+        return i18nc("@title:group Size", "Folders");
+    } else if (fileSize < 5 * 1024 * 1024) {
+        return i18nc("@title:group Size", "Small");
+    } else if (fileSize < 10 * 1024 * 1024) {
+        return i18nc("@title:group Size", "Medium");
+    } else {
+        return i18nc("@title:group Size", "Big");
+    }
 }
 
-QList<QPair<int, QVariant> > KFileItemModel::ratingRoleGroups() const
+QString KFileItemModel::timeGroupValue(const QDateTime& fileTime) const
 {
-    Q_ASSERT(!m_itemData.isEmpty());
+    // The group only depends on the date, which is shared by many items.
+    const QDate fileDate = fileTime.date();
+    const QHash<QDate, QString>::const_iterator cachedValue = m_timeGroupValues.constFind(fileDate);
+    if (cachedValue != m_timeGroupValues.constEnd()) {
+        return cachedValue.value();
+    }
 
-    const int maxIndex = count() - 1;
-    QList<QPair<int, QVariant> > groups;
+    const QDate currentDate = m_groupValuesDate;
+    const int daysDistance = fileDate.daysTo(currentDate);
 
-    int groupValue = -1;
-    for (int i = 0; i <= maxIndex; ++i) {
-        if (isChildItem(i)) {
-            continue;
+    QString groupValue;
+    if (currentDate.year() == fileDate.year() &&
+        currentDate.month() == fileDate.month()) {
+
+        switch (daysDistance / 7) {
+        case 0:
+            switch (daysDistance) {
+            case 0:  groupValue = i18nc("@title:group Date", "Today"); break;
+            case 1:  groupValue = i18nc("@title:group Date", "Yesterday"); break;
+            default:
+                groupValue = fileTime.toString(
+                    i18nc("@title:group Date: The week day name: dddd", "dddd"));
+                groupValue = i18nc("Can be used to script translation of \"dddd\""
+                    "with context @title:group Date", "%1", groupValue);
+            }
+            break;
+        case 1:
+            groupValue = i18nc("@title:group Date", "One Week Ago");
+            break;
+        case 2:
+            groupValue = i18nc("@title:group Date", "Two Weeks Ago");
+            break;
+        case 3:
+            groupValue = i18nc("@title:group Date", "Three Weeks Ago");
+            break;
+        case 4:
+        case 5:
+            groupValue = i18nc("@title:group Date", "Earlier this Month");
+            break;
+        default:
+            Q_ASSERT(false);
         }
-        const int newGroupValue = m_itemData.at(i)->values.value("rating", 0).toInt();
-        if (newGroupValue != groupValue) {
-            groupValue = newGroupValue;
-            groups.append(QPair<int, QVariant>(i, newGroupValue));
+    } else {
+        const QDate lastMonthDate = currentDate.addMonths(-1);
+        if  (lastMonthDate.year() == fileDate.year() &&
+             lastMonthDate.month() == fileDate.month()) {
+
+            if (daysDistance == 1) {
+                const KLocalizedString format = ki18nc("@title:group Date: "
+                                                "MMMM is full month name in current locale, and yyyy is "
+                                                "full year number", "'Yesterday' (MMMM, yyyy)");
+                const QString translatedFormat = format.toString();
+                if (translatedFormat.count(QLatin1Char('\'')) == 2) {
+                    groupValue = fileTime.toString(translatedFormat);
+                    groupValue = i18nc("Can be used to script translation of "
+                        "\"'Yesterday' (MMMM, yyyy)\" with context @title:group Date",
+                        "%1", groupValue);
+                } else {
+                    qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
+                    const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
+                    groupValue = fileTime.toString(untranslatedFormat);
+                }
+            } else if (daysDistance <= 7) {
+                groupValue = fileTime.toString(i18nc("@title:group Date: "
+                    "The week day name: dddd, MMMM is full month name "
+                    "in current locale, and yyyy is full year number",
+                    "dddd (MMMM, yyyy)"));
+                groupValue = i18nc("Can be used to script translation of "
+                    "\"dddd (MMMM, yyyy)\" with context @title:group Date",
+                    "%1", groupValue);
+            } else if (daysDistance <= 7 * 2) {
+                const KLocalizedString format = ki18nc("@title:group Date: "
+                                                       "MMMM is full month name in current locale, and yyyy is "
+                                                       "full year number", "'One Week Ago' (MMMM, yyyy)");
+                const QString translatedFormat = format.toString();
+                if (translatedFormat.count(QLatin1Char('\'')) == 2) {
+                    groupValue = fileTime.toString(translatedFormat);
+                    groupValue = i18nc("Can be used to script translation of "
+                        "\"'One Week Ago' (MMMM, yyyy)\" with context @title:group Date",
+                        "%1", groupValue);
+                } else {
+                    qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
+                    const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
+                    groupValue = fileTime.toString(untranslatedFormat);
+                }
+            } else if (daysDistance <= 7 * 3) {
+                const KLocalizedString format = ki18nc("@title:group Date: "
+                                                       "MMMM is full month name in current locale, and yyyy is "
+                                                       "full year number", "'Two Weeks Ago' (MMMM, yyyy)");
+                const QString translatedFormat = format.toString();
+                if (translatedFormat.count(QLatin1Char('\'')) == 2) {
+                    groupValue = fileTime.toString(translatedFormat);
+                    groupValue = i18nc("Can be used to script translation of "
+                        "\"'Two Weeks Ago' (MMMM, yyyy)\" with context @title:group Date",
+                        "%1", groupValue);
+                } else {
+                    qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
+                    const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
+                    groupValue = fileTime.toString(untranslatedFormat);
+                }
+            } else if (daysDistance <= 7 * 4) {
+                const KLocalizedString format = ki18nc("@title:group Date: "
+                                                       "MMMM is full month name in current locale, and yyyy is "
+                                                       "full year number", "'Three Weeks Ago' (MMMM, yyyy)");
+                const QString translatedFormat = format.toString();
+                if (translatedFormat.count(QLatin1Char('\'')) == 2) {
+                    groupValue = fileTime.toString(translatedFormat);
+                    groupValue = i18nc("Can be used to script translation of "
+                        "\"'Three Weeks Ago' (MMMM, yyyy)\" with context @title:group Date",
+                        "%1", groupValue);
+                } else {
+                    qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
+                    const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
+                    groupValue = fileTime.toString(untranslatedFormat);
+                }
+            } else {
+                const KLocalizedString format = ki18nc("@title:group Date: "
+                                                       "MMMM is full month name in current locale, and yyyy is "
+                                                       "full year number", "'Earlier on' MMMM, yyyy");
+                const QString translatedFormat = format.toString();
+                if (translatedFormat.count(QLatin1Char('\'')) == 2) {
+                    groupValue = fileTime.toString(translatedFormat);
+                    groupValue = i18nc("Can be used to script translation of "
+                        "\"'Earlier on' MMMM, yyyy\" with context @title:group Date",
+                        "%1", groupValue);
+                } else {
+                    qCWarning(DolphinDebug).nospace() << "A wrong translation was found: " << translatedFormat << ". Please file a bug report at bugs.kde.org";
+                    const QString untranslatedFormat = format.toString({ QLatin1String("en_US") });
+                    groupValue = fileTime.toString(untranslatedFormat);
+                }
+            }
+        } else {
+            groupValue = fileTime.toString(i18nc("@title:group "
+                "The month and year: MMMM is full month name in current locale, "
+                "and yyyy is full year number", "MMMM, yyyy"));
+            groupValue = i18nc("Can be used to script translation of "
+                "\"MMMM, yyyy\" with context @title:group Date",
+                "%1", groupValue);
         }
     }
 
-    return groups;
+    m_timeGroupValues.insert(fileDate, groupValue);
+    return groupValue;
 }
 
-QList<QPair<int, QVariant> > KFileItemModel::genericStringRoleGroups(const QByteArray& role) const
+QString KFileItemModel::permissionGroupValue(const ItemData* itemData) const
 {
-    Q_ASSERT(!m_itemData.isEmpty());
+    // Items with the same permissions string belong to the same group.
+    const QString permissionsString = itemData->values.value("permissions").toString();
+    const QHash<QString, QString>::const_iterator cachedValue = m_permissionGroupValues.constFind(permissionsString);
+    if (cachedValue != m_permissionGroupValues.constEnd()) {
+        return cachedValue.value();
+    }
 
-    const int maxIndex = count() - 1;
-    QList<QPair<int, QVariant> > groups;
+    const QFileInfo info(itemData->item.url().toLocalFile());
 
-    bool isFirstGroupValue = true;
-    QString groupValue;
-    for (int i = 0; i <= maxIndex; ++i) {
-        if (isChildItem(i)) {
-            continue;
-        }
-        const QString newGroupValue = m_itemData.at(i)->values.value(role).toString();
-        if (newGroupValue != groupValue || isFirstGroupValue) {
-            groupValue = newGroupValue;
-            groups.append(QPair<int, QVariant>(i, newGroupValue));
-            isFirstGroupValue = false;
-        }
+    // Set user string
+    QString user;
+    if (info.permission(QFile::ReadUser)) {
+        user = i18nc("@item:intext Access permission, concatenated", "Read, ");
+    }
+    if (info.permission(QFile::WriteUser)) {
+        user += i18nc("@item:intext Access permission, concatenated", "Write, ");
+    }
+    if (info.permission(QFile::ExeUser)) {
+        user += i18nc("@item:intext Access permission, concatenated", "Execute, ");
+    }
+    user = user.isEmpty() ? i18nc("@item:intext Access permission, concatenated", "Forbidden") : user.mid(0, user.count() - 2);
+
+    // Set group string
+    QString group;
+    if (info.permission(QFile::ReadGroup)) {
+        group = i18nc("@item:intext Access permission, concatenated", "Read, ");
+    }
+    if (info.permission(QFile::WriteGroup)) {
+        group += i18nc("@item:intext Access permission, concatenated", "Write, ");
+    }
+    if (info.permission(QFile::ExeGroup)) {
+        group += i18nc("@item:intext Access permission, concatenated", "Execute, ");
+    }
+    group = group.isEmpty() ? i18nc("@item:intext Access permission, concatenated", "Forbidden") : group.mid(0, group.count() - 2);
+
+    // Set others string
+    QString others;
+    if (info.permission(QFile::ReadOther)) {
+        others = i18nc("@item:intext Access permission, concatenated", "Read, ");
+    }
+    if (info.permission(QFile::WriteOther)) {
+        others += i18nc("@item:intext Access permission, concatenated", "Write, ");
     }
+    if (info.permission(QFile::ExeOther)) {
+        others += i18nc("@item:intext Access permission, concatenated", "Execute, ");
+    }
+    others = others.isEmpty() ? i18nc("@item:intext Access permission, concatenated", "Forbidden") : others.mid(0, others.count() - 2);
 
-    return groups;
+    const QString groupValue = i18nc("@title:group Files and folders by permissions", "User: %1 | Group: %2 | Others: %3", user, group, others);
+    m_permissionGroupValues.insert(permissionsString, groupValue);
+    return groupValue;
 }
 
 void KFileItemModel::emitSortProgress(int resolvedCount)
@@ -2315,8 +2923,7 @@ void KFileItemModel::emitSortProgress(int resolvedCount)
     if (resolvedCount >= itemCount) {
         m_sortingProgressPercent = -1;
         if (m_resortAllItemsTimer->isActive()) {
-            m_resortAllItemsTimer->stop();
-            resortAllItems();
+            resortChangedItems();
         }
 
         emit directorySortingProgress(100);
@@ -2411,12 +3018,29 @@ QByteArray KFileItemModel::sharedValue(const QByteArray& value)
 
 bool KFileItemModel::isConsistent() const
 {
-    // m_items may contain less items than m_itemData because m_items
-    // is populated lazily, see KFileItemModel::index(const QUrl& url).
-    if (m_items.count() > m_itemData.count()) {
+    // m_items is either empty or contains all items, because it is
+    // populated lazily, see KFileItemModel::index(const QUrl& url).
+    if (!m_items.isEmpty() && m_items.count() != m_itemData.count()) {
         return false;
     }
 
+    // The same applies to m_keyboardSearchIndex, see
+    // KFileItemModel::indexForKeyboardSearch().
+    if (!m_keyboardSearchIndex.isEmpty()) {
+        if (m_keyboardSearchIndex.count() != m_itemData.count()) {
+            qCWarning(DolphinDebug) << "The keyboard search index has a wrong size";
+            return false;
+        }
+        for (int i = 0; i < m_keyboardSearchIndex.count(); ++i) {
+            const KeyboardSearchEntry& entry = m_keyboardSearchIndex.at(i);
+            if (entry.first != entry.second->item.text().toCaseFolded()
+                || (i > 0 && entry.first < m_keyboardSearchIndex.at(i - 1).first)) {
+                qCWarning(DolphinDebug) << "The keyboard search index is corrupt at" << i;
+                return false;
+            }
+        }
+    }
+
     for (int i = 0, iMax = count(); i < iMax; ++i) {
         // Check if m_items and m_itemData are consistent.
         const KFileItem item = fileItem(i);
@@ -2455,5 +3079,22 @@ bool KFileItemModel::isConsistent() const
         }
     }
 
+    // Check if the item counters are consistent.
+    int fileCount = 0;
+    int folderCount = 0;
+    KIO::filesize_t totalFileSize = 0;
+    foreach (const ItemData* itemData, m_itemData) {
+        if (itemData->isDir) {
+            ++folderCount;
+        } else {
+            ++fileCount;
+            totalFileSize += itemData->size;
+        }
+    }
+    if (fileCount != m_fileCount || folderCount != m_folderCount || totalFileSize != m_totalFileSize) {
+        qCWarning(DolphinDebug) << "The item counters are inconsistent:" << m_fileCount << m_folderCount << m_totalFileSize;
+        return false;
+    }
+
     return true;
 }
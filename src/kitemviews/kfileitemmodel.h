@@ -27,9 +27,12 @@
 #include <KFileItem>
 
 #include <QCollator>
+#include <QDate>
 #include <QHash>
+#include <QScopedPointer>
 #include <QSet>
 #include <QUrl>
+#include <QVector>
 
 #include <functional>
 
@@ -84,8 +87,40 @@ public:
 
     int count() const override;
     QHash<QByteArray, QVariant> data(int index) const override;
+
+    /**
+     * @return The value of the role \a role for the item with the index \a index.
+     *         Other than data(int) no copy of the roles of the item is created,
+     *         hence this method should be preferred if only one role is required.
+     */
+    QVariant data(int index, const QByteArray& role) const;
+
+    /**
+     * @return True if a value for the role \a role is available for the item
+     *         with the index \a index.
+     */
+    bool hasData(int index, const QByteArray& role) const;
     bool setData(int index, const QHash<QByteArray, QVariant>& values) override;
 
+    /**
+     * @return Number of files in the model. The number is updated incrementally
+     *         when items are inserted, removed or refreshed, hence the runtime
+     *         complexity of this call is O(1).
+     */
+    int fileCount() const;
+
+    /**
+     * @return Number of folders in the model. The runtime complexity
+     *         of this call is O(1).
+     */
+    int folderCount() const;
+
+    /**
+     * @return Total size of all files in the model. The sizes of folders
+     *         are not included. The runtime complexity of this call is O(1).
+     */
+    KIO::filesize_t totalFileSize() const;
+
     /**
      * Sets a separate sorting with directories first (true) or a mixed
      * sorting of files and directories (false).
@@ -93,6 +128,11 @@ public:
     void setSortDirectoriesFirst(bool dirsFirst);
     bool sortDirectoriesFirst() const;
 
+    /**
+     * Shows or hides the hidden files. The hidden files are always listed
+     * and kept in the model, so toggling this does not require listing
+     * the directories again.
+     */
     void setShowHiddenFiles(bool show);
     bool showHiddenFiles() const;
 
@@ -207,6 +247,13 @@ signals:
      */
     void directoryLoadingStarted();
 
+    /**
+     * Is emitted before the directory is reloaded by refreshDirectory().
+     * Information that has been cached for the current items should not
+     * be used for the reloaded items.
+     */
+    void directoryRefreshing();
+
     /**
      * Is emitted after the loading of a directory has been completed or new
      * items have been inserted to an already loaded directory. Usually
@@ -270,6 +317,13 @@ private slots:
      */
     void resortAllItems();
 
+    /**
+     * Moves the items in m_itemsToResort to their correct positions. If
+     * many items must be moved, resortAllItems() is used instead.
+     * Is invoked by m_resortAllItemsTimer.
+     */
+    void resortChangedItems();
+
     void slotCompleted();
     void slotCanceled();
     void slotItemsAdded(const QUrl& directoryUrl, const KFileItemList& items);
@@ -300,6 +354,42 @@ private:
         KFileItem item;
         QHash<QByteArray, QVariant> values;
         ItemData* parent;
+
+        // Collation sort key for item.text(). It is only used if natural sorting
+        // is enabled and must be reset whenever the text of the item changes.
+        // See KFileItemModel::updateSortKeys().
+        QScopedPointer<QCollatorSortKey> textSortKey;
+
+        // Case folded copy of item.text(), or a null QString if it must be
+        // determined again. See KFileItemModel::caseFoldedText().
+        QString caseFoldedText;
+
+        // Typed copies of the properties of 'item' which are required for each
+        // comparison when sorting and grouping. Reading them from the UDSEntry of
+        // the item or from 'values' is too expensive for large directories.
+        // They must be updated with KFileItemModel::updateTypedValues() whenever
+        // 'item' is changed.
+        bool isDir;
+        int expandedParentsCount;
+        KIO::filesize_t size;
+
+        // Modification, creation or access time of 'item' if the sort role is
+        // one of these times. Only the time which is used for sorting is stored
+        // to keep the memory usage per item low. See KFileItemModel::sortTime().
+        qint64 sortTime;
+
+        // Cached index of the item in m_itemData. It is updated lazily after
+        // items have been inserted, removed or moved and may only be read
+        // with KFileItemModel::indexForItemData().
+        int position;
+
+        // Index the item had when KFileItemModel::applyFilters() hid it, or -1.
+        // It is only used for showing hidden items again in their old order.
+        int filteredPosition;
+
+        // Cached group of the item for the current sort role, or an invalid
+        // QVariant if it must be determined again. See KFileItemModel::groupValue().
+        QVariant groupValue;
     };
 
     enum RemoveItemsBehavior {
@@ -307,9 +397,29 @@ private:
         DeleteItemData
     };
 
+    enum ApplyFiltersBehavior {
+        CheckAllItems,
+        CheckShownItems,   // Only shown items might have to be hidden
+        CheckFilteredItems // Only filtered items might have to be shown
+    };
+
+    /**
+     * @return Index of the item \a itemData, which must be part of m_itemData.
+     *         Updates the outdated ItemData::position values if necessary.
+     *         Complexity: O(1) amortized as long as the model is not changed.
+     */
+    int indexForItemData(ItemData* itemData) const;
+
     void insertItems(QList<ItemData*>& items);
     void removeItems(const KItemRangeList& itemRanges, RemoveItemsBehavior behavior);
 
+    /**
+     * Helper methods for keeping m_keyboardSearchIndex up to date. They
+     * may only be called if the index has been built already.
+     */
+    void insertIntoKeyboardSearchIndex(const QList<ItemData*>& items) const;
+    void removeFromKeyboardSearchIndex(const QSet<const ItemData*>& items);
+
     /**
      * Helper method for insertItems() and removeItems(): Creates
      * a list of ItemData elements based on the given items.
@@ -327,6 +437,25 @@ private:
 
     static int expandedParentsCount(const ItemData* data);
 
+    /**
+     * Updates the typed values of \a itemData from its KFileItem
+     * and its parent. See ItemData for details.
+     */
+    void updateTypedValues(ItemData* itemData) const;
+
+    /**
+     * @return The time of \a item that is used for sorting by the current
+     *         sort role, or -1 if the sort role is not a time.
+     */
+    qint64 sortTime(const KFileItem& item) const;
+
+    /**
+     * Adds the item \a itemData to the counters returned by fileCount(),
+     * folderCount() and totalFileSize() if \a add is true. Otherwise
+     * the item is subtracted from the counters.
+     */
+    void updateItemCounters(const ItemData* itemData, bool add);
+
     void removeExpandedItems();
 
     /**
@@ -336,6 +465,14 @@ private:
      */
     void emitItemsChangedAndTriggerResorting(const KItemRangeList& itemRanges, const QSet<QByteArray>& changedRoles);
 
+    /**
+     * Emits itemsMoved() for the range of items whose positions differ in
+     * m_itemData and \a oldItemData, which contains the same ItemData
+     * pointers in the order before resorting, and updates the cached
+     * positions and the groups accordingly.
+     */
+    void emitItemsMovedAfterResorting(const QList<ItemData*>& oldItemData);
+
     /**
      * Resets all values from m_requestRole to false.
      */
@@ -360,12 +497,6 @@ private:
      */
     static bool isRoleValueNatural(const RoleType roleType);
 
-    /**
-     * @return True if \a a has a KFileItem whose text is 'less than' the one
-     *         of \a b according to QString::operator<(const QString&).
-     */
-    static bool nameLessThan(const ItemData* a, const ItemData* b);
-
     /**
      * @return True if the item-data \a a should be ordered before the item-data
      *         \b. The item-data may have different parent-items.
@@ -387,20 +518,72 @@ private:
 
     int stringCompare(const QString& a, const QString& b, const QCollator& collator) const;
 
-    QList<QPair<int, QVariant> > nameRoleGroups() const;
-    QList<QPair<int, QVariant> > sizeRoleGroups() const;
-    QList<QPair<int, QVariant> > timeRoleGroups(const std::function<QDateTime(const ItemData *)> &fileTimeCb) const;
-    QList<QPair<int, QVariant> > permissionRoleGroups() const;
-    QList<QPair<int, QVariant> > ratingRoleGroups() const;
-    QList<QPair<int, QVariant> > genericStringRoleGroups(const QByteArray& typeForRole) const;
+    /**
+     * Compares the texts of the items \a a and \a b. If natural sorting is enabled
+     * and both items provide a collation sort key, the keys are compared without
+     * locking the collator, which allows parallelMergeSort() to scale with the
+     * number of threads. Otherwise stringCompare() is used as fallback.
+     */
+    int textCompare(const ItemData* a, const ItemData* b, const QCollator& collator) const;
 
     /**
-     * Helper method for all xxxRoleGroups() methods to check whether the
-     * item with the given index is a child-item. A child-item is defined
-     * as item having an expansion-level > 0. All xxxRoleGroups() methods
-     * should skip the grouping if the item is a child-item (although
-     * KItemListView would be capable to show sub-groups in groups this
-     * results in visual clutter for most usecases).
+     * Calculates the missing collation sort keys for the items between \a begin
+     * and \a end. The keys are only calculated if natural sorting is enabled.
+     */
+    void updateSortKeys(const QList<ItemData*>::iterator& begin, const QList<ItemData*>::iterator& end) const;
+
+    /**
+     * Resets the collation sort keys of all items. Must be called if the
+     * settings of m_collator have been changed.
+     */
+    void resetSortKeys();
+
+    /**
+     * @return Value of the group for the sort role that \a itemData belongs to.
+     *         It is determined only once and stored in ItemData::groupValue.
+     */
+    QVariant groupValue(ItemData* itemData) const;
+
+    QString nameGroupValue(const ItemData* itemData) const;
+    QString sizeGroupValue(const ItemData* itemData) const;
+    QString timeGroupValue(const QDateTime& fileTime) const;
+    QString permissionGroupValue(const ItemData* itemData) const;
+
+    /**
+     * Updates the group boundaries in m_groups for the items in the range
+     * [\a firstIndex, \a lastIndex]. The boundaries of all other items
+     * must be correct already. Does nothing if m_groups is empty, because
+     * the groups will be determined for all items by groups() then.
+     */
+    void updateGroups(int firstIndex, int lastIndex) const;
+
+    /**
+     * Helper methods for insertItems() and removeItems(), which adjust the
+     * existing groups instead of determining all groups again.
+     */
+    void updateGroupsAfterInserting(const KItemRangeList& itemRanges);
+    void updateGroupsAfterRemoving(const KItemRangeList& itemRanges);
+
+    /**
+     * Emits groupValuesChanged() if only the values of some groups differ
+     * between m_groups and \a oldGroups, or groupsChanged() if the group
+     * boundaries have changed.
+     */
+    void emitGroupsChanged(const QList<QPair<int, QVariant> >& oldGroups);
+
+    /**
+     * Clears m_groups and the group values of all items. Must be called if
+     * the group values might have changed, e.g., if the sort role has changed.
+     */
+    void resetGroups() const;
+
+    /**
+     * Helper method for groups() to check whether the item with the
+     * given index is a child-item. A child-item is defined as item
+     * having an expansion-level > 0. The grouping should be skipped
+     * if the item is a child-item (although KItemListView would be
+     * capable to show sub-groups in groups this results in visual
+     * clutter for most usecases).
      */
     bool isChildItem(int index) const;
 
@@ -411,9 +594,23 @@ private:
     void emitSortProgress(int resolvedCount);
 
     /**
-     * Applies the filters set through @ref setNameFilter and @ref setMimeTypeFilters.
+     * Applies the filters set through @ref setNameFilter and @ref setMimeTypeFilters,
+     * and hides the hidden files if @ref setShowHiddenFiles is false.
      */
-    void applyFilters();
+    void applyFilters(ApplyFiltersBehavior behavior = CheckAllItems);
+
+    /**
+     * @return For each item of \a items, whether it matches m_filter and is
+     *         not a hidden file that must be hidden. The names of many items
+     *         are matched in several threads.
+     */
+    QVector<bool> matchesFilter(const QList<ItemData*>& items) const;
+
+    /**
+     * @return Case folded text of the item, which is cached in \a itemData.
+     *         May be called from several threads for different items.
+     */
+    static const QString& caseFoldedText(ItemData* itemData);
 
     /**
      * Removes filtered items whose expanded parents have been deleted
@@ -470,6 +667,7 @@ private:
     QCollator m_collator;
     bool m_naturalSorting;
     bool m_sortDirsFirst;
+    bool m_showHiddenFiles;
 
     RoleType m_sortRole;
     int m_sortingProgressPercent; // Value of directorySortingProgress() signal
@@ -477,24 +675,57 @@ private:
 
     QList<ItemData*> m_itemData;
 
-    // m_items is a cache for the method index(const QUrl&). If it contains N
-    // entries, it is guaranteed that these correspond to the first N items in
-    // the model, i.e., that (for every i between 0 and N - 1)
-    // m_items.value(fileItem(i).url()) == i
-    mutable QHash<QUrl, int> m_items;
+    // Counters for fileCount(), folderCount() and totalFileSize()
+    int m_fileCount;
+    int m_folderCount;
+    KIO::filesize_t m_totalFileSize;
+
+    // m_items is a cache for the method index(const QUrl&). It is either empty,
+    // or it contains the ItemData of each item in the model. Unlike indexes,
+    // the ItemData pointers stay valid if items are inserted, removed or moved.
+    // Therefore, m_items only needs to be updated for the changed items and
+    // the URLs of the other items need not be hashed again.
+    mutable QHash<QUrl, ItemData*> m_items;
+
+    // m_keyboardSearchIndex contains the case folded texts of the items,
+    // sorted such that all items starting with a given text are adjacent.
+    // Like m_items, it is either empty or contains all items, and it is
+    // only updated for the changed items. See indexForKeyboardSearch().
+    typedef QPair<QString, ItemData*> KeyboardSearchEntry;
+    mutable QVector<KeyboardSearchEntry> m_keyboardSearchIndex;
+
+    // Sorted indexes of the items whose texts start with m_keyboardSearchPrefix.
+    // They are determined by indexForKeyboardSearch() and cleared whenever
+    // items are inserted, removed, renamed or moved.
+    mutable QString m_keyboardSearchPrefix;
+    mutable QVector<int> m_keyboardSearchMatches;
+
+    // The positions ItemData::position of the first m_validPositionsCount
+    // items are up to date, see KFileItemModel::indexForItemData().
+    mutable int m_validPositionsCount;
 
     KFileItemModelFilter m_filter;
-    QHash<KFileItem, ItemData*> m_filteredItems; // Items that got hidden by KFileItemModel::setNameFilter()
+    QHash<KFileItem, ItemData*> m_filteredItems; // Items that got hidden by KFileItemModel::applyFilters()
 
     bool m_requestRole[RolesCount];
 
     QTimer* m_maximumUpdateIntervalTimer;
     QTimer* m_resortAllItemsTimer;
+    QTimer* m_groupsChangedTimer;
+    QSet<const ItemData*> m_itemsToResort; // Items that might not be at their correct position
     QList<ItemData*> m_pendingItemsToInsert;
 
-    // Cache for KFileItemModel::groups()
+    // Cache for KFileItemModel::groups(). It is kept up to date when items
+    // are inserted, removed or moved, see KFileItemModel::updateGroups().
     mutable QList<QPair<int, QVariant> > m_groups;
 
+    // The date which has been used for the groups of the time roles, and
+    // caches for the expensive group values that are shared by many items.
+    mutable QDate m_groupValuesDate;
+    mutable QHash<QChar, QString> m_nameGroupValues;
+    mutable QHash<QDate, QString> m_timeGroupValues;
+    mutable QHash<QString, QString> m_permissionGroupValues;
+
     // Stores the URLs (key: target url, value: url) of the expanded directories.
     QHash<QUrl, QUrl> m_expandedDirs;
 
@@ -505,7 +736,9 @@ private:
     friend class KFileItemModelRolesUpdater;   // Accesses emitSortProgress() method
     friend class KFileItemModelTest;           // For unit testing
     friend class KFileItemModelBenchmark;      // For unit testing
+    friend class KItemListViewBenchmark;       // For unit testing
     friend class KFileItemListViewTest;        // For unit testing
+    friend class KItemListControllerTest;      // For unit testing
     friend class DolphinPart;                  // Accesses m_dirLister
 };
 
@@ -525,11 +758,6 @@ inline bool KFileItemModel::isRoleValueNatural(RoleType roleType)
             roleType == GroupRole);
 }
 
-inline bool KFileItemModel::nameLessThan(const ItemData* a, const ItemData* b)
-{
-    return a->item.text() < b->item.text();
-}
-
 inline bool KFileItemModel::isChildItem(int index) const
 {
     if (m_itemData.at(index)->parent) {
@@ -22,6 +22,7 @@
 #include "kfileitemmodel.h"
 #include "private/kdirectorycontentscounter.h"
 #include "private/kpixmapmodifier.h"
+#include "private/kthumbnailcache.h"
 
 #include <KConfig>
 #include <KConfigGroup>
@@ -42,7 +43,9 @@
 #include <QApplication>
 #include <QPainter>
 #include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QTimer>
+#include <QtConcurrentRun>
 
 // #define KFILEITEMMODELROLESUPDATER_DEBUG
 
@@ -58,6 +61,61 @@ namespace {
     // Not only the visible area, but up to ReadAheadPages before and after
     // this area will be resolved.
     const int ReadAheadPages = 5;
+
+    // Minimum number of items that are passed to one preview job. Otherwise,
+    // a preview job gets at most one page of items, such that newly visible
+    // items need not wait long for the running job after scrolling.
+    const int MinimumPreviewJobItems = 16;
+
+    /**
+     * Scales the preview \a image to \a iconSize and adds a frame if the
+     * preview has no alpha channel. Is invoked in a worker thread, so it
+     * may only operate on QImage. The result has the device pixel ratio
+     * \a devicePixelRatio and can be converted to a QPixmap without
+     * another format conversion.
+     */
+    QImage processPreview(QImage image, bool hasAlpha, const QSize& iconSize,
+                          qreal devicePixelRatio, bool enlargeSmallPreviews)
+    {
+        if (!hasAlpha
+            && iconSize.width()  > KIconLoader::SizeSmallMedium
+            && iconSize.height() > KIconLoader::SizeSmallMedium) {
+            if (enlargeSmallPreviews) {
+                KPixmapModifier::applyFrame(image, iconSize, devicePixelRatio);
+            } else {
+                // Assure that small previews don't get enlarged. Instead they
+                // should be shown centered within the frame.
+                const QSize contentSize = KPixmapModifier::sizeInsideFrame(iconSize);
+                const bool enlargingRequired = image.width()  < contentSize.width() &&
+                                               image.height() < contentSize.height();
+                if (enlargingRequired) {
+                    QSize frameSize = image.size() / image.devicePixelRatio();
+                    frameSize.scale(iconSize, Qt::KeepAspectRatio);
+
+                    QImage largeFrame(frameSize, QImage::Format_ARGB32_Premultiplied);
+                    largeFrame.fill(Qt::transparent);
+
+                    KPixmapModifier::applyFrame(largeFrame, frameSize, devicePixelRatio);
+
+                    QPainter painter(&largeFrame);
+                    painter.drawImage((largeFrame.width()  - image.width() / image.devicePixelRatio()) / 2,
+                                      (largeFrame.height() - image.height() / image.devicePixelRatio()) / 2,
+                                      image);
+                    painter.end();
+                    image = largeFrame;
+                } else {
+                    // The image must be shrunk as it is too large to fit into
+                    // the available icon size
+                    KPixmapModifier::applyFrame(image, iconSize, devicePixelRatio);
+                }
+            }
+        } else {
+            KPixmapModifier::scale(image, iconSize * devicePixelRatio);
+            image.setDevicePixelRatio(devicePixelRatio);
+        }
+
+        return image;
+    }
 }
 
 KFileItemModelRolesUpdater::KFileItemModelRolesUpdater(KFileItemModel* model, QObject* parent) :
@@ -75,6 +133,7 @@ KFileItemModelRolesUpdater::KFileItemModelRolesUpdater(KFileItemModel* model, QO
     m_firstVisibleIndex(0),
     m_lastVisibleIndex(-1),
     m_maximumVisibleItems(50),
+    m_scrollingBackward(false),
     m_roles(),
     m_resolvableRoles(),
     m_enabledPlugins(),
@@ -82,6 +141,8 @@ KFileItemModelRolesUpdater::KFileItemModelRolesUpdater(KFileItemModel* model, QO
     m_pendingIndexes(),
     m_pendingPreviewItems(),
     m_previewJob(),
+    m_previewJobItems(),
+    m_previewGeneration(0),
     m_recentlyChangedItemsTimer(nullptr),
     m_recentlyChangedItems(),
     m_changedItems(),
@@ -146,6 +207,7 @@ void KFileItemModelRolesUpdater::setIconSize(const QSize& size)
 {
     if (size != m_iconSize) {
         m_iconSize = size;
+        ++m_previewGeneration;
         if (m_state == Paused) {
             m_iconSizeChangedDuringPausing = true;
         } else if (m_previewShown) {
@@ -176,10 +238,21 @@ void KFileItemModelRolesUpdater::setVisibleIndexRange(int index, int count)
         return;
     }
 
+    if (index != m_firstVisibleIndex) {
+        m_scrollingBackward = (index < m_firstVisibleIndex);
+    }
+
     m_firstVisibleIndex = index;
     m_lastVisibleIndex = qMin(index + count - 1, m_model->count() - 1);
 
-    startUpdating();
+    if (m_state == PreviewJobRunning && m_previewJob) {
+        // Killing the preview job would throw away the previews which are
+        // being generated right now. Only the items which are not needed
+        // soon anymore are removed from it.
+        updatePreviewPriorities();
+    } else {
+        startUpdating();
+    }
 }
 
 void KFileItemModelRolesUpdater::setMaximumVisibleItems(int count)
@@ -245,6 +318,7 @@ void KFileItemModelRolesUpdater::setPaused(bool paused)
                                     m_previewChangedDuringPausing;
         const bool resolveAll = updatePreviews || m_rolesChangedDuringPausing;
         if (resolveAll) {
+            ++m_previewGeneration;
             m_finishedItems.clear();
         }
 
@@ -378,6 +452,7 @@ void KFileItemModelRolesUpdater::slotItemsRemoved(const KItemRangeList& itemRang
     if (allItemsRemoved) {
         m_state = Idle;
 
+        ++m_previewGeneration;
         m_finishedItems.clear();
         m_pendingSortRoleItems.clear();
         m_pendingIndexes.clear();
@@ -485,6 +560,7 @@ void KFileItemModelRolesUpdater::slotGotPreview(const KFileItem& item, const QPi
         return;
     }
 
+    m_previewJobItems.remove(item);
     m_changedItems.remove(item);
 
     const int index = m_model->index(item);
@@ -492,44 +568,48 @@ void KFileItemModelRolesUpdater::slotGotPreview(const KFileItem& item, const QPi
         return;
     }
 
-    QPixmap scaledPixmap = pixmap;
+    // Scaling and framing large previews is too expensive for the GUI
+    // thread. It is done by the global thread pool, and only the result
+    // is converted to a pixmap and applied by applyPreview().
+    const QImage image = pixmap.toImage();
+    const bool hasAlpha = pixmap.hasAlpha();
+    const QSize iconSize = m_iconSize;
+    const qreal devicePixelRatio = qApp->devicePixelRatio();
+    const bool enlargeSmallPreviews = m_enlargeSmallPreviews;
+    const int generation = m_previewGeneration;
+
+    QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, item, generation]() {
+        applyPreview(item, watcher->result(), generation);
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(processPreview, image, hasAlpha, iconSize,
+                                         devicePixelRatio, enlargeSmallPreviews));
 
-    if (!pixmap.hasAlpha()
-        && m_iconSize.width()  > KIconLoader::SizeSmallMedium
-        && m_iconSize.height() > KIconLoader::SizeSmallMedium) {
-        if (m_enlargeSmallPreviews) {
-            KPixmapModifier::applyFrame(scaledPixmap, m_iconSize);
-        } else {
-            // Assure that small previews don't get enlarged. Instead they
-            // should be shown centered within the frame.
-            const QSize contentSize = KPixmapModifier::sizeInsideFrame(m_iconSize);
-            const bool enlargingRequired = scaledPixmap.width()  < contentSize.width() &&
-                                           scaledPixmap.height() < contentSize.height();
-            if (enlargingRequired) {
-                QSize frameSize = scaledPixmap.size() / scaledPixmap.devicePixelRatio();
-                frameSize.scale(m_iconSize, Qt::KeepAspectRatio);
-
-                QPixmap largeFrame(frameSize);
-                largeFrame.fill(Qt::transparent);
-
-                KPixmapModifier::applyFrame(largeFrame, frameSize);
-
-                QPainter painter(&largeFrame);
-                painter.drawPixmap((largeFrame.width()  - scaledPixmap.width() / scaledPixmap.devicePixelRatio()) / 2,
-                                   (largeFrame.height() - scaledPixmap.height() / scaledPixmap.devicePixelRatio()) / 2,
-                                   scaledPixmap);
-                scaledPixmap = largeFrame;
-            } else {
-                // The image must be shrunk as it is too large to fit into
-                // the available icon size
-                KPixmapModifier::applyFrame(scaledPixmap, m_iconSize);
-            }
-        }
-    } else {
-        KPixmapModifier::scale(scaledPixmap, m_iconSize * qApp->devicePixelRatio());
-        scaledPixmap.setDevicePixelRatio(qApp->devicePixelRatio());
+    m_finishedItems.insert(item);
+}
+
+void KFileItemModelRolesUpdater::applyPreview(const KFileItem& item, const QImage& image, int generation)
+{
+    if (generation != m_previewGeneration) {
+        // The previews have been invalidated in the meantime, e.g. because
+        // the icon size has been changed. A new preview is requested anyway.
+        return;
+    }
+
+    if (m_state == Paused) {
+        // Assure that the preview is requested again after pausing
+        m_finishedItems.remove(item);
+        return;
+    }
+
+    const int index = m_model->index(item);
+    if (index < 0) {
+        return;
     }
 
+    QPixmap scaledPixmap = QPixmap::fromImage(image);
+
     QHash<QByteArray, QVariant> data = rolesData(item);
 
     const QStringList overlays = data["iconOverlays"].toStringList();
@@ -554,8 +634,6 @@ void KFileItemModelRolesUpdater::slotGotPreview(const KFileItem& item, const QPi
     m_model->setData(index, data);
     connect(m_model, &KFileItemModel::itemsChanged,
             this,    &KFileItemModelRolesUpdater::slotItemsChanged);
-
-    m_finishedItems.insert(item);
 }
 
 void KFileItemModelRolesUpdater::slotPreviewFailed(const KFileItem& item)
@@ -564,6 +642,7 @@ void KFileItemModelRolesUpdater::slotPreviewFailed(const KFileItem& item)
         return;
     }
 
+    m_previewJobItems.remove(item);
     m_changedItems.remove(item);
 
     const int index = m_model->index(item);
@@ -591,6 +670,7 @@ void KFileItemModelRolesUpdater::slotPreviewJobFinished()
     }
 
     m_state = Idle;
+    m_previewJobItems.clear();
 
     if (!m_pendingPreviewItems.isEmpty()) {
         startPreviewJob();
@@ -601,6 +681,17 @@ void KFileItemModelRolesUpdater::slotPreviewJobFinished()
     }
 }
 
+void KFileItemModelRolesUpdater::slotPreviewJobSkipped()
+{
+    // startUpdating() or updateChangedItems() might have started a real
+    // preview job in the meantime, which must not be treated as finished.
+    if (m_previewJob || m_state != PreviewJobRunning) {
+        return;
+    }
+
+    slotPreviewJobFinished();
+}
+
 void KFileItemModelRolesUpdater::resolveNextSortRole()
 {
     if (m_state != ResolvingSortRole) {
@@ -614,7 +705,7 @@ void KFileItemModelRolesUpdater::resolveNextSortRole()
 
         // Continue if the sort role has already been determined for the
         // item, and the item has not been changed recently.
-        if (!m_changedItems.contains(item) && m_model->data(index).contains(m_model->sortRole())) {
+        if (!m_changedItems.contains(item) && m_model->hasData(index, m_model->sortRole())) {
             it = m_pendingSortRoleItems.erase(it);
             continue;
         }
@@ -674,7 +765,7 @@ void KFileItemModelRolesUpdater::resolveNextPendingRoles()
                 disconnect(m_model, &KFileItemModel::itemsChanged,
                            this,    &KFileItemModelRolesUpdater::slotItemsChanged);
                 for (int index = 0; index <= m_model->count(); ++index) {
-                    if (m_model->data(index).contains("iconPixmap")) {
+                    if (m_model->hasData(index, "iconPixmap")) {
                         m_model->setData(index, data);
                     }
                 }
@@ -806,16 +897,7 @@ void KFileItemModelRolesUpdater::startUpdating()
     QList<int> indexes = indexesToResolve();
 
     if (m_previewShown) {
-        m_pendingPreviewItems.clear();
-        m_pendingPreviewItems.reserve(indexes.count());
-
-        foreach (int index, indexes) {
-            const KFileItem item = m_model->fileItem(index);
-            if (!m_finishedItems.contains(item)) {
-                m_pendingPreviewItems.append(item);
-            }
-        }
-
+        updatePendingPreviewItems(indexes);
         startPreviewJob();
     } else {
         m_pendingIndexes = indexes;
@@ -851,12 +933,53 @@ void KFileItemModelRolesUpdater::updateVisibleIcons()
     // remaining items.
 }
 
+void KFileItemModelRolesUpdater::updatePreviewPriorities()
+{
+    Q_ASSERT(m_state == PreviewJobRunning && m_previewJob);
+
+    updateVisibleIcons();
+
+    // Remove the items which are neither visible nor in the read-ahead
+    // range in scroll direction from the running preview job. They are
+    // queued again below if they are still in the background range.
+    int firstPrioritizedIndex;
+    int lastPrioritizedIndex;
+    prioritizedRange(firstPrioritizedIndex, lastPrioritizedIndex);
+
+    QSet<KFileItem>::iterator it = m_previewJobItems.begin();
+    while (it != m_previewJobItems.end()) {
+        const int index = m_model->index(*it);
+        if (index < firstPrioritizedIndex || index > lastPrioritizedIndex) {
+            m_previewJob->removeItem(it->url());
+            it = m_previewJobItems.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Queued items are handled in the new order by the next preview job.
+    updatePendingPreviewItems(indexesToResolve());
+}
+
+void KFileItemModelRolesUpdater::updatePendingPreviewItems(const QList<int>& indexes)
+{
+    m_pendingPreviewItems.clear();
+    m_pendingPreviewItems.reserve(indexes.count());
+
+    foreach (int index, indexes) {
+        const KFileItem item = m_model->fileItem(index);
+        if (!m_finishedItems.contains(item) && !m_previewJobItems.contains(item)) {
+            m_pendingPreviewItems.append(item);
+        }
+    }
+}
+
 void KFileItemModelRolesUpdater::startPreviewJob()
 {
     m_state = PreviewJobRunning;
 
     if (m_pendingPreviewItems.isEmpty()) {
-        QTimer::singleShot(0, this, &KFileItemModelRolesUpdater::slotPreviewJobFinished);
+        QTimer::singleShot(0, this, &KFileItemModelRolesUpdater::slotPreviewJobSkipped);
         return;
     }
 
@@ -871,29 +994,62 @@ void KFileItemModelRolesUpdater::startPreviewJob()
     // KIO::filePreview() will request the MIME-type of all passed items, which (in the
     // worst case) might block the application for several seconds. To prevent such
     // a blocking, we only pass items with known mime type to the preview job.
-    const int count = m_pendingPreviewItems.count();
+    const int count = qMax(m_maximumVisibleItems, MinimumPreviewJobItems);
+    KThumbnailCache* thumbnailCache = KThumbnailCache::instance();
     KFileItemList itemSubSet;
-    itemSubSet.reserve(count);
-
-    if (m_pendingPreviewItems.first().isMimeTypeKnown()) {
-        // Some mime types are known already, probably because they were
-        // determined when loading the icons for the visible items. Start
-        // a preview job for all items at the beginning of the list which
-        // have a known mime type.
-        do {
-            itemSubSet.append(m_pendingPreviewItems.takeFirst());
-        } while (!m_pendingPreviewItems.isEmpty() && m_pendingPreviewItems.first().isMimeTypeKnown());
-    } else {
-        // Determine mime types for MaxBlockTimeout ms, and start a preview
-        // job for the corresponding items.
-        QElapsedTimer timer;
-        timer.start();
 
-        do {
-            const KFileItem item = m_pendingPreviewItems.takeFirst();
-            item.determineMimeType();
-            itemSubSet.append(item);
-        } while (!m_pendingPreviewItems.isEmpty() && timer.elapsed() < MaxBlockTimeout);
+    // The previews of some items might be in the KThumbnailCache already, e.g.,
+    // because the folder has been shown before or is shown in another view.
+    // These previews are applied immediately, and only the other items are
+    // passed to the preview job. If all previews of a batch are cached, the
+    // next batch is checked for up to MaxBlockTimeout ms.
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    do {
+        KFileItemList batch;
+        batch.reserve(qMin(m_pendingPreviewItems.count(), count));
+
+        if (m_pendingPreviewItems.first().isMimeTypeKnown()) {
+            // Some mime types are known already, probably because they were
+            // determined when loading the icons for the visible items. Start
+            // a preview job for all items at the beginning of the list which
+            // have a known mime type.
+            do {
+                batch.append(m_pendingPreviewItems.takeFirst());
+            } while (!m_pendingPreviewItems.isEmpty() && m_pendingPreviewItems.first().isMimeTypeKnown()
+                     && batch.count() < count);
+        } else {
+            // Determine mime types for MaxBlockTimeout ms, and start a preview
+            // job for the corresponding items.
+            QElapsedTimer timer;
+            timer.start();
+
+            do {
+                const KFileItem item = m_pendingPreviewItems.takeFirst();
+                item.determineMimeType();
+                batch.append(item);
+            } while (!m_pendingPreviewItems.isEmpty() && timer.elapsed() < MaxBlockTimeout
+                     && batch.count() < count);
+        }
+
+        QList<QPair<KFileItem, QPixmap> > cachedPreviews;
+        foreach (const KFileItem& item, batch) {
+            const QPixmap pixmap = thumbnailCache->pixmap(item, cacheSize, m_enabledPlugins);
+            if (pixmap.isNull()) {
+                itemSubSet.append(item);
+            } else {
+                cachedPreviews.append(qMakePair(item, pixmap));
+            }
+        }
+
+        for (int i = 0; i < cachedPreviews.count(); ++i) {
+            slotGotPreview(cachedPreviews.at(i).first, cachedPreviews.at(i).second);
+        }
+    } while (itemSubSet.isEmpty() && !m_pendingPreviewItems.isEmpty() && batchTimer.elapsed() < MaxBlockTimeout);
+
+    if (itemSubSet.isEmpty()) {
+        QTimer::singleShot(0, this, &KFileItemModelRolesUpdater::slotPreviewJobSkipped);
+        return;
     }
 
     KIO::PreviewJob* job = new KIO::PreviewJob(itemSubSet, cacheSize, &m_enabledPlugins);
@@ -903,6 +1059,11 @@ void KFileItemModelRolesUpdater::startPreviewJob()
         KJobWidgets::setWindow(job, qApp->activeWindow());
     }
 
+    const QStringList plugins = m_enabledPlugins;
+    connect(job, &KIO::PreviewJob::gotPreview,
+            this, [cacheSize, plugins](const KFileItem& item, const QPixmap& pixmap) {
+        KThumbnailCache::instance()->insert(item, cacheSize, plugins, pixmap);
+    });
     connect(job,  &KIO::PreviewJob::gotPreview,
             this, &KFileItemModelRolesUpdater::slotGotPreview);
     connect(job,  &KIO::PreviewJob::failed,
@@ -911,6 +1072,7 @@ void KFileItemModelRolesUpdater::startPreviewJob()
             this, &KFileItemModelRolesUpdater::slotPreviewJobFinished);
 
     m_previewJob = job;
+    m_previewJobItems = itemSubSet.toSet();
 }
 
 void KFileItemModelRolesUpdater::updateChangedItems()
@@ -994,8 +1156,7 @@ void KFileItemModelRolesUpdater::applySortRole(int index)
 
         data.insert("type", item.mimeComment());
     } else if (m_model->sortRole() == "size" && item.isLocalFile() && item.isDir()) {
-        const QString path = item.localPath();
-        m_directoryContentsCounter->scanDirectory(path);
+        scanDirectory(item);
     } else {
         // Probably the sort role is a baloo role - just determine all roles.
         data = rolesData(item);
@@ -1025,7 +1186,7 @@ bool KFileItemModelRolesUpdater::applyResolvedRoles(int index, ResolveHint hint)
     if (!item.isMimeTypeKnown() || !item.isFinalIconKnown()) {
         item.determineMimeType();
         iconChanged = true;
-    } else if (!m_model->data(index).contains("iconName")) {
+    } else if (!m_model->hasData(index, "iconName")) {
         iconChanged = true;
     }
 
@@ -1056,6 +1217,15 @@ bool KFileItemModelRolesUpdater::applyResolvedRoles(int index, ResolveHint hint)
     return false;
 }
 
+void KFileItemModelRolesUpdater::scanDirectory(const KFileItem& item)
+{
+    const int index = m_model->index(item);
+    const bool isVisible = (index >= m_firstVisibleIndex && index <= m_lastVisibleIndex);
+    m_directoryContentsCounter->scanDirectory(item.localPath(),
+                                              isVisible ? KDirectoryContentsCounter::High
+                                                        : KDirectoryContentsCounter::Normal);
+}
+
 QHash<QByteArray, QVariant> KFileItemModelRolesUpdater::rolesData(const KFileItem& item)
 {
     QHash<QByteArray, QVariant> data;
@@ -1067,8 +1237,7 @@ QHash<QByteArray, QVariant> KFileItemModelRolesUpdater::rolesData(const KFileIte
         if (item.isLocalFile()) {
             // Tell m_directoryContentsCounter that we want to count the items
             // inside the directory. The result will be received in slotDirectoryContentsCountReceived.
-            const QString path = item.localPath();
-            m_directoryContentsCounter->scanDirectory(path);
+            scanDirectory(item);
         } else if (getSizeRole) {
             data.insert("size", -1); // -1 indicates an unknown number of items
         }
@@ -1111,6 +1280,8 @@ void KFileItemModelRolesUpdater::slotOverlaysChanged(const QUrl& url, const QStr
 
 void KFileItemModelRolesUpdater::updateAllPreviews()
 {
+    ++m_previewGeneration;
+
     if (m_state == Paused) {
         m_previewChangedDuringPausing = true;
     } else {
@@ -1130,10 +1301,26 @@ void KFileItemModelRolesUpdater::killPreviewJob()
                    this, &KFileItemModelRolesUpdater::slotPreviewJobFinished);
         m_previewJob->kill();
         m_previewJob = nullptr;
+        m_previewJobItems.clear();
         m_pendingPreviewItems.clear();
     }
 }
 
+int KFileItemModelRolesUpdater::readAheadItemsCount() const
+{
+    // We need a reasonable upper limit for number of items to resolve after
+    // and before the visible range. m_maximumVisibleItems can be quite large
+    // when using Compact View.
+    return qMin(ReadAheadPages * m_maximumVisibleItems, ResolveAllItemsLimit / 2);
+}
+
+void KFileItemModelRolesUpdater::prioritizedRange(int& first, int& last) const
+{
+    const int readAheadItems = readAheadItemsCount();
+    first = m_scrollingBackward ? qMax(0, m_firstVisibleIndex - readAheadItems) : m_firstVisibleIndex;
+    last = m_scrollingBackward ? m_lastVisibleIndex : qMin(m_lastVisibleIndex + readAheadItems, m_model->count() - 1);
+}
+
 QList<int> KFileItemModelRolesUpdater::indexesToResolve() const
 {
     const int count = m_model->count();
@@ -1146,21 +1333,26 @@ QList<int> KFileItemModelRolesUpdater::indexesToResolve() const
         result.append(i);
     }
 
-    // We need a reasonable upper limit for number of items to resolve after
-    // and before the visible range. m_maximumVisibleItems can be quite large
-    // when using Compact View.
-    const int readAheadItems = qMin(ReadAheadPages * m_maximumVisibleItems, ResolveAllItemsLimit / 2);
-
-    // Add items after the visible range.
+    const int readAheadItems = readAheadItemsCount();
     const int endExtendedVisibleRange = qMin(m_lastVisibleIndex + readAheadItems, count - 1);
-    for (int i = m_lastVisibleIndex + 1; i <= endExtendedVisibleRange; ++i) {
-        result.append(i);
-    }
-
-    // Add items before the visible range in reverse order.
     const int beginExtendedVisibleRange = qMax(0, m_firstVisibleIndex - readAheadItems);
-    for (int i = m_firstVisibleIndex - 1; i >= beginExtendedVisibleRange; --i) {
-        result.append(i);
+
+    // Add the items in scroll direction first, because they will
+    // probably become visible next.
+    if (m_scrollingBackward) {
+        for (int i = m_firstVisibleIndex - 1; i >= beginExtendedVisibleRange; --i) {
+            result.append(i);
+        }
+        for (int i = m_lastVisibleIndex + 1; i <= endExtendedVisibleRange; ++i) {
+            result.append(i);
+        }
+    } else {
+        for (int i = m_lastVisibleIndex + 1; i <= endExtendedVisibleRange; ++i) {
+            result.append(i);
+        }
+        for (int i = m_firstVisibleIndex - 1; i >= beginExtendedVisibleRange; --i) {
+            result.append(i);
+        }
     }
 
     // Add items on the last page.
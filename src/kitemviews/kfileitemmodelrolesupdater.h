@@ -33,6 +33,7 @@
 
 class KDirectoryContentsCounter;
 class KFileItemModel;
+class QImage;
 class QPixmap;
 class QTimer;
 class KOverlayIconPlugin;
@@ -164,7 +165,9 @@ private slots:
                              const QByteArray& previous);
 
     /**
-     * Is invoked after a preview has been received successfully.
+     * Is invoked after a preview has been received successfully. Scaling
+     * and framing the preview is done in a worker thread, and the result
+     * is applied by applyPreview().
      * @see startPreviewJob()
      */
     void slotGotPreview(const KFileItem& item, const QPixmap& pixmap);
@@ -183,6 +186,14 @@ private slots:
      */
     void slotPreviewJobFinished();
 
+    /**
+     * Is invoked asynchronously by startPreviewJob() if no preview job has been
+     * started, because no items are pending or all previews have been found in
+     * the KThumbnailCache. Does nothing if a preview job has been started or the
+     * state has been changed in the meantime.
+     */
+    void slotPreviewJobSkipped();
+
     /**
      * Is invoked when one of the KOverlayIconPlugin emit the signal that an overlay has changed
      */
@@ -238,6 +249,27 @@ private:
      */
     void startPreviewJob();
 
+    /**
+     * Is invoked if the visible range changes while a preview job is running.
+     * Removes the items which are neither visible nor in the read-ahead range
+     * in scroll direction from the job, and sorts m_pendingPreviewItems by
+     * the new priorities: visible items, read-ahead items in scroll direction,
+     * and all other items in the background.
+     */
+    void updatePreviewPriorities();
+
+    /**
+     * Sets m_pendingPreviewItems to the items with the indexes \a indexes
+     * which have no preview yet and are not part of the running preview job.
+     */
+    void updatePendingPreviewItems(const QList<int>& indexes);
+
+    /**
+     * Applies the processed preview \a image to the item \a item, unless
+     * the previews have been invalidated since \a generation.
+     */
+    void applyPreview(const KFileItem& item, const QImage& image, int generation);
+
     /**
      * Ensures that icons, previews, and other roles are determined for any
      * items that have been changed.
@@ -258,6 +290,13 @@ private:
     bool applyResolvedRoles(int index, ResolveHint hint);
     QHash<QByteArray, QVariant> rolesData(const KFileItem& item);
 
+    /**
+     * Requests the number of items inside the local directory \a item from
+     * m_directoryContentsCounter. Directories that are visible are counted
+     * before all others.
+     */
+    void scanDirectory(const KFileItem& item);
+
     /**
      * @return The number of items of the path \a path.
      */
@@ -271,6 +310,18 @@ private:
 
     void killPreviewJob();
 
+    /**
+     * @return Number of items after and before the visible range which are
+     *         resolved before the other invisible items.
+     */
+    int readAheadItemsCount() const;
+
+    /**
+     * Sets \a first and \a last to the range of the visible items and the
+     * read-ahead items in scroll direction.
+     */
+    void prioritizedRange(int& first, int& last) const;
+
     QList<int> indexesToResolve() const;
 
 private:
@@ -310,6 +361,7 @@ private:
     int m_firstVisibleIndex;
     int m_lastVisibleIndex;
     int m_maximumVisibleItems;
+    bool m_scrollingBackward; // True if the visible range has been moved to smaller indexes last time
     QSet<QByteArray> m_roles;
     QSet<QByteArray> m_resolvableRoles;
     QStringList m_enabledPlugins;
@@ -327,6 +379,14 @@ private:
 
     KIO::PreviewJob* m_previewJob;
 
+    // Items which have been passed to m_previewJob, but for which
+    // neither a preview has been received nor generating it has failed.
+    QSet<KFileItem> m_previewJobItems;
+
+    // Is increased whenever all previews become invalid. Previews which are
+    // still processed in a worker thread at that time are dropped.
+    int m_previewGeneration;
+
     // When downloading or copying large files, the slot slotItemsChanged()
     // will be called periodically within a quite short delay. To prevent
     // a high CPU-load by generating e.g. previews for each notification, the update
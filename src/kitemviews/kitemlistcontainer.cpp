@@ -23,12 +23,15 @@
 
 #include "kitemlistcontroller.h"
 #include "kitemlistview.h"
+#include "private/kitemlistframetimemonitor.h"
 #include "private/kitemlistsmoothscroller.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QFontMetrics>
 #include <QGraphicsScene>
 #include <QGraphicsView>
+#include <QPaintEvent>
 #include <QScrollBar>
 #include <QStyleOption>
 
@@ -42,13 +45,18 @@ class KItemListContainerViewport : public QGraphicsView
     Q_OBJECT
 
 public:
-    KItemListContainerViewport(QGraphicsScene* scene, QWidget* parent);
+    KItemListContainerViewport(QGraphicsScene* scene, KItemListContainer* parent);
 protected:
     void wheelEvent(QWheelEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    KItemListContainer* m_container;
 };
 
-KItemListContainerViewport::KItemListContainerViewport(QGraphicsScene* scene, QWidget* parent) :
-    QGraphicsView(scene, parent)
+KItemListContainerViewport::KItemListContainerViewport(QGraphicsScene* scene, KItemListContainer* parent) :
+    QGraphicsView(scene, parent),
+    m_container(parent)
 {
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -63,6 +71,23 @@ void KItemListContainerViewport::wheelEvent(QWheelEvent* event)
     event->ignore();
 }
 
+void KItemListContainerViewport::paintEvent(QPaintEvent* event)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QGraphicsView::paintEvent(event);
+
+    // Let the view adapt its animations to the time needed for painting.
+    // Only repaints of the whole viewport are measured, like they happen
+    // during scrolling and animations: Repaints of single items are much
+    // faster and would let the paint time look too optimistic.
+    const KItemListController* controller = m_container->controller();
+    if (controller && controller->view() && event->rect().contains(viewport()->rect())) {
+        controller->view()->frameTimeMonitor()->addPaintTime(timer.nsecsElapsed());
+    }
+}
+
 KItemListContainer::KItemListContainer(KItemListController* controller, QWidget* parent) :
     QAbstractScrollArea(parent),
     m_controller(controller),
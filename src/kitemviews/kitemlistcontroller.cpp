@@ -1139,46 +1139,25 @@ void KItemListController::slotRubberBandChanged()
 
     KItemSet selectedItems;
 
-    // Select all visible items that intersect with the rubberband
-    foreach (const KItemListWidget* widget, m_view->visibleItemListWidgets()) {
-        const int index = widget->index();
-
-        const QRectF widgetRect = m_view->itemRect(index);
-        if (widgetRect.intersects(rubberBandRect)) {
-            const QRectF iconRect = widget->iconRect().translated(widgetRect.topLeft());
-            const QRectF textRect = widget->textRect().translated(widgetRect.topLeft());
-            if (iconRect.intersects(rubberBandRect) || textRect.intersects(rubberBandRect)) {
-                selectedItems.insert(index);
+    // Select all items that intersect with the rubberband. The view only
+    // checks the rows and columns of the layout which are touched by the
+    // rubberband, no matter how many items the model contains. For visible
+    // items, the icon or the text must intersect with the rubberband.
+    foreach (const KItemRange& range, m_view->itemRangesInRect(rubberBandRect)) {
+        for (int index = range.index; index < range.index + range.count; ++index) {
+            const KItemListWidget* widget = m_view->m_visibleItems.value(index);
+            if (widget) {
+                const QRectF widgetRect = m_view->itemRect(index);
+                const QRectF iconRect = widget->iconRect().translated(widgetRect.topLeft());
+                const QRectF textRect = widget->textRect().translated(widgetRect.topLeft());
+                if (!iconRect.intersects(rubberBandRect) && !textRect.intersects(rubberBandRect)) {
+                    continue;
+                }
             }
-        }
-    }
 
-    // Select all invisible items that intersect with the rubberband. Instead of
-    // iterating all items only the area which might be touched by the rubberband
-    // will be checked.
-    const bool increaseIndex = scrollVertical ?
-                               startPos.y() > endPos.y(): startPos.x() > endPos.x();
-
-    int index = increaseIndex ? m_view->lastVisibleIndex() + 1 : m_view->firstVisibleIndex() - 1;
-    bool selectionFinished = false;
-    do {
-        const QRectF widgetRect = m_view->itemRect(index);
-        if (widgetRect.intersects(rubberBandRect)) {
             selectedItems.insert(index);
         }
-
-        if (increaseIndex) {
-            ++index;
-            selectionFinished = (index >= m_model->count()) ||
-                                ( scrollVertical && widgetRect.top()  > rubberBandRect.bottom()) ||
-                                (!scrollVertical && widgetRect.left() > rubberBandRect.right());
-        } else {
-            --index;
-            selectionFinished = (index < 0) ||
-                                ( scrollVertical && widgetRect.bottom() < rubberBandRect.top()) ||
-                                (!scrollVertical && widgetRect.right()  < rubberBandRect.left());
-        }
-    } while (!selectionFinished);
+    }
 
     if (QApplication::keyboardModifiers() & Qt::ControlModifier) {
         // If Control is pressed, the selection state of all items in the rubberband is toggled.
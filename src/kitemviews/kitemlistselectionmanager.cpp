@@ -162,6 +162,53 @@ void KItemListSelectionManager::setSelected(int index, int count, SelectionMode
     }
 }
 
+void KItemListSelectionManager::setSelected(const KItemSet& items, SelectionMode mode)
+{
+    if (items.isEmpty() || !m_model) {
+        return;
+    }
+
+    endAnchoredSelection();
+    const KItemSet previous = selectedItems();
+
+    KItemSet validItems;
+    if (items.first() >= 0 && items.last() < m_model->count()) {
+        validItems = items;
+    } else {
+        const int count = m_model->count();
+        for (int index : items) {
+            if (index >= 0 && index < count) {
+                validItems.insert(index);
+            }
+        }
+    }
+
+    switch (mode) {
+    case Select:
+        m_selectedItems = m_selectedItems + validItems;
+        break;
+
+    case Deselect:
+        // KItemSet offers no difference operator, but the items which are
+        // in m_selectedItems and not in validItems are (A + B) ^ B.
+        m_selectedItems = (m_selectedItems + validItems) ^ validItems;
+        break;
+
+    case Toggle:
+        m_selectedItems = m_selectedItems ^ validItems;
+        break;
+
+    default:
+        Q_ASSERT(false);
+        break;
+    }
+
+    const KItemSet selection = selectedItems();
+    if (selection != previous) {
+        emit selectionChanged(selection, previous);
+    }
+}
+
 void KItemListSelectionManager::clearSelection()
 {
     const KItemSet previous = selectedItems();
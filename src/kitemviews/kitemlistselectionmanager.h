@@ -61,6 +61,12 @@ public:
     bool hasSelection() const;
 
     void setSelected(int index, int count = 1, SelectionMode mode = Select);
+
+    /**
+     * Selects, deselects or toggles all \a items at once, and emits
+     * selectionChanged() only once. Items outside of the model are ignored.
+     */
+    void setSelected(const KItemSet& items, SelectionMode mode = Select);
     /**
      * Equivalent to:
      * clearSelection();
@@ -29,6 +29,7 @@
 #include "kitemlistviewaccessible.h"
 #include "kstandarditemlistwidget.h"
 
+#include "private/kitemlistframetimemonitor.h"
 #include "private/kitemlistheaderwidget.h"
 #include "private/kitemlistrubberband.h"
 #include "private/kitemlistsizehintresolver.h"
@@ -48,6 +49,17 @@ namespace {
 
     // Delay in ms for triggering the next autoscroll
     const int RepeatingAutoScrollDelay = 1000 / 60;
+
+    // Maximum number of times the exact size hints for the visible items are
+    // resolved in doLayout(). Resolving size hints may change the visible range.
+    const int MaximumSizeHintResolvingPasses = 3;
+
+    // Number of items and maximum time in ms used for replacing estimated
+    // size hints by exact ones in one step while the application is idle.
+    // The batches are large enough that the widget informant can measure
+    // them with several threads.
+    const int SizeHintRefinementItemCount = 1000;
+    const int SizeHintRefinementTimeLimit = 10;
 }
 
 #ifndef QT_NO_ACCESSIBILITY
@@ -86,7 +98,9 @@ KItemListView::KItemListView(QGraphicsWidget* parent) :
     m_sizeHintResolver(nullptr),
     m_layouter(nullptr),
     m_animation(nullptr),
+    m_frameTimeMonitor(nullptr),
     m_layoutTimer(nullptr),
+    m_sizeHintRefinementTimer(nullptr),
     m_oldScrollOffset(0),
     m_oldMaximumScrollOffset(0),
     m_oldItemOffset(0),
@@ -110,11 +124,18 @@ KItemListView::KItemListView(QGraphicsWidget* parent) :
     connect(m_animation, &KItemListViewAnimation::finished,
             this, &KItemListView::slotAnimationFinished);
 
+    m_frameTimeMonitor = new KItemListFrameTimeMonitor();
+
     m_layoutTimer = new QTimer(this);
     m_layoutTimer->setInterval(300);
     m_layoutTimer->setSingleShot(true);
     connect(m_layoutTimer, &QTimer::timeout, this, &KItemListView::slotLayoutTimerFinished);
 
+    m_sizeHintRefinementTimer = new QTimer(this);
+    m_sizeHintRefinementTimer->setInterval(0);
+    m_sizeHintRefinementTimer->setSingleShot(true);
+    connect(m_sizeHintRefinementTimer, &QTimer::timeout, this, &KItemListView::slotSizeHintRefinementTimerFinished);
+
     m_rubberBand = new KItemListRubberBand(this);
     connect(m_rubberBand, &KItemListRubberBand::activationChanged, this, &KItemListView::slotRubberBandActivationChanged);
 
@@ -142,6 +163,9 @@ KItemListView::~KItemListView()
 
     delete m_sizeHintResolver;
     m_sizeHintResolver = nullptr;
+
+    delete m_frameTimeMonitor;
+    m_frameTimeMonitor = nullptr;
 }
 
 void KItemListView::setScrollOffset(qreal offset)
@@ -394,20 +418,25 @@ qreal KItemListView::verticalPageStep() const
 
 int KItemListView::itemAt(const QPointF& pos) const
 {
-    QHashIterator<int, KItemListWidget*> it(m_visibleItems);
-    while (it.hasNext()) {
-        it.next();
-
-        const KItemListWidget* widget = it.value();
+    // The item rectangles do not overlap, so only the widget of the item
+    // whose rectangle contains pos must be checked.
+    const int index = m_layouter->indexAt(pos);
+    const KItemListWidget* widget = m_visibleItems.value(index);
+    if (widget) {
         const QPointF mappedPos = widget->mapFromItem(this, pos);
         if (widget->contains(mappedPos)) {
-            return it.key();
+            return index;
         }
     }
 
     return -1;
 }
 
+KItemRangeList KItemListView::itemRangesInRect(const QRectF& rect) const
+{
+    return m_layouter->itemRangesInRect(rect);
+}
+
 bool KItemListView::isAboveSelectionToggle(int index, const QPointF& pos) const
 {
     if (!m_enabledSelectionToggles) {
@@ -461,9 +490,9 @@ int KItemListView::lastVisibleIndex() const
     return m_layouter->lastVisibleIndex();
 }
 
-void KItemListView::calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint) const
+void KItemListView::calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex) const
 {
-    widgetCreator()->calculateItemSizeHints(logicalHeightHints, logicalWidthHint, this);
+    widgetCreator()->calculateItemSizeHints(logicalHeightHints, logicalWidthHint, firstIndex, lastIndex, this);
 }
 
 void KItemListView::setSupportsItemExpanding(bool supportsExpanding)
@@ -648,6 +677,11 @@ void KItemListView::editRole(int index, const QByteArray& role)
             widget, &KStandardItemListWidget::finishRoleEditing);
 }
 
+KItemListFrameTimeMonitor* KItemListView::frameTimeMonitor() const
+{
+    return m_frameTimeMonitor;
+}
+
 void KItemListView::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
     QGraphicsWidget::paint(painter, option, widget);
@@ -1004,7 +1038,7 @@ void KItemListView::slotItemsInserted(const KItemRangeList& itemRanges)
         beginTransaction();
     }
 
-    m_layouter->markAsDirty();
+    m_layouter->itemsInserted(itemRanges);
 
     m_sizeHintResolver->itemsInserted(itemRanges);
 
@@ -1115,10 +1149,16 @@ void KItemListView::slotItemsRemoved(const KItemRangeList& itemRanges)
         beginTransaction();
     }
 
-    m_layouter->markAsDirty();
+    m_layouter->itemsRemoved(itemRanges);
 
     m_sizeHintResolver->itemsRemoved(itemRanges);
 
+    if (m_model->count() == 0) {
+        // All items have been removed, e.g. because another directory is
+        // loaded. The times measured for the old items don't apply anymore.
+        m_frameTimeMonitor->reset();
+    }
+
     for (int i = itemRanges.count() - 1; i >= 0; --i) {
         const KItemRange& range = itemRanges[i];
         const int index = range.index;
@@ -1220,7 +1260,7 @@ void KItemListView::slotItemsRemoved(const KItemRangeList& itemRanges)
 void KItemListView::slotItemsMoved(const KItemRange& itemRange, const QList<int>& movedToIndexes)
 {
     m_sizeHintResolver->itemsMoved(itemRange, movedToIndexes);
-    m_layouter->markAsDirty();
+    m_layouter->markItemsAsDirty(itemRange.index, itemRange.index + itemRange.count - 1);
 
     if (m_controller) {
         m_controller->selectionManager()->itemsMoved(itemRange, movedToIndexes);
@@ -1255,7 +1295,7 @@ void KItemListView::slotItemsChanged(const KItemRangeList& itemRanges,
 
         if (updateSizeHints) {
             m_sizeHintResolver->itemsChanged(index, count, roles);
-            m_layouter->markAsDirty();
+            m_layouter->markItemsAsDirty(index, index + count - 1);
 
             if (!m_layoutTimer->isActive()) {
                 m_layoutTimer->start();
@@ -1292,6 +1332,22 @@ void KItemListView::slotGroupsChanged()
     updateSiblingsInformation();
 }
 
+void KItemListView::slotGroupValuesChanged(const KItemRangeList& itemRanges)
+{
+    if (!m_grouped) {
+        return;
+    }
+
+    // The first items of all groups are unchanged, so only the
+    // visible headers of the changed groups must be updated.
+    foreach (const KItemRange& range, itemRanges) {
+        KItemListWidget* widget = m_visibleItems.value(range.index);
+        if (widget) {
+            updateGroupHeaderForWidget(widget);
+        }
+    }
+}
+
 void KItemListView::slotGroupedSortingChanged(bool current)
 {
     m_grouped = current;
@@ -1420,6 +1476,35 @@ void KItemListView::slotLayoutTimerFinished()
     doLayout(Animation);
 }
 
+void KItemListView::slotSizeHintRefinementTimerFinished()
+{
+    if (!m_model) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool sizeHintsChanged = false;
+    while (m_sizeHintResolver->hasEstimatedSizeHints() && timer.elapsed() < SizeHintRefinementTimeLimit) {
+        const KItemRange changedRange = m_sizeHintResolver->resolveEstimatedSizeHints(SizeHintRefinementItemCount);
+        if (changedRange.count > 0) {
+            m_layouter->markItemsAsDirty(changedRange.index, changedRange.index + changedRange.count - 1);
+            sizeHintsChanged = true;
+        }
+    }
+
+    if (sizeHintsChanged) {
+        if (!m_layoutTimer->isActive()) {
+            m_layoutTimer->start();
+        }
+    }
+
+    if (m_sizeHintResolver->hasEstimatedSizeHints()) {
+        m_sizeHintRefinementTimer->start();
+    }
+}
+
 void KItemListView::slotRubberBandPosChanged()
 {
     update();
@@ -1595,6 +1680,8 @@ void KItemListView::setModel(KItemModelBase* model)
                    this,    &KItemListView::slotItemsMoved);
         disconnect(m_model, &KItemModelBase::groupsChanged,
                    this,    &KItemListView::slotGroupsChanged);
+        disconnect(m_model, &KItemModelBase::groupValuesChanged,
+                   this,    &KItemListView::slotGroupValuesChanged);
         disconnect(m_model, &KItemModelBase::groupedSortingChanged,
                    this,    &KItemListView::slotGroupedSortingChanged);
         disconnect(m_model, &KItemModelBase::sortOrderChanged,
@@ -1605,6 +1692,9 @@ void KItemListView::setModel(KItemModelBase* model)
         m_sizeHintResolver->itemsRemoved(KItemRangeList() << KItemRange(0, m_model->count()));
     }
 
+    // The times measured for the previous model don't apply to the new one
+    m_frameTimeMonitor->reset();
+
     m_model = model;
     m_layouter->setModel(model);
     m_grouped = model->groupedSorting();
@@ -1620,6 +1710,8 @@ void KItemListView::setModel(KItemModelBase* model)
                 this,    &KItemListView::slotItemsMoved);
         connect(m_model, &KItemModelBase::groupsChanged,
                 this,    &KItemListView::slotGroupsChanged);
+        connect(m_model, &KItemModelBase::groupValuesChanged,
+                this,    &KItemListView::slotGroupValuesChanged);
         connect(m_model, &KItemModelBase::groupedSortingChanged,
                 this,    &KItemListView::slotGroupedSortingChanged);
         connect(m_model, &KItemModelBase::sortOrderChanged,
@@ -1666,6 +1758,27 @@ void KItemListView::doLayout(LayoutAnimationHint hint, int changedIndex, int cha
         return;
     }
 
+    QElapsedTimer layoutTimer;
+    layoutTimer.start();
+
+    // Assure that the visible items and a read-ahead window of the same size before
+    // and after them use exact size hints. All other items use estimated size hints
+    // until they get resolved by slotSizeHintRefinementTimerFinished().
+    for (int pass = 0; pass < MaximumSizeHintResolvingPasses; ++pass) {
+        const int lastIndex = m_layouter->lastVisibleIndex();
+        const int readAheadCount = lastIndex - firstVisibleIndex + 1;
+        const KItemRange changedRange = m_sizeHintResolver->resolveRange(firstVisibleIndex - readAheadCount, lastIndex + readAheadCount);
+        if (changedRange.count <= 0) {
+            break;
+        }
+        m_layouter->markItemsAsDirty(changedRange.index, changedRange.index + changedRange.count - 1);
+        firstVisibleIndex = m_layouter->firstVisibleIndex();
+    }
+
+    if (m_sizeHintResolver->hasEstimatedSizeHints() && !m_sizeHintRefinementTimer->isActive()) {
+        m_sizeHintRefinementTimer->start();
+    }
+
     // Do a sanity check of the scroll-offset property: When properties of the itemlist-view have been changed
     // it might be possible that the maximum offset got changed too. Assure that the full visible range
     // is still shown if the maximum offset got decreased.
@@ -1687,7 +1800,11 @@ void KItemListView::doLayout(LayoutAnimationHint hint, int changedIndex, int cha
     // Assure that for each visible item a KItemListWidget is available. KItemListWidget
     // instances from invisible items are reused. If no reusable items are
     // found then new KItemListWidget instances get created.
-    const bool animate = (hint == Animation);
+    // Animations are turned off or shortened if the view is too slow
+    // to show them smoothly.
+    const bool animate = (hint == Animation) &&
+                         m_frameTimeMonitor->animationPolicy() != KItemListFrameTimeMonitor::NoAnimations;
+    m_animation->setDuration(m_frameTimeMonitor->animationDuration());
     for (int i = firstVisibleIndex; i <= lastVisibleIndex; ++i) {
         bool applyNewPos = true;
         bool wasHidden = false;
@@ -1821,6 +1938,8 @@ void KItemListView::doLayout(LayoutAnimationHint hint, int changedIndex, int cha
         }
     }
 
+    m_frameTimeMonitor->addLayoutTime(layoutTimer.nsecsElapsed());
+
     emitOffsetChanges();
 }
 
@@ -2093,7 +2212,7 @@ void KItemListView::recycleGroupHeaderForWidget(KItemListWidget* widget)
 void KItemListView::updateVisibleGroupHeaders()
 {
     Q_ASSERT(m_grouped);
-    m_layouter->markAsDirty();
+    m_layouter->markGroupsAsDirty();
 
     QHashIterator<int, KItemListWidget*> it(m_visibleItems);
     while (it.hasNext()) {
@@ -2405,6 +2524,10 @@ bool KItemListView::changesItemGridLayout(const QSizeF& newGridSize,
 
 bool KItemListView::animateChangedItemCount(int changedItemCount) const
 {
+    if (m_frameTimeMonitor->animationPolicy() == KItemListFrameTimeMonitor::NoAnimations) {
+        return false;
+    }
+
     if (m_itemSize.isEmpty()) {
         // We have only columns or only rows, but no grid: An animation is usually
         // welcome when inserting or removing items.
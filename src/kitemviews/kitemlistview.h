@@ -33,6 +33,7 @@
 #include <QSet>
 
 class KItemListController;
+class KItemListFrameTimeMonitor;
 class KItemListGroupHeaderCreatorBase;
 class KItemListHeader;
 class KItemListHeaderWidget;
@@ -192,15 +193,15 @@ public:
     int lastVisibleIndex() const;
 
     /**
-     * Calculates the required size for all items in the model.
-     * It might be larger than KItemListView::itemSize().
+     * Calculates the required size for the items in the range [\a firstIndex, \a lastIndex]
+     * that have no size yet. It might be larger than KItemListView::itemSize().
      * In this case the layout grid will be stretched to assure an
      * unclipped item.
      *
      * @note the logical height (width) is actually the
      * width (height) if the scroll orientation is Qt::Vertical!
      */
-    void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint) const;
+    void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex) const;
 
     /**
      * If set to true, items having child-items can be expanded to show the child-items as
@@ -220,6 +221,14 @@ public:
      */
     QRectF itemRect(int index) const;
 
+    /**
+     * @return Ranges of all items whose rectangles (see itemRect()) intersect
+     *         with \a rect, which is relative to the top/left of the currently
+     *         visible area. Contrary to itemAt(), also invisible items are
+     *         considered.
+     */
+    KItemRangeList itemRangesInRect(const QRectF& rect) const;
+
     /**
      * @return The context rectangle of the item relative to the top/left of
      *         the currently visible area (see KItemListView::offset()). The
@@ -279,6 +288,14 @@ public:
      */
     void editRole(int index, const QByteArray& role);
 
+    /**
+     * @return Monitor for the time needed to paint and layout the view. It
+     *         decides whether inserting, removing and moving items is
+     *         animated. KItemListContainer reports the paint times, and the
+     *         measured times can be read for debugging and benchmarking.
+     */
+    KItemListFrameTimeMonitor* frameTimeMonitor() const;
+
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
 
 signals:
@@ -396,6 +413,7 @@ protected slots:
     virtual void slotItemsChanged(const KItemRangeList& itemRanges,
                                   const QSet<QByteArray>& roles);
     virtual void slotGroupsChanged();
+    virtual void slotGroupValuesChanged(const KItemRangeList& itemRanges);
 
     virtual void slotGroupedSortingChanged(bool current);
     virtual void slotSortOrderChanged(Qt::SortOrder current, Qt::SortOrder previous);
@@ -408,6 +426,13 @@ private slots:
                                KItemListViewAnimation::AnimationType type);
     void slotLayoutTimerFinished();
 
+    /**
+     * Replaces estimated size hints by exact ones for a limited
+     * number of items and restarts m_sizeHintRefinementTimer if
+     * estimated size hints are left.
+     */
+    void slotSizeHintRefinementTimerFinished();
+
     void slotRubberBandPosChanged();
     void slotRubberBandActivationChanged(bool active);
 
@@ -731,8 +756,10 @@ private:
     KItemListSizeHintResolver* m_sizeHintResolver;
     KItemListViewLayouter* m_layouter;
     KItemListViewAnimation* m_animation;
+    KItemListFrameTimeMonitor* m_frameTimeMonitor;
 
     QTimer* m_layoutTimer; // Triggers an asynchronous doLayout() call.
+    QTimer* m_sizeHintRefinementTimer; // Resolves estimated size hints while being idle.
     qreal m_oldScrollOffset;
     qreal m_oldMaximumScrollOffset;
     qreal m_oldItemOffset;
@@ -760,6 +787,7 @@ private:
     friend class KItemListHeader;    // Accesses m_headerWidget
     friend class KItemListController;
     friend class KItemListControllerTest;
+    friend class KItemListViewBenchmark; // Accesses m_layouter, m_sizeHintResolver and slotSizeHintRefinementTimerFinished()
     friend class KItemListViewAccessible;
     friend class KItemListAccessibleCell;
 };
@@ -803,7 +831,7 @@ public:
 
     virtual void recycle(KItemListWidget* widget);
 
-    virtual void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const = 0;
+    virtual void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const = 0;
 
     virtual qreal preferredRoleColumnWidth(const QByteArray& role,
                                            int index,
@@ -822,7 +850,7 @@ public:
 
     KItemListWidget* create(KItemListView* view) override;
 
-    void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const override;
+    void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const override;
 
     qreal preferredRoleColumnWidth(const QByteArray& role,
                                            int index,
@@ -855,9 +883,9 @@ KItemListWidget* KItemListWidgetCreator<T>::create(KItemListView* view)
 }
 
 template<class T>
-void KItemListWidgetCreator<T>::calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const
+void KItemListWidgetCreator<T>::calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const
 {
-    return m_informant->calculateItemSizeHints(logicalHeightHints, logicalWidthHint, view);
+    return m_informant->calculateItemSizeHints(logicalHeightHints, logicalWidthHint, firstIndex, lastIndex, view);
 }
 
 template<class T>
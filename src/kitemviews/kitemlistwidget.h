@@ -47,7 +47,12 @@ public:
     KItemListWidgetInformant();
     virtual ~KItemListWidgetInformant();
 
-    virtual void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const = 0;
+    /**
+     * Calculates the logical heights of the items in the range [\a firstIndex, \a lastIndex]
+     * that have no height yet (i.e. a height of 0.0) and the logical width of all items.
+     * The heights of items outside the range must not be changed.
+     */
+    virtual void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const = 0;
 
     virtual qreal preferredRoleColumnWidth(const QByteArray& role,
                                            int index,
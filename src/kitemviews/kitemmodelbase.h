@@ -248,6 +248,14 @@ signals:
      */
     void groupsChanged();
 
+    /**
+     * Is emitted instead of groupsChanged() if only the values of some groups
+     * have changed, but not the first items of the groups. Each range in
+     * \a itemRanges contains the items of a changed group, i.e., the group
+     * headers of the first items must be updated, but no relayout is required.
+     */
+    void groupValuesChanged(const KItemRangeList& itemRanges);
+
     void groupedSortingChanged(bool current);
     void sortRoleChanged(const QByteArray& current, const QByteArray& previous);
     void sortOrderChanged(Qt::SortOrder current, Qt::SortOrder previous);
@@ -19,8 +19,33 @@
 
 #include "kitemset.h"
 
+#include <limits>
+
+namespace {
+    // Sets with fewer ranges always use the range layout.
+    const int MinimumRangeCountForBitmap = 64;
+
+    // Ensures that all bit positions fit into an int.
+    const qint64 MaximumBitmapWordCount = std::numeric_limits<int>::max() / 64;
+}
 
 KItemSet::iterator KItemSet::insert(int i)
+{
+    if (m_layout == BitmapLayout) {
+        return insertIntoBitmap(i);
+    }
+
+    const int rangeCount = m_itemRanges.count();
+    const iterator it = insertIntoRanges(i);
+    if (m_itemRanges.count() > rangeCount && rangesExceedBitmapSize()) {
+        convertToBitmap();
+        return iterator(this, i - m_bitmapOffset);
+    }
+
+    return it;
+}
+
+KItemSet::iterator KItemSet::insertIntoRanges(int i)
 {
     if (m_itemRanges.empty()) {
         m_itemRanges.push_back(KItemRange(i, 1));
@@ -108,8 +133,59 @@ KItemSet::iterator KItemSet::insert(int i)
     }
 }
 
+KItemSet::iterator KItemSet::insertIntoBitmap(int i)
+{
+    qint64 position = qint64(i) - m_bitmapOffset;
+
+    if (position < 0 || position >= bitmapEnd()) {
+        // Grow the bitmap, unless it would need more memory than storing
+        // each item in a separate range.
+        const int offset = qMin(m_bitmapOffset, alignedBitmapOffset(i));
+        const qint64 bitmapLast = qint64(m_bitmapOffset) + bitmapEnd() - 1;
+        const qint64 newWordCount = bitmapWordCount(offset, qMax(bitmapLast, qint64(i)));
+        if (newWordCount > m_bitmapCount || newWordCount > MaximumBitmapWordCount) {
+            convertToRanges();
+            return insert(i);
+        }
+
+        if (offset < m_bitmapOffset) {
+            m_bitmap.insert(0, (m_bitmapOffset - offset) / BitsPerWord, quint64(0));
+            m_bitmapOffset = offset;
+        }
+        if (newWordCount > m_bitmap.count()) {
+            m_bitmap.resize(int(newWordCount));
+        }
+        Q_ASSERT(m_bitmap.count() == newWordCount);
+
+        position = qint64(i) - m_bitmapOffset;
+    }
+
+    quint64& word = m_bitmap[position / BitsPerWord];
+    const quint64 mask = quint64(1) << (position % BitsPerWord);
+    if (!(word & mask)) {
+        word |= mask;
+        ++m_bitmapCount;
+    }
+
+    return iterator(this, position);
+}
+
 KItemSet::iterator KItemSet::erase(iterator it)
 {
+    if (m_layout == BitmapLayout) {
+        Q_ASSERT(it.m_set == this);
+        const int position = it.m_offset;
+        m_bitmap[position / BitsPerWord] &= ~(quint64(1) << (position % BitsPerWord));
+        --m_bitmapCount;
+
+        if (m_bitmapCount == 0) {
+            clear();
+            return end();
+        }
+
+        return iterator(this, nextBitmapPosition(position + 1));
+    }
+
     KItemRangeList::iterator rangeIt = it.m_rangeIt;
 
     if (it.m_offset == 0) {
@@ -143,6 +219,17 @@ KItemSet::iterator KItemSet::erase(iterator it)
 
 KItemSet KItemSet::operator+(const KItemSet& other) const
 {
+    if (m_layout == BitmapLayout || other.m_layout == BitmapLayout) {
+        if (other.isEmpty()) {
+            return *this;
+        } else if (isEmpty()) {
+            return other;
+        } else if (canCombineAsBitmap(other)) {
+            return combinedBitmap(other, [](quint64& word, quint64 mask) { word |= mask; });
+        }
+        return withRangeLayout() + other.withRangeLayout();
+    }
+
     KItemSet sum;
 
     KItemRangeList::const_iterator it1 = m_itemRanges.constBegin();
@@ -190,6 +277,7 @@ KItemSet KItemSet::operator+(const KItemSet& other) const
         }
     }
 
+    sum.updateLayout();
     return sum;
 }
 
@@ -197,6 +285,17 @@ KItemSet KItemSet::operator^(const KItemSet& other) const
 {
     // We are looking for all ints which are either in *this or in other,
     // but not in both.
+    if (m_layout == BitmapLayout || other.m_layout == BitmapLayout) {
+        if (other.isEmpty()) {
+            return *this;
+        } else if (isEmpty()) {
+            return other;
+        } else if (canCombineAsBitmap(other)) {
+            return combinedBitmap(other, [](quint64& word, quint64 mask) { word ^= mask; });
+        }
+        return withRangeLayout() ^ other.withRangeLayout();
+    }
+
     KItemSet result;
 
     // When we go through all integers from INT_MIN to INT_MAX and start
@@ -266,11 +365,24 @@ KItemSet KItemSet::operator^(const KItemSet& other) const
         }
     }
 
+    result.updateLayout();
     return result;
 }
 
 bool KItemSet::isValid() const
 {
+    if (m_layout == BitmapLayout) {
+        if (!m_itemRanges.isEmpty() || m_bitmap.isEmpty() || m_bitmapOffset % BitsPerWord != 0) {
+            return false;
+        }
+
+        int count = 0;
+        foreach (quint64 word, m_bitmap) {
+            count += qPopulationCount(word);
+        }
+        return count > 0 && count == m_bitmapCount;
+    }
+
     const KItemRangeList::const_iterator begin = m_itemRanges.constBegin();
     const KItemRangeList::const_iterator end = m_itemRanges.constEnd();
 
@@ -343,3 +455,234 @@ KItemRangeList::const_iterator KItemSet::constRangeForItem(int i) const
 
     return end;
 }
+
+bool KItemSet::hasSameItems(const KItemSet& other) const
+{
+    if (count() != other.count()) {
+        return false;
+    }
+
+    const_iterator it = constBegin();
+    const const_iterator end = constEnd();
+    const_iterator otherIt = other.constBegin();
+    while (it != end) {
+        if (*it != *otherIt) {
+            return false;
+        }
+        ++it;
+        ++otherIt;
+    }
+
+    return true;
+}
+
+void KItemSet::updateLayout()
+{
+    if (m_layout == RangeLayout) {
+        if (rangesExceedBitmapSize()) {
+            convertToBitmap();
+        }
+    } else {
+        const int rangeCount = bitmapRangeCount();
+        if (rangeCount < MinimumRangeCountForBitmap || 2 * rangeCount < m_bitmap.count()) {
+            convertToRanges();
+        }
+    }
+}
+
+bool KItemSet::rangesExceedBitmapSize() const
+{
+    Q_ASSERT(m_layout == RangeLayout);
+
+    const int rangeCount = m_itemRanges.count();
+    if (rangeCount < MinimumRangeCountForBitmap) {
+        return false;
+    }
+
+    const qint64 wordCount = bitmapWordCount(alignedBitmapOffset(first()), last());
+    return rangeCount > wordCount && wordCount <= MaximumBitmapWordCount;
+}
+
+void KItemSet::convertToBitmap()
+{
+    Q_ASSERT(m_layout == RangeLayout && !m_itemRanges.isEmpty());
+
+    const int offset = alignedBitmapOffset(first());
+    QVector<quint64> bitmap(int(bitmapWordCount(offset, last())), 0);
+    quint64* words = bitmap.data();
+
+    int count = 0;
+    foreach (const KItemRange& range, m_itemRanges) {
+        applyToBits(words, range.index - offset, range.count, [](quint64& word, quint64 mask) { word |= mask; });
+        count += range.count;
+    }
+
+    m_itemRanges.clear();
+    m_bitmap = bitmap;
+    m_bitmapOffset = offset;
+    m_bitmapCount = count;
+    m_layout = BitmapLayout;
+}
+
+void KItemSet::convertToRanges()
+{
+    Q_ASSERT(m_layout == BitmapLayout);
+
+    KItemRangeList itemRanges;
+    const int end = bitmapEnd();
+    int position = nextBitmapPosition(0);
+    while (position < end) {
+        const int rangeEnd = nextUnsetBitmapPosition(position);
+        itemRanges.append(KItemRange(m_bitmapOffset + position, rangeEnd - position));
+        position = nextBitmapPosition(rangeEnd);
+    }
+
+    clear();
+    m_itemRanges = itemRanges;
+}
+
+KItemSet KItemSet::withRangeLayout() const
+{
+    KItemSet result(*this);
+    if (result.m_layout == BitmapLayout) {
+        result.convertToRanges();
+    }
+    return result;
+}
+
+bool KItemSet::canCombineAsBitmap(const KItemSet& other) const
+{
+    Q_ASSERT(!isEmpty() && !other.isEmpty());
+
+    // If the items are spread so sparsely that the bitmap for the result
+    // needs more words than both sets have items, the ranges are cheaper.
+    const int offset = alignedBitmapOffset(qMin(first(), other.first()));
+    const qint64 wordCount = bitmapWordCount(offset, qMax(last(), other.last()));
+    return wordCount <= qint64(count()) + other.count() && wordCount <= MaximumBitmapWordCount;
+}
+
+template<typename Operation>
+KItemSet KItemSet::combinedBitmap(const KItemSet& other, Operation operation) const
+{
+    const int offset = alignedBitmapOffset(qMin(first(), other.first()));
+
+    KItemSet result;
+    result.m_bitmap.fill(0, int(bitmapWordCount(offset, qMax(last(), other.last()))));
+    result.m_bitmapOffset = offset;
+    result.m_layout = BitmapLayout;
+
+    result.applyToBitmap(*this, operation);
+    result.applyToBitmap(other, operation);
+
+    const quint64* words = result.m_bitmap.constData();
+    const int wordCount = result.m_bitmap.count();
+    int count = 0;
+    for (int i = 0; i < wordCount; ++i) {
+        count += qPopulationCount(words[i]);
+    }
+    result.m_bitmapCount = count;
+
+    if (count == 0) {
+        result.clear();
+    } else {
+        result.updateLayout();
+    }
+
+    return result;
+}
+
+template<typename Operation>
+void KItemSet::applyToBitmap(const KItemSet& set, Operation operation)
+{
+    Q_ASSERT(m_layout == BitmapLayout);
+
+    quint64* words = m_bitmap.data();
+
+    if (set.m_layout == RangeLayout) {
+        foreach (const KItemRange& range, set.m_itemRanges) {
+            applyToBits(words, range.index - m_bitmapOffset, range.count, operation);
+        }
+    } else {
+        // Both bitmap offsets are multiples of BitsPerWord, so the words of
+        // the bitmaps can be combined without shifting bits. This loop is
+        // simple enough to be vectorized by the compiler.
+        quint64* targetWords = words + (set.m_bitmapOffset - m_bitmapOffset) / BitsPerWord;
+        const quint64* setWords = set.m_bitmap.constData();
+        const int setWordCount = set.m_bitmap.count();
+        for (int i = 0; i < setWordCount; ++i) {
+            operation(targetWords[i], setWords[i]);
+        }
+    }
+}
+
+template<typename Operation>
+void KItemSet::applyToBits(quint64* words, int position, int count, Operation operation)
+{
+    Q_ASSERT(position >= 0 && count > 0);
+
+    const int lastPosition = position + count - 1;
+    const int firstWordIndex = position / BitsPerWord;
+    const int lastWordIndex = lastPosition / BitsPerWord;
+    const quint64 firstWordMask = ~quint64(0) << (position % BitsPerWord);
+    const quint64 lastWordMask = ~quint64(0) >> (BitsPerWord - 1 - lastPosition % BitsPerWord);
+
+    if (firstWordIndex == lastWordIndex) {
+        operation(words[firstWordIndex], firstWordMask & lastWordMask);
+        return;
+    }
+
+    operation(words[firstWordIndex], firstWordMask);
+    for (int i = firstWordIndex + 1; i < lastWordIndex; ++i) {
+        operation(words[i], ~quint64(0));
+    }
+    operation(words[lastWordIndex], lastWordMask);
+}
+
+int KItemSet::bitmapRangeCount() const
+{
+    // A range starts at each set bit whose predecessor is not set.
+    const quint64* words = m_bitmap.constData();
+    const int wordCount = m_bitmap.count();
+    if (wordCount == 0) {
+        return 0;
+    }
+
+    int result = qPopulationCount(words[0] & ~(words[0] << 1));
+    for (int i = 1; i < wordCount; ++i) {
+        const quint64 predecessors = (words[i] << 1) | (words[i - 1] >> (BitsPerWord - 1));
+        result += qPopulationCount(words[i] & ~predecessors);
+    }
+    return result;
+}
+
+int KItemSet::nextUnsetBitmapPosition(int position) const
+{
+    const int wordCount = m_bitmap.count();
+    int wordIndex = position / BitsPerWord;
+    if (wordIndex >= wordCount) {
+        return bitmapEnd();
+    }
+
+    const quint64* words = m_bitmap.constData();
+    quint64 word = ~words[wordIndex] & (~quint64(0) << (position % BitsPerWord));
+    while (word == 0) {
+        ++wordIndex;
+        if (wordIndex == wordCount) {
+            return bitmapEnd();
+        }
+        word = ~words[wordIndex];
+    }
+
+    return wordIndex * BitsPerWord + qCountTrailingZeroBits(word);
+}
+
+int KItemSet::alignedBitmapOffset(int i)
+{
+    // Rounds down, also for negative numbers.
+    return i & ~(BitsPerWord - 1);
+}
+
+qint64 KItemSet::bitmapWordCount(int offset, qint64 last)
+{
+    return (last - offset) / BitsPerWord + 1;
+}
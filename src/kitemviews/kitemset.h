@@ -23,6 +23,8 @@
 #include "dolphin_export.h"
 #include "kitemviews/kitemrange.h"
 
+#include <QVector>
+
 /**
  * @brief Stores a set of integer numbers in a space-efficient way.
  *
@@ -38,7 +40,15 @@
  * 2. When iterating through a KItemSet using KItemSet::iterator or
  *    KItemSet::const_iterator, the numbers are traversed in ascending order.
  *
- * The complexity of most operations depends on the number of ranges.
+ * 3. If the numbers are scattered such that the ranges would need more
+ *    memory than a bitmap which covers all numbers between the smallest and
+ *    the largest one, the set switches to a bitmap layout automatically.
+ *
+ *    Example: The set {0, 2, 4, ..., 9998} consists of 5000 ranges, but the
+ *    bitmap for the numbers 0 to 9998 needs only 157 64-bit words.
+ *
+ * The complexity of most operations depends on the number of ranges in the
+ * range layout, and on the number of bitmap words in the bitmap layout.
  */
 
 class DOLPHIN_EXPORT KItemSet
@@ -51,7 +61,8 @@ public:
 
     /**
      * Returns the number of items in the set.
-     * Complexity: O(log(number of ranges)).
+     * Complexity: O(number of ranges) in the range layout, O(1) in the
+     * bitmap layout.
      */
     int count() const;
 
@@ -65,14 +76,23 @@ public:
     {
         iterator(const KItemRangeList::iterator& rangeIt, int offset) :
             m_rangeIt(rangeIt),
-            m_offset(offset)
+            m_offset(offset),
+            m_set(nullptr)
+        {
+        }
+
+        iterator(const KItemSet* set, int position) :
+            m_rangeIt(),
+            m_offset(position),
+            m_set(set)
         {
         }
 
     public:
         iterator(const iterator& other) :
             m_rangeIt(other.m_rangeIt),
-            m_offset(other.m_offset)
+            m_offset(other.m_offset),
+            m_set(other.m_set)
         {
         }
 
@@ -80,6 +100,7 @@ public:
         {
             m_rangeIt = other.m_rangeIt;
             m_offset = other.m_offset;
+            m_set = other.m_set;
             return *this;
         }
 
@@ -87,12 +108,15 @@ public:
 
         int operator*() const
         {
+            if (m_set) {
+                return m_set->m_bitmapOffset + m_offset;
+            }
             return m_rangeIt->index + m_offset;
         }
 
         inline bool operator==(const iterator& other) const
         {
-            return m_rangeIt == other.m_rangeIt && m_offset == other.m_offset;
+            return m_rangeIt == other.m_rangeIt && m_offset == other.m_offset && m_set == other.m_set;
         }
 
         inline bool operator!=(const iterator& other) const
@@ -102,6 +126,11 @@ public:
 
         inline iterator& operator++()
         {
+            if (m_set) {
+                m_offset = m_set->nextBitmapPosition(m_offset + 1);
+                return *this;
+            }
+
             ++m_offset;
 
             if (m_offset == m_rangeIt->count) {
@@ -121,6 +150,11 @@ public:
 
         inline iterator& operator--()
         {
+            if (m_set) {
+                m_offset = m_set->previousBitmapPosition(m_offset - 1);
+                return *this;
+            }
+
             if (m_offset == 0) {
                 --m_rangeIt;
                 m_offset = m_rangeIt->count - 1;
@@ -141,6 +175,7 @@ public:
     private:
         KItemRangeList::iterator m_rangeIt;
         int m_offset;
+        const KItemSet* m_set; // Only set in the bitmap layout.
 
         friend class const_iterator;
         friend class KItemSet;
@@ -151,20 +186,30 @@ public:
     {
         const_iterator(KItemRangeList::const_iterator rangeIt, int offset) :
             m_rangeIt(rangeIt),
-            m_offset(offset)
+            m_offset(offset),
+            m_set(nullptr)
+        {
+        }
+
+        const_iterator(const KItemSet* set, int position) :
+            m_rangeIt(),
+            m_offset(position),
+            m_set(set)
         {
         }
 
     public:
         const_iterator(const const_iterator& other) :
             m_rangeIt(other.m_rangeIt),
-            m_offset(other.m_offset)
+            m_offset(other.m_offset),
+            m_set(other.m_set)
         {
         }
 
         explicit const_iterator(const iterator& other) :
             m_rangeIt(other.m_rangeIt),
-            m_offset(other.m_offset)
+            m_offset(other.m_offset),
+            m_set(other.m_set)
         {
         }
 
@@ -172,6 +217,7 @@ public:
         {
             m_rangeIt = other.m_rangeIt;
             m_offset = other.m_offset;
+            m_set = other.m_set;
             return *this;
         }
 
@@ -179,12 +225,15 @@ public:
 
         int operator*() const
         {
+            if (m_set) {
+                return m_set->m_bitmapOffset + m_offset;
+            }
             return m_rangeIt->index + m_offset;
         }
 
         inline bool operator==(const const_iterator& other) const
         {
-            return m_rangeIt == other.m_rangeIt && m_offset == other.m_offset;
+            return m_rangeIt == other.m_rangeIt && m_offset == other.m_offset && m_set == other.m_set;
         }
 
         inline bool operator!=(const const_iterator& other) const
@@ -194,6 +243,11 @@ public:
 
         inline const_iterator& operator++()
         {
+            if (m_set) {
+                m_offset = m_set->nextBitmapPosition(m_offset + 1);
+                return *this;
+            }
+
             ++m_offset;
 
             if (m_offset == m_rangeIt->count) {
@@ -213,6 +267,11 @@ public:
 
         inline const_iterator& operator--()
         {
+            if (m_set) {
+                m_offset = m_set->previousBitmapPosition(m_offset - 1);
+                return *this;
+            }
+
             if (m_offset == 0) {
                 --m_rangeIt;
                 m_offset = m_rangeIt->count - 1;
@@ -233,6 +292,7 @@ public:
     private:
         KItemRangeList::const_iterator m_rangeIt;
         int m_offset;
+        const KItemSet* m_set; // Only set in the bitmap layout.
 
         friend class KItemSet;
     };
@@ -270,13 +330,100 @@ public:
     KItemSet& operator<<(int i);
 
 private:
+    enum Layout {
+        RangeLayout,
+        BitmapLayout
+    };
+
     /**
      * Returns true if the KItemSet is valid, and false otherwise.
      * A valid KItemSet must store the item ranges in ascending order, and
-     * the ranges must not overlap.
+     * the ranges must not overlap. In the bitmap layout, the bitmap must not
+     * be empty, and m_bitmapCount must match the number of set bits.
      */
     bool isValid() const;
 
+    iterator insertIntoRanges(int i);
+    iterator insertIntoBitmap(int i);
+
+    /**
+     * Returns true if the items are equal. This is the slow path of
+     * operator==(), which is used if any of the sets uses the bitmap layout.
+     */
+    bool hasSameItems(const KItemSet& other) const;
+
+    /**
+     * Switches to the layout which needs less memory for the current items.
+     * To prevent that a set switches back and forth, a bitmap is only
+     * converted back to ranges if it needs much more memory than the ranges.
+     */
+    void updateLayout();
+
+    /**
+     * Returns true if the range layout needs more memory than a bitmap.
+     */
+    bool rangesExceedBitmapSize() const;
+
+    void convertToBitmap();
+    void convertToRanges();
+
+    /**
+     * Returns a copy of the set which uses the range layout.
+     */
+    KItemSet withRangeLayout() const;
+
+    /**
+     * Returns true if the result of combining this set with \a other can be
+     * calculated in the bitmap layout without wasting memory.
+     */
+    bool canCombineAsBitmap(const KItemSet& other) const;
+
+    /**
+     * Returns a set in the bitmap layout which contains the combination of
+     * this set and \a other. \a operation is called with each bitmap word of
+     * the result and a mask of the bits which are contained in either set.
+     */
+    template<typename Operation>
+    KItemSet combinedBitmap(const KItemSet& other, Operation operation) const;
+
+    template<typename Operation>
+    void applyToBitmap(const KItemSet& set, Operation operation);
+
+    /**
+     * Calls \a operation for each word that contains bits in the range
+     * [\a position, \a position + \a count), with a mask of these bits.
+     */
+    template<typename Operation>
+    static void applyToBits(quint64* words, int position, int count, Operation operation);
+
+    /**
+     * Returns the number of ranges that the bitmap consists of.
+     */
+    int bitmapRangeCount() const;
+
+    /**
+     * Returns the position of the first set bit which is not smaller than
+     * \a position, or the end of the bitmap if no such bit exists.
+     */
+    int nextBitmapPosition(int position) const;
+
+    /**
+     * Returns the position of the first unset bit which is not smaller than
+     * \a position, or the end of the bitmap if no such bit exists.
+     */
+    int nextUnsetBitmapPosition(int position) const;
+
+    /**
+     * Returns the position of the last set bit which is not larger than
+     * \a position. The bit must exist.
+     */
+    int previousBitmapPosition(int position) const;
+
+    int bitmapEnd() const;
+
+    static int alignedBitmapOffset(int i);
+    static qint64 bitmapWordCount(int offset, qint64 last);
+
     /**
      * This function returns an iterator that points to the KItemRange which
      * contains i, or m_itemRanges.end() if no such range exists.
@@ -289,18 +436,37 @@ private:
      */
     KItemRangeList::const_iterator constRangeForItem(int i) const;
 
+    static const int BitsPerWord = 64;
+
     KItemRangeList m_itemRanges;
 
+    // Bit b of the word w in the bitmap represents the item
+    // m_bitmapOffset + w * BitsPerWord + b. m_bitmapOffset is always a
+    // multiple of BitsPerWord.
+    QVector<quint64> m_bitmap;
+    int m_bitmapOffset;
+    int m_bitmapCount;
+    Layout m_layout;
+
     friend class KItemSetTest;
+    friend class KItemSetBenchmark;
 };
 
 inline KItemSet::KItemSet() :
-    m_itemRanges()
+    m_itemRanges(),
+    m_bitmap(),
+    m_bitmapOffset(0),
+    m_bitmapCount(0),
+    m_layout(RangeLayout)
 {
 }
 
 inline KItemSet::KItemSet(const KItemSet& other) :
-    m_itemRanges(other.m_itemRanges)
+    m_itemRanges(other.m_itemRanges),
+    m_bitmap(other.m_bitmap),
+    m_bitmapOffset(other.m_bitmapOffset),
+    m_bitmapCount(other.m_bitmapCount),
+    m_layout(other.m_layout)
 {
 }
 
@@ -309,11 +475,19 @@ inline KItemSet::~KItemSet() = default;
 inline KItemSet& KItemSet::operator=(const KItemSet& other)
 {
     m_itemRanges=other.m_itemRanges;
+    m_bitmap = other.m_bitmap;
+    m_bitmapOffset = other.m_bitmapOffset;
+    m_bitmapCount = other.m_bitmapCount;
+    m_layout = other.m_layout;
     return *this;
 }
 
 inline int KItemSet::count() const
 {
+    if (m_layout == BitmapLayout) {
+        return m_bitmapCount;
+    }
+
     int result = 0;
     foreach (const KItemRange& range, m_itemRanges) {
         result += range.count;
@@ -323,32 +497,50 @@ inline int KItemSet::count() const
 
 inline bool KItemSet::isEmpty() const
 {
-    return m_itemRanges.isEmpty();
+    // A set in the bitmap layout is never empty.
+    return m_layout == RangeLayout && m_itemRanges.isEmpty();
 }
 
 inline void KItemSet::clear()
 {
     m_itemRanges.clear();
+    m_bitmap.clear();
+    m_bitmapOffset = 0;
+    m_bitmapCount = 0;
+    m_layout = RangeLayout;
 }
 
 inline bool KItemSet::operator==(const KItemSet& other) const
 {
-    return m_itemRanges == other.m_itemRanges;
+    if (m_layout == RangeLayout && other.m_layout == RangeLayout) {
+        return m_itemRanges == other.m_itemRanges;
+    }
+    return hasSameItems(other);
 }
 
 inline bool KItemSet::operator!=(const KItemSet& other) const
 {
-    return m_itemRanges != other.m_itemRanges;
+    return !(*this == other);
 }
 
 inline bool KItemSet::contains(int i) const
 {
+    if (m_layout == BitmapLayout) {
+        const qint64 position = qint64(i) - m_bitmapOffset;
+        return position >= 0 && position < bitmapEnd()
+               && (m_bitmap.at(position / BitsPerWord) & (quint64(1) << (position % BitsPerWord)));
+    }
+
     const KItemRangeList::const_iterator it = constRangeForItem(i);
     return it != m_itemRanges.end();
 }
 
 inline KItemSet::iterator KItemSet::find(int i)
 {
+    if (m_layout == BitmapLayout) {
+        return contains(i) ? iterator(this, i - m_bitmapOffset) : end();
+    }
+
     const KItemRangeList::iterator it = rangeForItem(i);
     if (it != m_itemRanges.end()) {
         return iterator(it, i - it->index);
@@ -359,6 +551,10 @@ inline KItemSet::iterator KItemSet::find(int i)
 
 inline KItemSet::const_iterator KItemSet::constFind(int i) const
 {
+    if (m_layout == BitmapLayout) {
+        return contains(i) ? const_iterator(this, i - m_bitmapOffset) : constEnd();
+    }
+
     const KItemRangeList::const_iterator it = constRangeForItem(i);
     if (it != m_itemRanges.constEnd()) {
         return const_iterator(it, i - it->index);
@@ -380,41 +576,65 @@ inline bool KItemSet::remove(int i)
 
 inline KItemSet::iterator KItemSet::begin()
 {
+    if (m_layout == BitmapLayout) {
+        return iterator(this, nextBitmapPosition(0));
+    }
     return iterator(m_itemRanges.begin(), 0);
 }
 
 inline KItemSet::const_iterator KItemSet::begin() const
 {
+    if (m_layout == BitmapLayout) {
+        return const_iterator(this, nextBitmapPosition(0));
+    }
     return const_iterator(m_itemRanges.begin(), 0);
 }
 
 inline KItemSet::const_iterator KItemSet::constBegin() const
 {
+    if (m_layout == BitmapLayout) {
+        return const_iterator(this, nextBitmapPosition(0));
+    }
     return const_iterator(m_itemRanges.constBegin(), 0);
 }
 
 inline KItemSet::iterator KItemSet::end()
 {
+    if (m_layout == BitmapLayout) {
+        return iterator(this, bitmapEnd());
+    }
     return iterator(m_itemRanges.end(), 0);
 }
 
 inline KItemSet::const_iterator KItemSet::end() const
 {
+    if (m_layout == BitmapLayout) {
+        return const_iterator(this, bitmapEnd());
+    }
     return const_iterator(m_itemRanges.end(), 0);
 }
 
 inline KItemSet::const_iterator KItemSet::constEnd() const
 {
+    if (m_layout == BitmapLayout) {
+        return const_iterator(this, bitmapEnd());
+    }
     return const_iterator(m_itemRanges.constEnd(), 0);
 }
 
 inline int KItemSet::first() const
 {
+    if (m_layout == BitmapLayout) {
+        return m_bitmapOffset + nextBitmapPosition(0);
+    }
     return m_itemRanges.first().index;
 }
 
 inline int KItemSet::last() const
 {
+    if (m_layout == BitmapLayout) {
+        return m_bitmapOffset + previousBitmapPosition(bitmapEnd() - 1);
+    }
     const KItemRange& lastRange = m_itemRanges.last();
     return lastRange.index + lastRange.count - 1;
 }
@@ -425,4 +645,46 @@ inline KItemSet& KItemSet::operator<<(int i)
     return *this;
 }
 
+inline int KItemSet::nextBitmapPosition(int position) const
+{
+    const int wordCount = m_bitmap.count();
+    int wordIndex = position / BitsPerWord;
+    if (wordIndex >= wordCount) {
+        return bitmapEnd();
+    }
+
+    const quint64* words = m_bitmap.constData();
+    quint64 word = words[wordIndex] & (~quint64(0) << (position % BitsPerWord));
+    while (word == 0) {
+        ++wordIndex;
+        if (wordIndex == wordCount) {
+            return bitmapEnd();
+        }
+        word = words[wordIndex];
+    }
+
+    return wordIndex * BitsPerWord + qCountTrailingZeroBits(word);
+}
+
+inline int KItemSet::previousBitmapPosition(int position) const
+{
+    Q_ASSERT(position >= 0 && position < bitmapEnd());
+
+    const quint64* words = m_bitmap.constData();
+    int wordIndex = position / BitsPerWord;
+    quint64 word = words[wordIndex] & (~quint64(0) >> (BitsPerWord - 1 - position % BitsPerWord));
+    while (word == 0) {
+        --wordIndex;
+        Q_ASSERT(wordIndex >= 0);
+        word = words[wordIndex];
+    }
+
+    return wordIndex * BitsPerWord + BitsPerWord - 1 - qCountLeadingZeroBits(word);
+}
+
+inline int KItemSet::bitmapEnd() const
+{
+    return m_bitmap.count() * BitsPerWord;
+}
+
 #endif
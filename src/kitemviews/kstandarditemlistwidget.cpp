@@ -22,10 +22,12 @@
 #include "kfileitemlistview.h"
 #include "kfileitemmodel.h"
 #include "private/kfileitemclipboard.h"
+#include "private/kitemlisticoncache.h"
 #include "private/kitemlistroleeditor.h"
+#include "private/kitemlisttextlayoutcache.h"
+#include "private/kparallelchunks.h"
 #include "private/kpixmapmodifier.h"
 
-#include <KIconEffect>
 #include <KIconLoader>
 #include <KRatingPainter>
 #include <KStringHandler>
@@ -34,11 +36,17 @@
 #include <QGraphicsSceneResizeEvent>
 #include <QGraphicsView>
 #include <QGuiApplication>
-#include <QPixmapCache>
 #include <QStyleOption>
 
 // #define KSTANDARDITEMLISTWIDGET_DEBUG
 
+namespace {
+    // Number of items that are measured by one thread at once. Measuring the
+    // text of an item is more expensive than matching a name, so the chunks
+    // are smaller than DefaultProcessingChunkSize.
+    const int MeasurementChunkSize = 250;
+}
+
 KStandardItemListWidgetInformant::KStandardItemListWidgetInformant() :
     KItemListWidgetInformant()
 {
@@ -48,19 +56,19 @@ KStandardItemListWidgetInformant::~KStandardItemListWidgetInformant()
 {
 }
 
-void KStandardItemListWidgetInformant::calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const
+void KStandardItemListWidgetInformant::calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const
 {
     switch (static_cast<const KStandardItemListView*>(view)->itemLayout()) {
     case KStandardItemListView::IconsLayout:
-        calculateIconsLayoutItemSizeHints(logicalHeightHints, logicalWidthHint, view);
+        calculateIconsLayoutItemSizeHints(logicalHeightHints, logicalWidthHint, firstIndex, lastIndex, view);
         break;
 
     case KStandardItemListView::CompactLayout:
-        calculateCompactLayoutItemSizeHints(logicalHeightHints, logicalWidthHint, view);
+        calculateCompactLayoutItemSizeHints(logicalHeightHints, logicalWidthHint, firstIndex, lastIndex, view);
         break;
 
     case KStandardItemListView::DetailsLayout:
-        calculateDetailsLayoutItemSizeHints(logicalHeightHints, logicalWidthHint, view);
+        calculateDetailsLayoutItemSizeHints(logicalHeightHints, logicalWidthHint, firstIndex, lastIndex, view);
         break;
 
     default:
@@ -133,7 +141,7 @@ QFont KStandardItemListWidgetInformant::customizedFontForLinks(const QFont& base
     return baseFont;
 }
 
-void KStandardItemListWidgetInformant::calculateIconsLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const
+void KStandardItemListWidgetInformant::calculateIconsLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const
 {
     const KItemListStyleOption& option = view->styleOption();
     const QFont& normalFont = option.font;
@@ -146,48 +154,53 @@ void KStandardItemListWidgetInformant::calculateIconsLayoutItemSizeHints(QVector
 
     const QFont linkFont = customizedFontForLinks(normalFont);
 
-    QTextOption textOption(Qt::AlignHCenter);
-    textOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
-
-    for (int index = 0; index < logicalHeightHints.count(); ++index) {
+    // The model may only be accessed from the main thread: Collect the texts
+    // of all items that must be measured before measuring them in parallel.
+    QVector<int> indexes;
+    QStringList texts;
+    QVector<bool> isLink;
+    for (int index = firstIndex; index <= lastIndex; ++index) {
         if (logicalHeightHints.at(index) > 0.0) {
             continue;
         }
 
-        // If the current item is a link, we use the customized link font instead of the normal font.
-        const QFont& font = itemIsLink(index, view) ? linkFont : normalFont;
+        indexes.append(index);
+        texts.append(itemText(index, view));
+        isLink.append(itemIsLink(index, view));
+    }
 
-        const QString& text = KStringHandler::preProcessWrap(itemText(index, view));
+    // Detach before writing to the height hints from several threads.
+    qreal* heightHints = logicalHeightHints.data();
+    const int maxTextLines = option.maxTextLines;
 
-        // Calculate the number of lines required for wrapping the name
-        qreal textHeight = 0;
-        QTextLayout layout(text, font);
-        layout.setTextOption(textOption);
-        layout.beginLayout();
-        QTextLine line;
-        int lineCount = 0;
-        while ((line = layout.createLine()).isValid()) {
-            line.setLineWidth(maxWidth);
-            line.naturalTextWidth();
-            textHeight += line.height();
-
-            ++lineCount;
-            if (lineCount == option.maxTextLines) {
-                break;
-            }
-        }
-        layout.endLayout();
+    KItemListTextLayoutCache* textLayoutCache = KItemListTextLayoutCache::instance();
 
-        // Add one line for each additional information
-        textHeight += additionalRolesSpacing;
+    processInChunks(indexes.count(), [&](int first, int last) {
+        // QFont is reentrant, so each thread uses its own copies.
+        const QFont chunkNormalFont = normalFont;
+        const QFont chunkLinkFont = linkFont;
 
-        logicalHeightHints[index] = textHeight + spacingAndIconHeight;
-    }
+        for (int i = first; i <= last; ++i) {
+            // If the current item is a link, we use the customized link font instead of the normal font.
+            const QFont& font = isLink.at(i) ? chunkLinkFont : chunkNormalFont;
+
+            const QString text = KStringHandler::preProcessWrap(texts.at(i));
+
+            // Calculate the number of lines required for wrapping the name. The result
+            // is cached, so KStandardItemListWidget can reuse it when showing the item.
+            qreal textHeight = textLayoutCache->wrappedText(text, font, maxWidth, maxTextLines).height;
+
+            // Add one line for each additional information
+            textHeight += additionalRolesSpacing;
+
+            heightHints[indexes.at(i)] = textHeight + spacingAndIconHeight;
+        }
+    }, MeasurementChunkSize);
 
     logicalWidthHint = itemWidth;
 }
 
-void KStandardItemListWidgetInformant::calculateCompactLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const
+void KStandardItemListWidgetInformant::calculateCompactLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const
 {
     const KItemListStyleOption& option = view->styleOption();
     const QFontMetrics& normalFontMetrics = option.fontMetrics;
@@ -199,47 +212,73 @@ void KStandardItemListWidgetInformant::calculateCompactLayoutItemSizeHints(QVect
     const qreal paddingAndIconWidth = option.padding * 4 + option.iconSize;
     const qreal height = option.padding * 2 + qMax(option.iconSize, (1 + additionalRolesCount) * normalFontMetrics.lineSpacing());
 
-    const QFontMetrics linkFontMetrics(customizedFontForLinks(option.font));
+    const QFont normalFont = option.font;
+    const QFont linkFont = customizedFontForLinks(option.font);
 
-    for (int index = 0; index < logicalHeightHints.count(); ++index) {
+    // The model may only be accessed from the main thread: Collect the texts
+    // of all items that must be measured before measuring them in parallel.
+    QVector<int> indexes;
+    QVector<QStringList> texts;
+    QVector<bool> isLink;
+    for (int index = firstIndex; index <= lastIndex; ++index) {
         if (logicalHeightHints.at(index) > 0.0) {
             continue;
         }
 
-        // If the current item is a link, we use the customized link font metrics instead of the normal font metrics.
-        const QFontMetrics& fontMetrics = itemIsLink(index, view) ? linkFontMetrics : normalFontMetrics;
-
-        // For each row exactly one role is shown. Calculate the maximum required width that is necessary
-        // to show all roles without horizontal clipping.
-        qreal maximumRequiredWidth = 0.0;
+        indexes.append(index);
+        isLink.append(itemIsLink(index, view));
 
         if (showOnlyTextRole) {
-            maximumRequiredWidth = fontMetrics.width(itemText(index, view));
+            texts.append(QStringList(itemText(index, view)));
         } else {
+            QStringList roleTexts;
             const QHash<QByteArray, QVariant>& values = view->model()->data(index);
             foreach (const QByteArray& role, visibleRoles) {
-                const QString& text = roleText(role, values);
+                roleTexts.append(roleText(role, values));
+            }
+            texts.append(roleTexts);
+        }
+    }
+
+    // Detach before writing to the height hints from several threads.
+    qreal* heightHints = logicalHeightHints.data();
+
+    processInChunks(indexes.count(), [&](int first, int last) {
+        // QFontMetrics is not thread-safe, so each thread uses its own instances.
+        const QFontMetrics chunkNormalFontMetrics(normalFont);
+        const QFontMetrics chunkLinkFontMetrics(linkFont);
+
+        for (int i = first; i <= last; ++i) {
+            // If the current item is a link, we use the customized link font metrics instead of the normal font metrics.
+            const QFontMetrics& fontMetrics = isLink.at(i) ? chunkLinkFontMetrics : chunkNormalFontMetrics;
+
+            // For each row exactly one role is shown. Calculate the maximum required width that is necessary
+            // to show all roles without horizontal clipping.
+            qreal maximumRequiredWidth = 0.0;
+            foreach (const QString& text, texts.at(i)) {
                 const qreal requiredWidth = fontMetrics.width(text);
                 maximumRequiredWidth = qMax(maximumRequiredWidth, requiredWidth);
             }
-        }
 
-        qreal width = paddingAndIconWidth + maximumRequiredWidth;
-        if (maxWidth > 0 && width > maxWidth) {
-            width = maxWidth;
-        }
+            qreal width = paddingAndIconWidth + maximumRequiredWidth;
+            if (maxWidth > 0 && width > maxWidth) {
+                width = maxWidth;
+            }
 
-        logicalHeightHints[index] = width;
-    }
+            heightHints[indexes.at(i)] = width;
+        }
+    }, MeasurementChunkSize);
 
     logicalWidthHint = height;
 }
 
-void KStandardItemListWidgetInformant::calculateDetailsLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const
+void KStandardItemListWidgetInformant::calculateDetailsLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const
 {
     const KItemListStyleOption& option = view->styleOption();
     const qreal height = option.padding * 2 + qMax(option.iconSize, option.fontMetrics.height());
-    logicalHeightHints.fill(height);
+    for (int index = firstIndex; index <= lastIndex; ++index) {
+        logicalHeightHints[index] = height;
+    }
     logicalWidthHint = -1.0;
 }
 
@@ -269,7 +308,9 @@ KStandardItemListWidget::KStandardItemListWidget(KItemListWidgetInformant* infor
     m_overlay(),
     m_rating(),
     m_roleEditor(nullptr),
-    m_oldRoleEditor(nullptr)
+    m_oldRoleEditor(nullptr),
+    m_renderCache(),
+    m_renderState()
 {
 }
 
@@ -320,6 +361,53 @@ void KStandardItemListWidget::paint(QPainter* painter, const QStyleOptionGraphic
 {
     const_cast<KStandardItemListWidget*>(this)->triggerCacheRefreshing();
 
+    // When scrolling, the items are painted again although nothing has been
+    // changed. The item is painted into m_renderCache once, and only the
+    // pixmap is drawn as long as neither the content nor the state of the
+    // item changes. A changed content clears m_renderCache in
+    // triggerCacheRefreshing(). Items with an ongoing hover animation or a
+    // role editor, and transformed painters are not cached.
+    const qreal opacity = hoverOpacity();
+    const bool useRenderCache = editedRole().isEmpty()
+                                && (opacity <= 0.0 || opacity >= 1.0)
+                                && painter->transform().type() <= QTransform::TxTranslate;
+    if (!useRenderCache) {
+        m_renderCache = QPixmap();
+        paintItem(painter, option, widget);
+        return;
+    }
+
+    RenderState state;
+    state.size = size().toSize();
+    state.devicePixelRatio = painter->device()->devicePixelRatioF();
+    state.selected = isSelected();
+    state.current = isCurrent();
+    state.hovered = (opacity > 0.0);
+    state.alternateBackground = alternateBackground();
+    state.activeWindow = isActiveWindow();
+
+    if (m_renderCache.isNull() || !(state == m_renderState)) {
+        if (state.size.isEmpty()) {
+            return;
+        }
+
+        m_renderCache = QPixmap(state.size * state.devicePixelRatio);
+        m_renderCache.setDevicePixelRatio(state.devicePixelRatio);
+        m_renderCache.fill(Qt::transparent);
+
+        QPainter cachePainter(&m_renderCache);
+        cachePainter.setRenderHints(painter->renderHints());
+        paintItem(&cachePainter, option, widget);
+        cachePainter.end();
+
+        m_renderState = state;
+    }
+
+    painter->drawPixmap(0, 0, m_renderCache);
+}
+
+void KStandardItemListWidget::paintItem(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
     KItemListWidget::paint(painter, option, widget);
 
     if (!m_expansionArea.isEmpty()) {
@@ -624,6 +712,7 @@ void KStandardItemListWidget::setTextColor(const QColor& color)
     if (color != m_customTextColor) {
         m_customTextColor = color;
         updateAdditionalInfoTextColor();
+        m_renderCache = QPixmap();
         update();
     }
 }
@@ -842,6 +931,9 @@ void KStandardItemListWidget::hideEvent(QHideEvent* event)
     disconnect(KFileItemClipboard::instance(), &KFileItemClipboard::cutItemsChanged,
                this, &KStandardItemListWidget::slotCutItemsChanged);
 
+    // Hidden widgets are kept for recycling, don't waste memory for them
+    m_renderCache = QPixmap();
+
     KItemListWidget::hideEvent(event);
 }
 
@@ -850,6 +942,7 @@ bool KStandardItemListWidget::event(QEvent *event)
     if (event->type() == QEvent::WindowDeactivate || event->type() == QEvent::WindowActivate
             || event->type() == QEvent::PaletteChange) {
         m_dirtyContent = true;
+        update();
     }
 
     return KItemListWidget::event(event);
@@ -897,6 +990,7 @@ void KStandardItemListWidget::triggerCacheRefreshing()
     }
 
     refreshCache();
+    m_renderCache = QPixmap();
 
     const QHash<QByteArray, QVariant> values = data();
     m_isExpandable = m_supportsItemExpanding && values["isExpandable"].toBool();
@@ -955,39 +1049,46 @@ void KStandardItemListWidget::updatePixmapCache()
                        || m_dirtyContentRoles.contains("iconOverlays");
     }
 
-    if (updatePixmap) {
-        m_pixmap = values["iconPixmap"].value<QPixmap>();
-        if (m_pixmap.isNull()) {
-            // Use the icon that fits to the MIME-type
-            QString iconName = values["iconName"].toString();
-            if (iconName.isEmpty()) {
-                // The icon-name has not been not resolved by KFileItemModelRolesUpdater,
-                // use a generic icon as fallback
-                iconName = QStringLiteral("unknown");
-            }
-            const QStringList overlays = values["iconOverlays"].toStringList();
-            m_pixmap = pixmapForIcon(iconName, overlays, maxIconHeight, m_layout != IconsLayout && isActiveWindow() && isSelected() ? QIcon::Selected : QIcon::Normal);
-
-        } else if (m_pixmap.width() / m_pixmap.devicePixelRatio() != maxIconWidth || m_pixmap.height() / m_pixmap.devicePixelRatio() != maxIconHeight) {
-            // A custom pixmap has been applied. Assure that the pixmap
-            // is scaled to the maximum available size.
-            KPixmapModifier::scale(m_pixmap, QSize(maxIconWidth, maxIconHeight) * qApp->devicePixelRatio());
-        }
-
-        if (m_isCut) {
-            KIconEffect* effect = KIconLoader::global()->iconEffect();
-            m_pixmap = effect->apply(m_pixmap, KIconLoader::Desktop, KIconLoader::DisabledState);
-        }
-
-        if (m_isHidden) {
-            KIconEffect::semiTransparent(m_pixmap);
+    KItemListIconCache::Effects effects = KItemListIconCache::NoEffect;
+    if (m_isCut) {
+        effects |= KItemListIconCache::CutEffect;
+    }
+    if (m_isHidden) {
+        effects |= KItemListIconCache::HiddenEffect;
+    }
+    if (m_layout == IconsLayout && isSelected()) {
+        effects |= KItemListIconCache::SelectedEffect;
+    }
+    const QColor selectionColor = palette().brush(QPalette::Normal, QPalette::Highlight).color();
+
+    // The pixmaps of MIME-type icons are shared by all items with the same
+    // icon and state. Only custom pixmaps like previews are modified here.
+    QString iconName;
+    QStringList overlays;
+    const QIcon::Mode iconMode = (m_layout != IconsLayout && isActiveWindow() && isSelected()) ? QIcon::Selected : QIcon::Normal;
+    const bool isCustomPixmap = !values["iconPixmap"].value<QPixmap>().isNull();
+    if (!isCustomPixmap) {
+        // Use the icon that fits to the MIME-type
+        iconName = values["iconName"].toString();
+        if (iconName.isEmpty()) {
+            // The icon-name has not been not resolved by KFileItemModelRolesUpdater,
+            // use a generic icon as fallback
+            iconName = QStringLiteral("unknown");
         }
+        overlays = values["iconOverlays"].toStringList();
+    }
 
-        if (m_layout == IconsLayout && isSelected()) {
-            const QColor color = palette().brush(QPalette::Normal, QPalette::Highlight).color();
-            QImage image = m_pixmap.toImage();
-            KIconEffect::colorize(image, color, 0.8f);
-            m_pixmap = QPixmap::fromImage(image);
+    if (updatePixmap) {
+        if (isCustomPixmap) {
+            m_pixmap = values["iconPixmap"].value<QPixmap>();
+            if (m_pixmap.width() / m_pixmap.devicePixelRatio() != maxIconWidth || m_pixmap.height() / m_pixmap.devicePixelRatio() != maxIconHeight) {
+                // A custom pixmap has been applied. Assure that the pixmap
+                // is scaled to the maximum available size.
+                KPixmapModifier::scale(m_pixmap, QSize(maxIconWidth, maxIconHeight) * qApp->devicePixelRatio());
+            }
+            KItemListIconCache::applyEffects(m_pixmap, effects, selectionColor);
+        } else {
+            m_pixmap = KItemListIconCache::instance()->pixmap(iconName, overlays, maxIconHeight, iconMode, effects, selectionColor);
         }
     }
 
@@ -1037,13 +1138,12 @@ void KStandardItemListWidget::updatePixmapCache()
 
     // Prepare the pixmap that is used when the item gets hovered
     if (isHovered()) {
-        m_hoverPixmap = m_pixmap;
-        KIconEffect* effect = KIconLoader::global()->iconEffect();
-        // In the KIconLoader terminology, active = hover.
-        if (effect->hasEffect(KIconLoader::Desktop, KIconLoader::ActiveState)) {
-            m_hoverPixmap = effect->apply(m_pixmap, KIconLoader::Desktop, KIconLoader::ActiveState);
-        } else {
+        if (isCustomPixmap || !m_overlay.isNull()) {
             m_hoverPixmap = m_pixmap;
+            KItemListIconCache::applyEffects(m_hoverPixmap, KItemListIconCache::HoverEffect, selectionColor);
+        } else {
+            m_hoverPixmap = KItemListIconCache::instance()->pixmap(iconName, overlays, maxIconHeight, iconMode,
+                                                                   effects | KItemListIconCache::HoverEffect, selectionColor);
         }
     } else if (hoverOpacity() <= 0.0) {
         // No hover animation is ongoing. Clear m_hoverPixmap to save memory.
@@ -1115,22 +1215,7 @@ void KStandardItemListWidget::updateTextsCache()
 
 QString KStandardItemListWidget::elideRightKeepExtension(const QString &text, int elidingWidth) const
 {
-    auto extensionIndex = text.lastIndexOf('.');
-    if (extensionIndex != -1) {
-        // has file extension
-        auto extensionLength = text.length() - extensionIndex;
-        auto extensionWidth = m_customizedFontMetrics.width(text.right(extensionLength));
-        if (elidingWidth > extensionWidth && extensionLength < 6 && (float(extensionWidth) / float(elidingWidth)) < 0.3) {
-            // if we have room to display the file extension and the extension is not too long
-            QString ret = m_customizedFontMetrics.elidedText(text.chopped(extensionLength),
-                                                             Qt::ElideRight,
-                                                             elidingWidth - extensionWidth);
-            ret.append(text.right(extensionLength));
-            return ret;
-        }
-    }
-    return m_customizedFontMetrics.elidedText(text,Qt::ElideRight,
-                                              elidingWidth);
+    return KItemListTextLayoutCache::elideRightKeepExtension(text, elidingWidth, m_customizedFontMetrics);
 }
 
 void KStandardItemListWidget::updateIconsLayoutTextCache()
@@ -1157,51 +1242,14 @@ void KStandardItemListWidget::updateIconsLayoutTextCache()
     // for initializing the position of the other roles.
     TextInfo* nameTextInfo = m_textInfo.value("text");
     const QString nameText = KStringHandler::preProcessWrap(values["text"].toString());
-    nameTextInfo->staticText.setText(nameText);
-
-    // Calculate the number of lines required for the name and the required width
-    qreal nameWidth = 0;
-    qreal nameHeight = 0;
-    QTextLine line;
-
-    QTextLayout layout(nameTextInfo->staticText.text(), m_customizedFont);
-    layout.setTextOption(nameTextInfo->staticText.textOption());
-    layout.beginLayout();
-    int nameLineIndex = 0;
-    while ((line = layout.createLine()).isValid()) {
-        line.setLineWidth(maxWidth);
-        nameWidth = qMax(nameWidth, line.naturalTextWidth());
-        nameHeight += line.height();
-
-        ++nameLineIndex;
-        if (nameLineIndex == option.maxTextLines) {
-            // The maximum number of textlines has been reached. If this is
-            // the case provide an elided text if necessary.
-            const int textLength = line.textStart() + line.textLength();
-            if (textLength < nameText.length()) {
-                // Elide the last line of the text
-                qreal elidingWidth = maxWidth;
-                qreal lastLineWidth;
-                do {
-                    QString lastTextLine = nameText.mid(line.textStart());
-                    lastTextLine = elideRightKeepExtension(lastTextLine, elidingWidth);
-                    const QString elidedText = nameText.left(line.textStart()) + lastTextLine;
-                    nameTextInfo->staticText.setText(elidedText);
-
-                    lastLineWidth = m_customizedFontMetrics.boundingRect(lastTextLine).width();
-
-                    // We do the text eliding in a loop with decreasing width (1 px / iteration)
-                    // to avoid problems related to different width calculation code paths
-                    // within Qt. (see bug 337104)
-                    elidingWidth -= 1.0;
-                } while (lastLineWidth > maxWidth);
-
-                nameWidth = qMax(nameWidth, lastLineWidth);
-            }
-            break;
-        }
-    }
-    layout.endLayout();
+
+    // Calculate the number of lines required for the name and the required width.
+    // The layout has usually been cached already when calculating the size hints.
+    const KItemListTextLayoutCache::WrappedText wrappedName =
+        KItemListTextLayoutCache::instance()->wrappedText(nameText, m_customizedFont, maxWidth, option.maxTextLines);
+    nameTextInfo->staticText.setText(wrappedName.text);
+    const qreal nameWidth = wrappedName.width;
+    const qreal nameHeight = wrappedName.height;
 
     // Use one line for each additional information
     const int additionalRolesCount = qMax(visibleRoles().count() - 1, 0);
@@ -1477,60 +1525,6 @@ void KStandardItemListWidget::closeRoleEditor()
     m_roleEditor = nullptr;
 }
 
-QPixmap KStandardItemListWidget::pixmapForIcon(const QString& name, const QStringList& overlays, int size, QIcon::Mode mode)
-{
-    static const QIcon fallbackIcon = QIcon::fromTheme(QStringLiteral("unknown"));
-
-    size *= qApp->devicePixelRatio();
-
-    const QString key = "KStandardItemListWidget:" % name % ":" % overlays.join(QLatin1Char(':')) % ":" % QString::number(size) % ":" % QString::number(mode);
-    QPixmap pixmap;
-
-    if (!QPixmapCache::find(key, pixmap)) {
-        const QIcon icon = QIcon::fromTheme(name, fallbackIcon);
-
-        pixmap = icon.pixmap(size / qApp->devicePixelRatio(), size / qApp->devicePixelRatio(), mode);
-        if (pixmap.width() != size || pixmap.height() != size) {
-            KPixmapModifier::scale(pixmap, QSize(size, size));
-        }
-
-        // Strangely KFileItem::overlays() returns empty string-values, so
-        // we need to check first whether an overlay must be drawn at all.
-        // It is more efficient to do it here, as KIconLoader::drawOverlays()
-        // assumes that an overlay will be drawn and has some additional
-        // setup time.
-        foreach (const QString& overlay, overlays) {
-            if (!overlay.isEmpty()) {
-                int state = KIconLoader::DefaultState;
-
-                switch (mode) {
-                case QIcon::Normal:
-                    break;
-                case QIcon::Active:
-                    state = KIconLoader::ActiveState;
-                    break;
-                case QIcon::Disabled:
-                    state = KIconLoader::DisabledState;
-                    break;
-                case QIcon::Selected:
-                    state = KIconLoader::SelectedState;
-                    break;
-                }
-
-                // There is at least one overlay, draw all overlays above m_pixmap
-                // and cancel the check
-                KIconLoader::global()->drawOverlays(overlays, pixmap, KIconLoader::Desktop, state);
-                break;
-            }
-        }
-
-        QPixmapCache::insert(key, pixmap);
-    }
-    pixmap.setDevicePixelRatio(qApp->devicePixelRatio());
-
-    return pixmap;
-}
-
 QSizeF KStandardItemListWidget::preferredRatingSize(const KItemListStyleOption& option)
 {
     const qreal height = option.fontMetrics.ascent();
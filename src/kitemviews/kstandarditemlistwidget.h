@@ -37,7 +37,7 @@ public:
     KStandardItemListWidgetInformant();
     ~KStandardItemListWidgetInformant() override;
 
-    void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const override;
+    void calculateItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const override;
 
     qreal preferredRoleColumnWidth(const QByteArray& role,
                                            int index,
@@ -72,9 +72,9 @@ protected:
     */
     virtual QFont customizedFontForLinks(const QFont& baseFont) const;
 
-    void calculateIconsLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const;
-    void calculateCompactLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const;
-    void calculateDetailsLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, const KItemListView* view) const;
+    void calculateIconsLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const;
+    void calculateCompactLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const;
+    void calculateDetailsLayoutItemSizeHints(QVector<qreal>& logicalHeightHints, qreal& logicalWidthHint, int firstIndex, int lastIndex, const KItemListView* view) const;
 
     friend class KStandardItemListWidget; // Accesses roleText()
 };
@@ -204,6 +204,12 @@ private:
 
     void updateAdditionalInfoTextColor();
 
+    /**
+     * Paints the item without using m_renderCache.
+     * @see paint()
+     */
+    void paintItem(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
+
     void drawPixmap(QPainter* painter, const QPixmap& pixmap);
     void drawSiblingsInformation(QPainter* painter);
 
@@ -217,8 +223,6 @@ private:
      */
     void closeRoleEditor();
 
-    static QPixmap pixmapForIcon(const QString& name, const QStringList& overlays, int size, QIcon::Mode mode);
-
     /**
      * @return Preferred size of the rating-image based on the given
      *         style-option. The height of the font is taken as
@@ -274,6 +278,29 @@ private:
     KItemListRoleEditor* m_roleEditor;
     KItemListRoleEditor* m_oldRoleEditor;
 
+    // The state of the item which is not covered by m_dirtyLayout and
+    // m_dirtyContent, but affects the painting.
+    struct RenderState
+    {
+        QSize size;
+        qreal devicePixelRatio;
+        bool selected;
+        bool current;
+        bool hovered;
+        bool alternateBackground;
+        bool activeWindow;
+
+        bool operator==(const RenderState& other) const
+        {
+            return size == other.size && devicePixelRatio == other.devicePixelRatio &&
+                   selected == other.selected && current == other.current &&
+                   hovered == other.hovered && alternateBackground == other.alternateBackground &&
+                   activeWindow == other.activeWindow;
+        }
+    };
+    QPixmap m_renderCache;      // The painted item, see paint()
+    RenderState m_renderState;  // The state of the item when m_renderCache has been painted
+
     friend class KStandardItemListWidgetInformant; // Accesses private static methods to be able to
                                                    // share a common layout calculation
 };
@@ -19,110 +19,89 @@
  ***************************************************************************/
 
 #include "kdirectorycontentscounter.h"
+#include "kdirectorysizecache.h"
+#include "dolphin_detailsmodesettings.h"
 #include "kitemviews/kfileitemmodel.h"
 
 #include <KDirWatch>
 
-#include <QFileInfo>
-#include <QDir>
+#include <QFutureWatcher>
 #include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 
 namespace  {
-    /// cache of directory counting result
-    static QHash<QString, QPair<int, long>> *s_cache;
+    /// Counting directories is I/O bound and may block for a long time, so
+    /// a separate pool is used to not starve users of the global thread pool.
+    Q_GLOBAL_STATIC(QThreadPool, s_counterThreadPool)
+
+    int maxParallelTasks()
+    {
+        const int threadCount = static_cast<int>(DetailsModeSettings::directoryContentsCounterThreadCount());
+        return threadCount > 0 ? threadCount : qMax(1, QThread::idealThreadCount());
+    }
 }
 
 KDirectoryContentsCounter::KDirectoryContentsCounter(KFileItemModel* model, QObject* parent) :
     QObject(parent),
     m_model(model),
+    m_priorityQueue(),
     m_queue(),
-    m_worker(nullptr),
-    m_workerIsBusy(false),
+    m_runningPaths(),
+    m_refreshedPaths(),
+    m_invalidatedPaths(),
+    m_cancelled(new QAtomicInt(0)),
     m_dirWatcher(nullptr),
     m_watchedDirs()
 {
     connect(m_model, &KFileItemModel::itemsRemoved,
             this,    &KDirectoryContentsCounter::slotItemsRemoved);
-
-    if (!m_workerThread) {
-        m_workerThread = new QThread();
-        m_workerThread->start();
-    }
-
-    if (s_cache == nullptr) {
-        s_cache = new QHash<QString, QPair<int, long>>();
-    }
-
-    m_worker = new KDirectoryContentsCounterWorker();
-    m_worker->moveToThread(m_workerThread);
-
-    connect(this,     &KDirectoryContentsCounter::requestDirectoryContentsCount,
-            m_worker, &KDirectoryContentsCounterWorker::countDirectoryContents);
-    connect(m_worker, &KDirectoryContentsCounterWorker::result,
-            this,     &KDirectoryContentsCounter::slotResult);
+    connect(m_model, &KFileItemModel::directoryRefreshing,
+            this,    &KDirectoryContentsCounter::slotDirectoryRefreshing);
 
     m_dirWatcher = new KDirWatch(this);
     connect(m_dirWatcher, &KDirWatch::dirty, this, &KDirectoryContentsCounter::slotDirWatchDirty);
+
+    // Start loading the cache in the background, such that it is ready
+    // when the first directory is counted
+    KDirectorySizeCache::instance();
 }
 
 KDirectoryContentsCounter::~KDirectoryContentsCounter()
 {
-    if (m_workerThread->isRunning()) {
-        // The worker thread will continue running. It could even be running
-        // a method of m_worker at the moment, so we delete it using
-        // deleteLater() to prevent a crash.
-        m_worker->deleteLater();
-    } else {
-        // There are no remaining workers -> stop the worker thread.
-        m_workerThread->quit();
-        m_workerThread->wait();
-        delete m_workerThread;
-        m_workerThread = nullptr;
-
-        // The worker thread has finished running now, so it's safe to delete
-        // m_worker. deleteLater() would not work at all because the event loop
-        // which would deliver the event to m_worker is not running any more.
-        delete m_worker;
-    }
+    // Running tasks only share the cancellation flag with this object, and
+    // their watchers are children of this object, so it is safe to leave
+    // them behind. They will finish soon after being cancelled.
+    cancelAll();
 }
 
-void KDirectoryContentsCounter::scanDirectory(const QString& path)
+void KDirectoryContentsCounter::scanDirectory(const QString& path, PathCountPriority priority)
 {
-    startWorker(path);
+    startWorker(path, priority);
 }
 
-void KDirectoryContentsCounter::slotResult(const QString& path, int count, long size)
+void KDirectoryContentsCounter::slotResult(const QString& path, const KDirectoryContentsCounterWorker::CountResult& countResult)
 {
-    m_workerIsBusy = false;
-
-    const QFileInfo info = QFileInfo(path);
-    const QString resolvedPath = info.canonicalFilePath();
-
-    if (!m_dirWatcher->contains(resolvedPath)) {
+    const QString& resolvedPath = countResult.resolvedPath;
+    if (!resolvedPath.isEmpty() && !m_dirWatcher->contains(resolvedPath)) {
         m_dirWatcher->addDir(resolvedPath);
         m_watchedDirs.insert(resolvedPath);
     }
 
-    if (!m_queue.isEmpty()) {
-        startWorker(m_queue.takeFirst());
-    }
-
-    if (s_cache->contains(resolvedPath)) {
-        const auto pair = s_cache->value(resolvedPath);
-        if (pair.first == count && pair.second == size) {
-            // no change no need to send another result event
-            return;
-        }
+    if (countResult.cached) {
+        // The cached result has been validated by KDirectorySizeCache. Changes
+        // that happen while the directory is shown are reported by KDirWatch.
+        emit result(path, countResult.count, countResult.size);
+        return;
     }
 
-    if (info.dir().path() == m_model->rootItem().url().path()) {
-        // update cache or overwrite value
-        // when path is a direct children of the current model root
-        s_cache->insert(resolvedPath, QPair<int, long>(count, size));
+    if (countResult.unchanged) {
+        // no change no need to send another result event
+        return;
     }
 
     // sends the results
-    emit result(resolvedPath, count, size);
+    emit result(resolvedPath.isEmpty() ? path : resolvedPath, countResult.count, countResult.size);
 }
 
 void KDirectoryContentsCounter::slotDirWatchDirty(const QString& path)
@@ -136,7 +115,10 @@ void KDirectoryContentsCounter::slotDirWatchDirty(const QString& path)
             return;
         }
 
-        startWorker(path);
+        // The cached results are invalidated by the worker, as the
+        // cache might still be loaded
+        m_invalidatedPaths.insert(path);
+        startWorker(path, Normal);
     }
 }
 
@@ -144,6 +126,12 @@ void KDirectoryContentsCounter::slotItemsRemoved()
 {
     const bool allItemsRemoved = (m_model->count() == 0);
 
+    if (allItemsRemoved) {
+        // The directory has been changed or reloaded: results for the
+        // previous contents are not needed anymore.
+        cancelAll();
+    }
+
     if (!m_watchedDirs.isEmpty()) {
         // Don't let KDirWatch watch for removed items
         if (allItemsRemoved) {
@@ -151,7 +139,6 @@ void KDirectoryContentsCounter::slotItemsRemoved()
                 m_dirWatcher->removeDir(path);
             }
             m_watchedDirs.clear();
-            m_queue.clear();
         } else {
             QMutableSetIterator<QString> it(m_watchedDirs);
             while (it.hasNext()) {
@@ -165,33 +152,107 @@ void KDirectoryContentsCounter::slotItemsRemoved()
     }
 }
 
-void KDirectoryContentsCounter::startWorker(const QString& path)
+void KDirectoryContentsCounter::slotDirectoryRefreshing()
 {
-    if (s_cache->contains(path)) {
-        // fast path when in cache
-        // will be updated later if result has changed
-        const auto pair = s_cache->value(path);
-        emit result(path, pair.first, pair.second);
+    // A change deep inside a directory tree does not invalidate the cached
+    // results, so the shown directories are counted again when the user
+    // explicitly asks for the current state. The items are removed from the
+    // model and counted after reloading.
+    m_refreshedPaths.clear();
+    const int count = m_model->count();
+    for (int i = 0; i < count; ++i) {
+        const KFileItem item = m_model->fileItem(i);
+        if (item.isDir() && item.isLocalFile()) {
+            m_refreshedPaths.insert(item.localPath());
+        }
     }
+}
 
-    if (m_workerIsBusy) {
-        if (!m_queue.contains(path)) {
-            m_queue.append(path);
+void KDirectoryContentsCounter::startWorker(const QString& path, PathCountPriority priority)
+{
+    if (priority == High) {
+        if (!m_priorityQueue.contains(path)) {
+            m_queue.removeOne(path);
+            m_priorityQueue.append(path);
         }
-    } else {
-        KDirectoryContentsCounterWorker::Options options;
+    } else if (!m_priorityQueue.contains(path) && !m_queue.contains(path)) {
+        m_queue.append(path);
+    }
 
-        if (m_model->showHiddenFiles()) {
-            options |= KDirectoryContentsCounterWorker::CountHiddenFiles;
-        }
+    startQueuedTasks();
+}
+
+void KDirectoryContentsCounter::startQueuedTasks()
+{
+    const int maxTasks = maxParallelTasks();
+    if (s_counterThreadPool->maxThreadCount() != maxTasks) {
+        s_counterThreadPool->setMaxThreadCount(maxTasks);
+    }
+
+    KDirectoryContentsCounterWorker::Options options;
+
+    if (m_model->showHiddenFiles()) {
+        options |= KDirectoryContentsCounterWorker::CountHiddenFiles;
+    }
+
+    if (m_model->showDirectoriesOnly()) {
+        options |= KDirectoryContentsCounterWorker::CountDirectoriesOnly;
+    }
+
+    QString path;
+    while (m_runningPaths.count() < maxTasks && takeNextPath(path)) {
+        m_runningPaths.insert(path);
 
-        if (m_model->showDirectoriesOnly()) {
-            options |= KDirectoryContentsCounterWorker::CountDirectoriesOnly;
+        KDirectoryContentsCounterWorker::Options pathOptions = options;
+        const bool invalidated = m_invalidatedPaths.remove(path);
+        const bool refreshed = m_refreshedPaths.remove(path);
+        if (invalidated) {
+            pathOptions |= KDirectoryContentsCounterWorker::InvalidateCache;
+        } else if (!refreshed) {
+            pathOptions |= KDirectoryContentsCounterWorker::ReadCache;
         }
 
-        emit requestDirectoryContentsCount(path, options);
-        m_workerIsBusy = true;
+        const QSharedPointer<QAtomicInt> cancelled = m_cancelled;
+        auto watcher = new QFutureWatcher<KDirectoryContentsCounterWorker::CountResult>(this);
+        connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, path, cancelled]() {
+            watcher->deleteLater();
+            if (cancelled->load()) {
+                // The result belongs to a directory that is not shown anymore.
+                return;
+            }
+
+            m_runningPaths.remove(path);
+            slotResult(path, watcher->result());
+            startQueuedTasks();
+        });
+        watcher->setFuture(QtConcurrent::run(s_counterThreadPool(), &KDirectoryContentsCounterWorker::cachedSubItemsCount,
+                                             path, pathOptions, cancelled));
+    }
+}
+
+bool KDirectoryContentsCounter::takeNextPath(QString& path)
+{
+    // A path that is being counted right now stays in the queue until its
+    // result is available, such that changes that occurred in the meantime
+    // are taken into account by counting it again.
+    for (QLinkedList<QString>* queue : {&m_priorityQueue, &m_queue}) {
+        for (auto it = queue->begin(); it != queue->end(); ++it) {
+            if (!m_runningPaths.contains(*it)) {
+                path = *it;
+                queue->erase(it);
+                return true;
+            }
+        }
     }
+    return false;
 }
 
-QThread* KDirectoryContentsCounter::m_workerThread = nullptr;
+void KDirectoryContentsCounter::cancelAll()
+{
+    m_cancelled->store(1);
+    m_cancelled.reset(new QAtomicInt(0));
+    m_runningPaths.clear();
+    m_invalidatedPaths.clear();
+    m_priorityQueue.clear();
+    m_queue.clear();
+}
@@ -21,6 +21,7 @@
 #ifndef KDIRECTORYCONTENTSCOUNTER_H
 #define KDIRECTORYCONTENTSCOUNTER_H
 
+#include "dolphin_export.h"
 #include "kdirectorycontentscounterworker.h"
 
 #include <QLinkedList>
@@ -31,11 +32,22 @@ class KDirWatch;
 class KFileItemModel;
 class QString;
 
-class KDirectoryContentsCounter : public QObject
+/**
+ * @brief Counts the contents of directories asynchronously.
+ *
+ * The counting is done by up to DetailsModeSettings::directoryContentsCounterThreadCount()
+ * tasks in parallel. Requests with a high priority (e.g., for visible items) are
+ * processed before all requests with a normal priority. All pending and running
+ * requests are cancelled if the model is cleared, e.g., because the directory
+ * has been changed.
+ */
+class DOLPHIN_EXPORT KDirectoryContentsCounter : public QObject
 {
     Q_OBJECT
 
 public:
+    enum PathCountPriority { Normal, High };
+
     explicit KDirectoryContentsCounter(KFileItemModel* model, QObject* parent = nullptr);
     ~KDirectoryContentsCounter() override;
 
@@ -47,10 +59,12 @@ public:
      * The directory \a path is watched for changes, and the signal is emitted
      * again if a change occurs.
      *
-     * Uses a cache internally to speed up first result,
-     * but emit again result when the cache was updated
+     * Uses a persistent cache (see KDirectorySizeCache): A valid cached result
+     * is announced without counting the directory. The directory is only counted
+     * again if KDirWatch reports a change or if the user refreshes the directory
+     * of the model (see KFileItemModel::refreshDirectory()).
      */
-    void scanDirectory(const QString& path);
+    void scanDirectory(const QString& path, PathCountPriority priority = Normal);
 
 signals:
     /**
@@ -59,29 +73,55 @@ signals:
      */
     void result(const QString& path, int count, long size);
 
-    void requestDirectoryContentsCount(const QString& path, KDirectoryContentsCounterWorker::Options options);
-
 private slots:
-    void slotResult(const QString& path, int count, long size);
+    void slotResult(const QString& path, const KDirectoryContentsCounterWorker::CountResult& countResult);
     void slotDirWatchDirty(const QString& path);
     void slotItemsRemoved();
+    void slotDirectoryRefreshing();
 
 private:
-    void startWorker(const QString& path);
+    void startWorker(const QString& path, PathCountPriority priority);
+
+    /**
+     * Starts counting tasks for queued paths as long as the maximum number
+     * of parallel tasks has not been reached.
+     */
+    void startQueuedTasks();
+
+    /**
+     * Removes the first path that is not being counted yet from the queues
+     * and stores it in \a path. Paths with a high priority are preferred.
+     * @return False if no such path exists.
+     */
+    bool takeNextPath(QString& path);
+
+    /**
+     * Cancels all running tasks and clears the queues.
+     */
+    void cancelAll();
 
 private:
     KFileItemModel* m_model;
 
+    QLinkedList<QString> m_priorityQueue;
     QLinkedList<QString> m_queue;
+    QSet<QString> m_runningPaths;
+
+    // Paths of the directories that were shown when the user refreshed the
+    // directory of the model. Their cached results are not used.
+    QSet<QString> m_refreshedPaths;
 
-    static QThread* m_workerThread;
+    // Paths whose cached results must be invalidated before counting
+    QSet<QString> m_invalidatedPaths;
 
-    KDirectoryContentsCounterWorker* m_worker;
-    bool m_workerIsBusy;
+    // Shared with all running tasks, which abort counting if it is set.
+    QSharedPointer<QAtomicInt> m_cancelled;
 
     KDirWatch* m_dirWatcher;
     QSet<QString> m_watchedDirs;    // Required as sadly KDirWatch does not offer a getter method
                                     // to get all watched directories.
+
+    friend class KDirectoryContentsCounterTest; // For unit testing
 };
 
 #endif
@@ -19,6 +19,9 @@
  ***************************************************************************/
 
 #include "kdirectorycontentscounterworker.h"
+#include "kdirectorysizecache.h"
+
+#include <QFileInfo>
 
 // Required includes for subItemsCount():
 #ifdef Q_OS_WIN
@@ -26,31 +29,41 @@
 #else
 #include <QFile>
 #include <qplatformdefs.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include "dolphin_detailsmodesettings.h"
 
-KDirectoryContentsCounterWorker::KDirectoryContentsCounterWorker(QObject* parent) :
-    QObject(parent)
-{
-    qRegisterMetaType<KDirectoryContentsCounterWorker::Options>();
-}
-
 #ifndef Q_OS_WIN
-KDirectoryContentsCounterWorker::CountResult walkDir(const QString &dirPath,
-                                                     const bool countHiddenFiles,
-                                                     const bool countDirectoriesOnly,
-                                                     QT_DIRENT *dirEntry,
-                                                     const uint allowedRecursiveLevel)
+/**
+ * Counts the entries of the directory that is referred to by the file descriptor
+ * \a dirFd, which is owned and closed by this function. Sub-directories are opened
+ * and stat'ed relative to their parent with openat() and fstatat(), so that
+ * no paths have to be built for the entries.
+ */
+static KDirectoryContentsCounterWorker::CountResult walkDir(int dirFd,
+                                                            const bool countHiddenFiles,
+                                                            const bool countDirectoriesOnly,
+                                                            const uint allowedRecursiveLevel,
+                                                            const QAtomicInt* cancelled)
 {
     int count = -1;
     long size = -1;
-    auto dir = QT_OPENDIR(QFile::encodeName(dirPath));
+    DIR* dir = fdopendir(dirFd);
     if (dir) {
         count = 0;
-        QT_STATBUF buf;
+        struct stat buf;
+        struct dirent* dirEntry;
+
+        while ((dirEntry = readdir(dir))) {
+            if (cancelled && cancelled->load()) {
+                break;
+            }
 
-        while ((dirEntry = QT_READDIR(dir))) {
             if (dirEntry->d_name[0] == '.') {
                 if (dirEntry->d_name[1] == '\0' || !countHiddenFiles) {
                     // Skip "." or hidden files
@@ -76,10 +89,9 @@ KDirectoryContentsCounterWorker::CountResult walkDir(const QString &dirPath,
             if (allowedRecursiveLevel > 0) {
 
                 bool linkFound = false;
-                QString nameBuf = QStringLiteral("%1/%2").arg(dirPath, dirEntry->d_name);
 
                 if (dirEntry->d_type == DT_REG || dirEntry->d_type == DT_LNK) {
-                    if (QT_STAT(nameBuf.toLocal8Bit(), &buf) == 0) {
+                    if (fstatat(::dirfd(dir), dirEntry->d_name, &buf, 0) == 0) {
                         if (S_ISDIR(buf.st_mode)) {
                             // was a dir link, recurse
                             linkFound = true;
@@ -89,22 +101,32 @@ KDirectoryContentsCounterWorker::CountResult walkDir(const QString &dirPath,
                 }
                 if (dirEntry->d_type == DT_DIR || linkFound) {
                     // recursion for dirs and dir links
-                    size += walkDir(nameBuf, countHiddenFiles, countDirectoriesOnly, dirEntry, allowedRecursiveLevel - 1).size;
+                    const int subDirFd = openat(::dirfd(dir), dirEntry->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                    if (subDirFd >= 0) {
+                        size += walkDir(subDirFd, countHiddenFiles, countDirectoriesOnly, allowedRecursiveLevel - 1, cancelled).size;
+                    } else {
+                        // Same result as for a directory that cannot be read
+                        size += -1;
+                    }
                 }
             }
         }
-        QT_CLOSEDIR(dir);
+        closedir(dir);
+    } else {
+        QT_CLOSE(dirFd);
     }
-    return KDirectoryContentsCounterWorker::CountResult{count, size};
+    return KDirectoryContentsCounterWorker::CountResult{count, size, QString(), false, false};
 }
 #endif
 
-KDirectoryContentsCounterWorker::CountResult KDirectoryContentsCounterWorker::subItemsCount(const QString& path, Options options)
+KDirectoryContentsCounterWorker::CountResult KDirectoryContentsCounterWorker::subItemsCount(const QString& path, Options options,
+                                                                                            const QSharedPointer<QAtomicInt>& cancelled)
 {
     const bool countHiddenFiles = options & CountHiddenFiles;
     const bool countDirectoriesOnly = options & CountDirectoriesOnly;
 
 #ifdef Q_OS_WIN
+    Q_UNUSED(cancelled)
     QDir dir(path);
     QDir::Filters filters = QDir::NoDotAndDotDot | QDir::System;
     if (countHiddenFiles) {
@@ -115,21 +137,49 @@ KDirectoryContentsCounterWorker::CountResult KDirectoryContentsCounterWorker::su
     } else {
         filters |= QDir::AllEntries;
     }
-    return {dir.entryList(filters).count(), 0};
+    return {dir.entryList(filters).count(), 0, QString(), false, false};
 #else
 
     const uint maxRecursiveLevel = DetailsModeSettings::directorySizeCount() ? 1 : DetailsModeSettings::recursiveDirectorySizeLimit();
 
-    QT_DIRENT *dirEntry = nullptr;
-
-    auto res = walkDir(QFile::encodeName(path), countHiddenFiles, countDirectoriesOnly, dirEntry, maxRecursiveLevel);
+    const int dirFd = QT_OPEN(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return {-1, -1, QString(), false, false};
+    }
 
-    return res;
+    return walkDir(dirFd, countHiddenFiles, countDirectoriesOnly, maxRecursiveLevel, cancelled.data());
 #endif
 }
 
-void KDirectoryContentsCounterWorker::countDirectoryContents(const QString& path, Options options)
+KDirectoryContentsCounterWorker::CountResult KDirectoryContentsCounterWorker::cachedSubItemsCount(const QString& path, Options options,
+                                                                                                  const QSharedPointer<QAtomicInt>& cancelled)
 {
-    auto res = subItemsCount(path, options);
-    emit result(path, res.count, res.size);
+    KDirectorySizeCache* cache = KDirectorySizeCache::instance();
+    const QString resolvedPath = QFileInfo(path).canonicalFilePath();
+
+    if (options & InvalidateCache) {
+        // The sizes of all ancestors include the size of this directory
+        cache->invalidate(resolvedPath.isEmpty() ? path : resolvedPath);
+    }
+
+    int cachedCount;
+    long cachedSize;
+    const bool hasCachedResult = !resolvedPath.isEmpty() && cache->value(resolvedPath, cachedCount, cachedSize);
+    if (hasCachedResult && (options & ReadCache)) {
+        return {cachedCount, cachedSize, resolvedPath, true, false};
+    }
+
+    CountResult result = subItemsCount(path, options, cancelled);
+    result.resolvedPath = resolvedPath;
+    if (cancelled && cancelled->load()) {
+        // The result is incomplete and will be dropped anyhow
+        return result;
+    }
+
+    if (hasCachedResult && result.count == cachedCount && result.size == cachedSize) {
+        result.unchanged = true;
+    } else if (result.count >= 0 && !resolvedPath.isEmpty()) {
+        cache->insert(resolvedPath, result.count, result.size);
+    }
+    return result;
 }
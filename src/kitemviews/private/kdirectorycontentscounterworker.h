@@ -20,20 +20,30 @@
 #ifndef KDIRECTORYCONTENTSCOUNTERWORKER_H
 #define KDIRECTORYCONTENTSCOUNTERWORKER_H
 
+#include <QAtomicInt>
+#include <QFlags>
 #include <QMetaType>
-#include <QObject>
+#include <QSharedPointer>
+#include <QString>
 
-class QString;
-
-class KDirectoryContentsCounterWorker : public QObject
+/**
+ * @brief Counts the items inside a directory and optionally determines the
+ *        size of its contents.
+ *
+ * KDirectoryContentsCounter runs KDirectoryContentsCounterWorker::cachedSubItemsCount()
+ * for several directories in parallel in a thread pool.
+ */
+class KDirectoryContentsCounterWorker
 {
-    Q_OBJECT
-
 public:
     enum Option {
         NoOptions = 0x0,
         CountHiddenFiles = 0x1,
-        CountDirectoriesOnly = 0x2
+        CountDirectoriesOnly = 0x2,
+        /// Return the cached result without counting, if it is still valid
+        ReadCache = 0x4,
+        /// Remove the cached results of the directory and all its ancestors
+        InvalidateCache = 0x8
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -43,33 +53,35 @@ public:
         /// Recursive sum of the size of the directory content files and folders
         /// Calculation depends on DetailsModeSettings::recursiveDirectorySizeLimit
         long size;
+        /// Canonical path of the directory (only set by cachedSubItemsCount())
+        QString resolvedPath;
+        /// True if the result has been read from KDirectorySizeCache
+        bool cached;
+        /// True if the counted result is equal to the cached one
+        bool unchanged;
     };
 
-    explicit KDirectoryContentsCounterWorker(QObject* parent = nullptr);
-
     /**
      * Counts the items inside the directory \a path using the options
-     * \a options.
+     * \a options. This method is reentrant and may be called from any thread.
+     *
+     * If \a cancelled is set and becomes non-zero while counting, the
+     * counting is aborted and the (incomplete) result is returned.
      *
      * @return The number of items.
      */
-    static CountResult subItemsCount(const QString& path, Options options);
-
-signals:
-    /**
-     * Signals that the directory \a path contains \a count items and optionally the size of its content.
-     */
-    void result(const QString& path, int count, long size);
+    static CountResult subItemsCount(const QString& path, Options options,
+                                     const QSharedPointer<QAtomicInt>& cancelled = QSharedPointer<QAtomicInt>());
 
-public slots:
     /**
-     * Requests the number of items inside the directory \a path using the
-     * options \a options. The result is announced via the signal \a result.
+     * Like subItemsCount(), but uses KDirectorySizeCache: If \a options contains
+     * ReadCache and a valid cached result exists, it is returned without counting.
+     * Otherwise the counted result is stored in the cache. This method is meant
+     * to be called from a worker thread, as the canonical path of the directory
+     * must be resolved and the cache might block until it has been loaded.
      */
-    // Note that the full type name KDirectoryContentsCounterWorker::Options
-    // is needed here. Just using 'Options' is OK for the compiler, but
-    // confuses moc.
-    void countDirectoryContents(const QString& path, KDirectoryContentsCounterWorker::Options options);
+    static CountResult cachedSubItemsCount(const QString& path, Options options,
+                                           const QSharedPointer<QAtomicInt>& cancelled = QSharedPointer<QAtomicInt>());
 };
 
 Q_DECLARE_METATYPE(KDirectoryContentsCounterWorker::Options)
@@ -0,0 +1,327 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kdirectorysizecache.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QVector>
+#include <QtConcurrentRun>
+
+#ifndef Q_OS_WIN
+#include <qplatformdefs.h>
+#endif
+
+#include <algorithm>
+
+namespace {
+    // Magic number and version of the cache file
+    const quint32 CacheFileMagic = 0x444F4C53; // "DOLS"
+    const quint32 CacheFileVersion = 1;
+
+    // Maximum number of entries. If more entries are present, the least
+    // recently used ones are dropped when saving.
+    const int MaximumEntryCount = 100000;
+
+    // Delay in ms before a modified cache is written to disk
+    const int SaveDelay = 5000;
+}
+
+class KDirectorySizeCacheSingleton
+{
+public:
+    KDirectorySizeCache instance;
+};
+Q_GLOBAL_STATIC(KDirectorySizeCacheSingleton, s_directorySizeCache)
+
+KDirectorySizeCache* KDirectorySizeCache::instance()
+{
+    return &s_directorySizeCache->instance;
+}
+
+KDirectorySizeCache::KDirectorySizeCache() :
+    KDirectorySizeCache(QString())
+{
+}
+
+KDirectorySizeCache::KDirectorySizeCache(const QString& fileName) :
+    QObject(nullptr),
+    m_fileName(fileName),
+    m_maximumEntryCount(MaximumEntryCount),
+    m_mutex(),
+    m_entries(),
+    m_modified(false),
+    m_saveMutex(),
+    m_loadFuture(),
+    m_saveFuture(),
+    m_saveTimer(nullptr)
+{
+    if (m_fileName.isEmpty()) {
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (!cacheDir.isEmpty()) {
+            m_fileName = cacheDir + QLatin1String("/directorysizes");
+        }
+    }
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SaveDelay);
+    connect(m_saveTimer, &QTimer::timeout, this, [this]() {
+        m_saveFuture = QtConcurrent::run(this, &KDirectorySizeCache::save);
+    });
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &KDirectorySizeCache::save);
+    }
+
+    // The cache file might contain many entries, so don't block the
+    // main thread while reading it.
+    m_loadFuture = QtConcurrent::run(this, &KDirectorySizeCache::load);
+}
+
+KDirectorySizeCache::~KDirectorySizeCache()
+{
+    m_loadFuture.waitForFinished();
+    m_saveFuture.waitForFinished();
+}
+
+bool KDirectorySizeCache::value(const QString& path, int& count, long& size)
+{
+    waitForLoaded();
+
+    qint64 modificationTime;
+    quint64 inode;
+    const bool exists = statDirectory(path, modificationTime, inode);
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(path);
+    if (it == m_entries.end()) {
+        return false;
+    }
+
+    if (!exists || modificationTime != it->modificationTime || inode != it->inode) {
+        // The directory has been changed or replaced
+        m_entries.erase(it);
+        scheduleSave();
+        return false;
+    }
+
+    it->lastUsed = QDateTime::currentMSecsSinceEpoch();
+    count = it->count;
+    size = static_cast<long>(it->size);
+    return true;
+}
+
+void KDirectorySizeCache::insert(const QString& path, int count, long size)
+{
+    waitForLoaded();
+
+    Entry entry;
+    if (!statDirectory(path, entry.modificationTime, entry.inode)) {
+        return;
+    }
+    entry.count = count;
+    entry.size = size;
+    entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+
+    QMutexLocker locker(&m_mutex);
+    m_entries.insert(path, entry);
+    scheduleSave();
+}
+
+void KDirectorySizeCache::invalidate(const QString& path)
+{
+    waitForLoaded();
+
+    QMutexLocker locker(&m_mutex);
+    bool removed = false;
+    QString ancestor = path;
+    while (!ancestor.isEmpty()) {
+        removed |= (m_entries.remove(ancestor) > 0);
+
+        const QString parent = QFileInfo(ancestor).path();
+        if (parent == ancestor) {
+            break;
+        }
+        ancestor = parent;
+    }
+
+    if (removed) {
+        scheduleSave();
+    }
+}
+
+void KDirectorySizeCache::save()
+{
+    waitForLoaded();
+
+    QMutexLocker saveLocker(&m_saveMutex);
+
+    QHash<QString, Entry> entries;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_modified || m_fileName.isEmpty()) {
+            return;
+        }
+
+        if (m_entries.count() > m_maximumEntryCount) {
+            // Drop the least recently used entries
+            QVector<qint64> lastUsed;
+            lastUsed.reserve(m_entries.count());
+            for (const Entry& entry : qAsConst(m_entries)) {
+                lastUsed.append(entry.lastUsed);
+            }
+            auto nth = lastUsed.end() - m_maximumEntryCount;
+            std::nth_element(lastUsed.begin(), nth, lastUsed.end());
+            const qint64 threshold = *nth;
+
+            auto it = m_entries.begin();
+            while (it != m_entries.end()) {
+                if (it->lastUsed < threshold) {
+                    it = m_entries.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        // The entries are implicitly shared, so writing them does not
+        // block other threads that access the cache.
+        entries = m_entries;
+        m_modified = false;
+    }
+
+    QDir().mkpath(QFileInfo(m_fileName).path());
+
+    QSaveFile file(m_fileName);
+    bool saved = file.open(QIODevice::WriteOnly);
+    if (saved) {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << CacheFileMagic << CacheFileVersion << static_cast<quint32>(entries.count());
+        for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+            const Entry& entry = it.value();
+            stream << it.key() << static_cast<qint32>(entry.count) << entry.size
+                   << entry.modificationTime << entry.inode << entry.lastUsed;
+        }
+        saved = file.commit();
+    }
+
+    if (!saved) {
+        // Try again with the next modification
+        QMutexLocker locker(&m_mutex);
+        m_modified = true;
+    }
+}
+
+void KDirectorySizeCache::load()
+{
+    if (m_fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic;
+    quint32 version;
+    quint32 entryCount;
+    stream >> magic >> version >> entryCount;
+    if (stream.status() != QDataStream::Ok || magic != CacheFileMagic || version != CacheFileVersion) {
+        return;
+    }
+
+    QHash<QString, Entry> entries;
+    entries.reserve(qMin<quint32>(entryCount, m_maximumEntryCount));
+    for (quint32 i = 0; i < entryCount; ++i) {
+        QString path;
+        qint32 count;
+        Entry entry;
+        stream >> path >> count >> entry.size >> entry.modificationTime >> entry.inode >> entry.lastUsed;
+        if (stream.status() != QDataStream::Ok) {
+            // The file is truncated or corrupt
+            return;
+        }
+        entry.count = count;
+        entries.insert(path, entry);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_entries = entries;
+}
+
+void KDirectorySizeCache::waitForLoaded()
+{
+    // If loading has not been started yet, the calling thread loads the file
+    m_loadFuture.waitForFinished();
+}
+
+void KDirectorySizeCache::scheduleSave()
+{
+    m_modified = true;
+
+    // The timer may only be started in the thread of this object
+    QMetaObject::invokeMethod(this, &KDirectorySizeCache::startSaveTimer, Qt::QueuedConnection);
+}
+
+void KDirectorySizeCache::startSaveTimer()
+{
+    if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
+    }
+}
+
+bool KDirectorySizeCache::statDirectory(const QString& path, qint64& modificationTime, quint64& inode)
+{
+#ifdef Q_OS_WIN
+    const QFileInfo info(path);
+    if (!info.isDir()) {
+        return false;
+    }
+    modificationTime = info.lastModified().toMSecsSinceEpoch();
+    inode = 0;
+    return true;
+#else
+    QT_STATBUF buf;
+    if (QT_STAT(QFile::encodeName(path).constData(), &buf) != 0 || !S_ISDIR(buf.st_mode)) {
+        return false;
+    }
+#if defined(Q_OS_DARWIN)
+    modificationTime = static_cast<qint64>(buf.st_mtimespec.tv_sec) * 1000000000 + buf.st_mtimespec.tv_nsec;
+#else
+    modificationTime = static_cast<qint64>(buf.st_mtim.tv_sec) * 1000000000 + buf.st_mtim.tv_nsec;
+#endif
+    inode = static_cast<quint64>(buf.st_ino);
+    return true;
+#endif
+}
@@ -0,0 +1,135 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KDIRECTORYSIZECACHE_H
+#define KDIRECTORYSIZECACHE_H
+
+#include "dolphin_export.h"
+
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+class QTimer;
+
+/**
+ * @brief Persistent cache for the results of KDirectoryContentsCounter.
+ *
+ * The number of items and the size of a directory are stored together with
+ * the modification time and the inode of the directory. An entry is only
+ * returned if both still match the directory on disk. The cache is stored
+ * in the user's cache directory, such that the sizes of large directory trees
+ * are available immediately after restarting Dolphin.
+ *
+ * As the modification time of a directory only changes if its direct children
+ * change, entries must be invalidated with invalidate() if a change inside a
+ * directory is noticed, which also removes the entries of all its ancestors.
+ *
+ * The cache may be used from any thread. As the cache file is loaded in the
+ * background, value(), insert() and invalidate() might block until it has
+ * been loaded and should not be called from the main thread. However the
+ * first call of instance() must be done in the main thread.
+ */
+class DOLPHIN_EXPORT KDirectorySizeCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static KDirectorySizeCache* instance();
+
+    ~KDirectorySizeCache() override;
+
+    /**
+     * Looks up the cached result for the canonical path \a path.
+     * @return True if a valid entry has been found. In this case, \a count
+     *         and \a size contain the cached result.
+     */
+    bool value(const QString& path, int& count, long& size);
+
+    /**
+     * Stores the result for the canonical path \a path.
+     */
+    void insert(const QString& path, int count, long size);
+
+    /**
+     * Removes the entries for the canonical path \a path and all its ancestors.
+     */
+    void invalidate(const QString& path);
+
+    /**
+     * Writes the cache to disk if it has been modified.
+     */
+    void save();
+
+private:
+    KDirectorySizeCache();
+
+    /**
+     * Creates a cache that is stored in \a fileName instead of
+     * the user's cache directory.
+     */
+    explicit KDirectorySizeCache(const QString& fileName);
+
+    void load();
+    void waitForLoaded();
+
+    /**
+     * Marks the cache as modified and starts the timer for writing
+     * it to disk. Must be called while m_mutex is locked.
+     */
+    void scheduleSave();
+    void startSaveTimer();
+
+    /**
+     * Reads the modification time and inode of the directory \a path.
+     * @return False if the directory cannot be stat'ed.
+     */
+    static bool statDirectory(const QString& path, qint64& modificationTime, quint64& inode);
+
+private:
+    struct Entry {
+        int count;
+        qint64 size;
+        qint64 modificationTime;
+        quint64 inode;
+        qint64 lastUsed;
+    };
+
+    QString m_fileName;
+    int m_maximumEntryCount;
+
+    // Protects m_entries and m_modified
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    bool m_modified;
+
+    // Assures that the cache file is not written by two threads at once
+    QMutex m_saveMutex;
+
+    QFuture<void> m_loadFuture;
+    QFuture<void> m_saveFuture;
+    QTimer* m_saveTimer;
+
+    friend class KDirectorySizeCacheSingleton;
+    friend class KDirectorySizeCacheTest; // For unit testing
+};
+
+#endif
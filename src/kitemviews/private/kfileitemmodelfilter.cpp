@@ -24,10 +24,17 @@
 
 #include <KFileItem>
 
+namespace {
+    bool isWildcardPattern(const QString& pattern)
+    {
+        return pattern.contains('*') || pattern.contains('?') || pattern.contains('[');
+    }
+}
+
 KFileItemModelFilter::KFileItemModelFilter() :
     m_useRegExp(false),
     m_regExp(nullptr),
-    m_lowerCasePattern(),
+    m_foldedPattern(),
     m_pattern()
 {
 }
@@ -41,9 +48,9 @@ KFileItemModelFilter::~KFileItemModelFilter()
 void KFileItemModelFilter::setPattern(const QString& filter)
 {
     m_pattern = filter;
-    m_lowerCasePattern = filter.toLower();
+    m_foldedPattern = filter.toCaseFolded();
 
-    if (filter.contains('*') || filter.contains('?') || filter.contains('[')) {
+    if (isWildcardPattern(filter)) {
         if (!m_regExp) {
             m_regExp = new QRegularExpression();
             m_regExp->setPatternOptions(QRegularExpression::CaseInsensitiveOption);
@@ -88,23 +95,23 @@ bool KFileItemModelFilter::matches(const KFileItem& item) const
 
     // If both filters are set, return true when both filters are matched
     if (hasPatternFilter && hasMimeTypesFilter) {
-        return (matchesPattern(item) && matchesType(item));
+        return (matchesPattern(item, item.text().toCaseFolded()) && matchesType(item));
     }
 
     // If only one filter is set, return true when that filter is matched
     if (hasPatternFilter) {
-        return matchesPattern(item);
+        return matchesPattern(item, item.text().toCaseFolded());
     }
 
     return matchesType(item);
 }
 
-bool KFileItemModelFilter::matchesPattern(const KFileItem& item) const
+bool KFileItemModelFilter::matchesPattern(const KFileItem& item, const QString& foldedText) const
 {
     if (m_useRegExp) {
         return m_regExp->match(item.text()).hasMatch();
     } else {
-        return item.text().toLower().contains(m_lowerCasePattern);
+        return foldedText.contains(m_foldedPattern);
     }
 }
 
@@ -118,3 +125,18 @@ bool KFileItemModelFilter::matchesType(const KFileItem& item) const
 
     return m_mimeTypes.isEmpty();
 }
+
+bool KFileItemModelFilter::patternImplies(const QString& pattern, const QString& otherPattern)
+{
+    if (otherPattern.isEmpty()) {
+        // Each item matches an empty pattern.
+        return true;
+    }
+
+    if (isWildcardPattern(pattern) || isWildcardPattern(otherPattern)) {
+        return pattern == otherPattern;
+    }
+
+    // Each text which contains 'pattern' also contains its sub-string 'otherPattern'.
+    return pattern.toCaseFolded().contains(otherPattern.toCaseFolded());
+}
@@ -70,21 +70,32 @@ public:
      */
     bool matches(const KFileItem& item) const;
 
-private:
     /**
      * @return True if item matches pattern set by @ref setPattern.
+     *         \a foldedText must be the case folded text of the item.
+     *         Unlike matches(), this method may be called from several
+     *         threads at the same time.
      */
-    bool matchesPattern(const KFileItem& item) const;
+    bool matchesPattern(const KFileItem& item, const QString& foldedText) const;
 
     /**
      * @return True if item matches mimetypes set by @ref setMimeTypes.
+     *         Note that this might determine the mimetype of the item.
      */
     bool matchesType(const KFileItem& item) const;
 
+    /**
+     * @return True if each item which matches \a pattern also matches
+     *         \a otherPattern. If this cannot be decided easily, e.g.
+     *         because the patterns contain wildcards, false is returned.
+     */
+    static bool patternImplies(const QString& pattern, const QString& otherPattern);
+
+private:
     bool m_useRegExp;           // If true, m_regExp is used for filtering,
-                                // otherwise m_lowerCaseFilter is used.
+                                // otherwise m_foldedPattern is used.
     QRegularExpression *m_regExp;
-    QString m_lowerCasePattern; // Lowercase version of m_filter for
+    QString m_foldedPattern;    // Case folded version of m_pattern for
                                 // faster comparison in matches().
     QString m_pattern;          // Property set by setPattern().
     QStringList m_mimeTypes;    // Property set by setMimeTypes()
@@ -0,0 +1,165 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemlistframetimemonitor.h"
+
+#include "dolphindebug.h"
+
+namespace {
+    // Time in ms which is available for one frame at 60 frames per second
+    const qreal FrameBudget = 1000.0 / 60.0;
+
+    // Weight of a new sample for the moving averages
+    const qreal SampleWeight = 0.2;
+
+    // Number of paint and layout samples which are required
+    // before the animations are adapted
+    const int MinimumSampleCount = 3;
+
+    // The policy is only relaxed again if the frame time is this factor
+    // below the limit, so that it does not flip on every sample.
+    const qreal Hysteresis = 0.75;
+
+    // Durations of the item animations in ms
+    const int FullAnimationDuration = 200;
+    const int ShortAnimationDuration = 100;
+}
+
+KItemListFrameTimeMonitor::KItemListFrameTimeMonitor() :
+    m_paintTime(0),
+    m_layoutTime(0),
+    m_paintSampleCount(0),
+    m_layoutSampleCount(0),
+    m_animationPolicy(FullAnimations)
+{
+}
+
+void KItemListFrameTimeMonitor::addPaintTime(qint64 nsecs)
+{
+    const qreal msecs = nsecs / 1000000.0;
+    m_paintTime = (m_paintSampleCount == 0) ? msecs : m_paintTime + SampleWeight * (msecs - m_paintTime);
+    ++m_paintSampleCount;
+    updateAnimationPolicy();
+}
+
+void KItemListFrameTimeMonitor::addLayoutTime(qint64 nsecs)
+{
+    const qreal msecs = nsecs / 1000000.0;
+    m_layoutTime = (m_layoutSampleCount == 0) ? msecs : m_layoutTime + SampleWeight * (msecs - m_layoutTime);
+    ++m_layoutSampleCount;
+    updateAnimationPolicy();
+}
+
+qreal KItemListFrameTimeMonitor::paintTime() const
+{
+    return m_paintTime;
+}
+
+qreal KItemListFrameTimeMonitor::layoutTime() const
+{
+    return m_layoutTime;
+}
+
+qreal KItemListFrameTimeMonitor::frameTime() const
+{
+    return m_paintTime + m_layoutTime;
+}
+
+KItemListFrameTimeMonitor::AnimationPolicy KItemListFrameTimeMonitor::animationPolicy() const
+{
+    return m_animationPolicy;
+}
+
+int KItemListFrameTimeMonitor::animationDuration() const
+{
+    switch (m_animationPolicy) {
+    case FullAnimations:  return FullAnimationDuration;
+    case ShortAnimations: return ShortAnimationDuration;
+    case NoAnimations:    return 1;
+    default:              break;
+    }
+    Q_ASSERT(false);
+    return FullAnimationDuration;
+}
+
+void KItemListFrameTimeMonitor::reset()
+{
+    m_paintTime = 0;
+    m_layoutTime = 0;
+    m_paintSampleCount = 0;
+    m_layoutSampleCount = 0;
+    m_animationPolicy = FullAnimations;
+}
+
+void KItemListFrameTimeMonitor::updateAnimationPolicy()
+{
+    if (m_paintSampleCount < MinimumSampleCount || m_layoutSampleCount < MinimumSampleCount) {
+        return;
+    }
+
+    // Animations are shortened if a frame takes more than half of the budget,
+    // so that there is still time left for the rest of the application. They
+    // are turned off if not even every second frame can be shown.
+    const qreal shortLimit = FrameBudget / 2;
+    const qreal noLimit = FrameBudget * 2;
+    const qreal time = frameTime();
+
+    AnimationPolicy policy = m_animationPolicy;
+    switch (m_animationPolicy) {
+    case FullAnimations:
+        if (time > noLimit) {
+            policy = NoAnimations;
+        } else if (time > shortLimit) {
+            policy = ShortAnimations;
+        }
+        break;
+    case ShortAnimations:
+        if (time > noLimit) {
+            policy = NoAnimations;
+        } else if (time < shortLimit * Hysteresis) {
+            policy = FullAnimations;
+        }
+        break;
+    case NoAnimations:
+        if (time < shortLimit * Hysteresis) {
+            policy = FullAnimations;
+        } else if (time < noLimit * Hysteresis) {
+            policy = ShortAnimations;
+        }
+        break;
+    default:
+        Q_ASSERT(false);
+        break;
+    }
+
+    if (policy != m_animationPolicy) {
+        m_animationPolicy = policy;
+        qCDebug(DolphinDebug) << "Changed the animation policy:" << *this;
+    }
+}
+
+QDebug operator<<(QDebug debug, const KItemListFrameTimeMonitor& monitor)
+{
+    static const char* const policyNames[] = {"full", "short", "none"};
+
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "KItemListFrameTimeMonitor(paint " << monitor.paintTime() << " ms, layout "
+                    << monitor.layoutTime() << " ms, animations " << policyNames[monitor.animationPolicy()] << ')';
+    return debug;
+}
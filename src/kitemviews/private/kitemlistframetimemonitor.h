@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KITEMLISTFRAMETIMEMONITOR_H
+#define KITEMLISTFRAMETIMEMONITOR_H
+
+#include "dolphin_export.h"
+
+#include <QtGlobal>
+
+class QDebug;
+
+/**
+ * @brief Internal helper class for KItemListView to adapt the animations
+ *        to the measured painting and layouting costs.
+ *
+ * Animating many items on a slow system or a remote desktop makes the view
+ * feel slower instead of smoother. KItemListView reports the time needed
+ * for each layout and each paint of the view. The monitor keeps moving
+ * averages of these times and derives whether animations should be shown
+ * in full length, shortened or not at all.
+ *
+ * The measured times are written to the debug output whenever the animation
+ * policy changes, and can be read with KItemListView::frameTimeMonitor().
+ */
+class DOLPHIN_EXPORT KItemListFrameTimeMonitor
+{
+public:
+    enum AnimationPolicy {
+        FullAnimations,
+        ShortAnimations,
+        NoAnimations
+    };
+
+    KItemListFrameTimeMonitor();
+
+    /**
+     * Adds the time \a nsecs in nanoseconds that was required
+     * to paint the view once.
+     */
+    void addPaintTime(qint64 nsecs);
+
+    /**
+     * Adds the time \a nsecs in nanoseconds that was required
+     * to layout the view once.
+     */
+    void addLayoutTime(qint64 nsecs);
+
+    /**
+     * @return Moving average of the paint times in milliseconds.
+     */
+    qreal paintTime() const;
+
+    /**
+     * @return Moving average of the layout times in milliseconds.
+     */
+    qreal layoutTime() const;
+
+    /**
+     * @return Estimated time in milliseconds for one frame of an animation,
+     *         which requires both a layout and a paint of the view.
+     */
+    qreal frameTime() const;
+
+    AnimationPolicy animationPolicy() const;
+
+    /**
+     * @return Duration in milliseconds for the item animations that fits
+     *         to animationPolicy().
+     */
+    int animationDuration() const;
+
+    /**
+     * Forgets all measured times. The animation policy is reset to
+     * FullAnimations.
+     */
+    void reset();
+
+private:
+    void updateAnimationPolicy();
+
+private:
+    qreal m_paintTime;
+    qreal m_layoutTime;
+    int m_paintSampleCount;
+    int m_layoutSampleCount;
+    AnimationPolicy m_animationPolicy;
+};
+
+DOLPHIN_EXPORT QDebug operator<<(QDebug debug, const KItemListFrameTimeMonitor& monitor);
+
+#endif
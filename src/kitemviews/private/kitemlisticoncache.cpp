@@ -0,0 +1,165 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemlisticoncache.h"
+
+#include "kpixmapmodifier.h"
+
+#include <KIconEffect>
+#include <KIconLoader>
+
+#include <QGuiApplication>
+
+namespace {
+    // Maximum size of the cached pixmaps in kilobytes
+    const int MaximumCacheCost = 20 * 1024;
+}
+
+Q_GLOBAL_STATIC(KItemListIconCache, s_iconCache)
+
+uint qHash(const KItemListIconCache::Key& key, uint seed)
+{
+    return qHash(key.name, seed) ^ qHash(key.overlays, seed) ^ uint(key.size) ^
+           uint(key.mode << 8) ^ uint(key.effects << 12) ^ key.selectionColor;
+}
+
+KItemListIconCache* KItemListIconCache::instance()
+{
+    return s_iconCache();
+}
+
+KItemListIconCache::KItemListIconCache() :
+    QObject(nullptr),
+    m_cache(MaximumCacheCost)
+{
+    // The icons might look different with the new settings or icon theme
+    connect(KIconLoader::global(), &KIconLoader::iconLoaderSettingsChanged,
+            this, &KItemListIconCache::clear);
+}
+
+KItemListIconCache::~KItemListIconCache()
+{
+}
+
+QPixmap KItemListIconCache::pixmap(const QString& name, const QStringList& overlays, int size, QIcon::Mode mode,
+                                   Effects effects, const QColor& selectionColor)
+{
+    return cachedPixmap(name, overlays, size, qApp->devicePixelRatio(), mode, effects, selectionColor);
+}
+
+void KItemListIconCache::clear()
+{
+    m_cache.clear();
+}
+
+void KItemListIconCache::applyEffects(QPixmap& pixmap, Effects effects, const QColor& selectionColor)
+{
+    KIconEffect* effect = KIconLoader::global()->iconEffect();
+
+    if (effects.testFlag(CutEffect)) {
+        pixmap = effect->apply(pixmap, KIconLoader::Desktop, KIconLoader::DisabledState);
+    }
+
+    if (effects.testFlag(HiddenEffect)) {
+        KIconEffect::semiTransparent(pixmap);
+    }
+
+    if (effects.testFlag(SelectedEffect)) {
+        QImage image = pixmap.toImage();
+        KIconEffect::colorize(image, selectionColor, 0.8f);
+        pixmap = QPixmap::fromImage(image);
+    }
+
+    // In the KIconLoader terminology, active = hover.
+    if (effects.testFlag(HoverEffect) && effect->hasEffect(KIconLoader::Desktop, KIconLoader::ActiveState)) {
+        pixmap = effect->apply(pixmap, KIconLoader::Desktop, KIconLoader::ActiveState);
+    }
+}
+
+QPixmap KItemListIconCache::cachedPixmap(const QString& name, const QStringList& overlays, int size, qreal devicePixelRatio,
+                                         QIcon::Mode mode, Effects effects, const QColor& selectionColor)
+{
+    const QRgb color = effects.testFlag(SelectedEffect) ? selectionColor.rgba() : 0;
+    const Key key = {name, overlays.join(QLatin1Char(':')), size, devicePixelRatio, mode, int(effects), color};
+
+    const QPixmap* cachedResult = m_cache.object(key);
+    if (cachedResult) {
+        return *cachedResult;
+    }
+
+    QPixmap result;
+    if (effects == NoEffect) {
+        result = loadPixmap(name, overlays, size * devicePixelRatio, devicePixelRatio, mode);
+    } else {
+        // Apply the effects to the shared pixmap without effects, so that
+        // the icon is loaded only once for all states.
+        result = cachedPixmap(name, overlays, size, devicePixelRatio, mode, NoEffect, QColor());
+        applyEffects(result, effects, selectionColor);
+    }
+    result.setDevicePixelRatio(devicePixelRatio);
+
+    const int cost = qMax(1, result.width() * result.height() * result.depth() / (8 * 1024));
+    m_cache.insert(key, new QPixmap(result), cost);
+    return result;
+}
+
+QPixmap KItemListIconCache::loadPixmap(const QString& name, const QStringList& overlays, int size, qreal devicePixelRatio,
+                                       QIcon::Mode mode)
+{
+    static const QIcon fallbackIcon = QIcon::fromTheme(QStringLiteral("unknown"));
+
+    const QIcon icon = QIcon::fromTheme(name, fallbackIcon);
+
+    QPixmap pixmap = icon.pixmap(size / devicePixelRatio, size / devicePixelRatio, mode);
+    if (pixmap.width() != size || pixmap.height() != size) {
+        KPixmapModifier::scale(pixmap, QSize(size, size));
+    }
+
+    // Strangely KFileItem::overlays() returns empty string-values, so
+    // we need to check first whether an overlay must be drawn at all.
+    // It is more efficient to do it here, as KIconLoader::drawOverlays()
+    // assumes that an overlay will be drawn and has some additional
+    // setup time.
+    foreach (const QString& overlay, overlays) {
+        if (!overlay.isEmpty()) {
+            int state = KIconLoader::DefaultState;
+
+            switch (mode) {
+            case QIcon::Normal:
+                break;
+            case QIcon::Active:
+                state = KIconLoader::ActiveState;
+                break;
+            case QIcon::Disabled:
+                state = KIconLoader::DisabledState;
+                break;
+            case QIcon::Selected:
+                state = KIconLoader::SelectedState;
+                break;
+            }
+
+            // There is at least one overlay, draw all overlays above the pixmap
+            // and cancel the check
+            KIconLoader::global()->drawOverlays(overlays, pixmap, KIconLoader::Desktop, state);
+            break;
+        }
+    }
+
+    return pixmap;
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KITEMLISTICONCACHE_H
+#define KITEMLISTICONCACHE_H
+
+#include "dolphin_export.h"
+
+#include <QCache>
+#include <QColor>
+#include <QIcon>
+#include <QObject>
+#include <QPixmap>
+#include <QStringList>
+
+/**
+ * @brief Shared cache for the icons of KStandardItemListWidget.
+ *
+ * Thousands of items usually share a few dozen MIME type icons. Instead of
+ * loading the icon and applying the icon effects for the cut, hidden,
+ * selected and hovered state in each widget, the resulting pixmaps are
+ * cached by icon name, overlays, size, device pixel ratio, icon mode and
+ * effects. As QPixmap is implicitly shared, all widgets that show the
+ * same icon in the same state use the same pixmap data.
+ *
+ * The cache may only be used in the GUI thread.
+ */
+class DOLPHIN_EXPORT KItemListIconCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Effect {
+        NoEffect = 0,
+        CutEffect = 1,
+        HiddenEffect = 2,
+        SelectedEffect = 4,
+        HoverEffect = 8
+    };
+    Q_DECLARE_FLAGS(Effects, Effect)
+
+    static KItemListIconCache* instance();
+
+    KItemListIconCache();
+    ~KItemListIconCache() override;
+
+    /**
+     * @return Pixmap for the icon with the name \a name, the overlays
+     *         \a overlays and the size \a size in device independent pixels,
+     *         to which the effects \a effects have been applied. The color
+     *         \a selectionColor is only used for the SelectedEffect.
+     */
+    QPixmap pixmap(const QString& name, const QStringList& overlays, int size, QIcon::Mode mode,
+                   Effects effects = NoEffect, const QColor& selectionColor = QColor());
+
+    void clear();
+
+    /**
+     * Applies the effects \a effects to \a pixmap. Can be used for custom
+     * pixmaps like previews, which are not shared by several items.
+     */
+    static void applyEffects(QPixmap& pixmap, Effects effects, const QColor& selectionColor);
+
+private:
+    /**
+     * Helper method for pixmap(): Uses the device pixel ratio \a devicePixelRatio
+     * instead of the one of the application.
+     */
+    QPixmap cachedPixmap(const QString& name, const QStringList& overlays, int size, qreal devicePixelRatio,
+                         QIcon::Mode mode, Effects effects, const QColor& selectionColor);
+
+    static QPixmap loadPixmap(const QString& name, const QStringList& overlays, int size, qreal devicePixelRatio,
+                              QIcon::Mode mode);
+
+private:
+    struct Key {
+        QString name;
+        QString overlays;
+        int size;
+        qreal devicePixelRatio;
+        int mode;
+        int effects;
+        QRgb selectionColor;
+
+        bool operator==(const Key& other) const
+        {
+            return name == other.name && overlays == other.overlays &&
+                   size == other.size && devicePixelRatio == other.devicePixelRatio &&
+                   mode == other.mode && effects == other.effects &&
+                   selectionColor == other.selectionColor;
+        }
+    };
+    friend uint qHash(const Key& key, uint seed);
+
+    QCache<Key, QPixmap> m_cache;
+
+    friend class KItemListIconCacheTest; // For unit testing
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KItemListIconCache::Effects)
+
+#endif
@@ -20,11 +20,26 @@
 #include "kitemlistsizehintresolver.h"
 #include "kitemviews/kitemlistview.h"
 
+namespace {
+    // Number of items whose exact size hints are used to get the initial
+    // estimation for the size hints of all other items
+    const int EstimationSampleCount = 32;
+
+    // The estimated height is only updated if the average of the exact
+    // heights differs by at least this amount.
+    const qreal EstimatedHeightTolerance = 1.0;
+}
+
 KItemListSizeHintResolver::KItemListSizeHintResolver(const KItemListView* itemListView) :
     m_itemListView(itemListView),
     m_logicalHeightHintCache(),
     m_logicalWidthHint(0.0),
+    m_logicalHeightHint(0.0),
     m_minHeightHint(0.0),
+    m_estimatedLogicalHeightHint(0.0),
+    m_exactLogicalHeightHintSum(0.0),
+    m_exactLogicalHeightHintCount(0),
+    m_firstEstimatedIndex(0),
     m_needsResolving(false)
 {
 }
@@ -42,7 +57,93 @@ QSizeF KItemListSizeHintResolver::minSizeHint()
 QSizeF KItemListSizeHintResolver::sizeHint(int index)
 {
     updateCache();
-    return QSizeF(m_logicalWidthHint, m_logicalHeightHintCache.at(index));
+    const qreal logicalHeightHint = m_logicalHeightHintCache.at(index);
+    return QSizeF(m_logicalWidthHint, logicalHeightHint > 0.0 ? logicalHeightHint : m_estimatedLogicalHeightHint);
+}
+
+bool KItemListSizeHintResolver::isSizeHintEstimated(int index) const
+{
+    return m_logicalHeightHintCache.at(index) <= 0.0;
+}
+
+KItemRange KItemListSizeHintResolver::resolveRange(int firstIndex, int lastIndex)
+{
+    updateCache();
+
+    firstIndex = qMax(firstIndex, 0);
+    lastIndex = qMin(lastIndex, m_logicalHeightHintCache.count() - 1);
+
+    // Skip the items at the borders of the range which have exact heights already
+    while (firstIndex <= lastIndex && m_logicalHeightHintCache.at(firstIndex) > 0.0) {
+        ++firstIndex;
+    }
+    while (lastIndex >= firstIndex && m_logicalHeightHintCache.at(lastIndex) > 0.0) {
+        --lastIndex;
+    }
+    if (firstIndex > lastIndex) {
+        return KItemRange();
+    }
+
+    const qreal previousEstimatedHeightHint = m_estimatedLogicalHeightHint;
+    const QVector<qreal> previousHeightHints = m_logicalHeightHintCache.mid(firstIndex, lastIndex - firstIndex + 1);
+
+    calculateHeightHints(firstIndex, lastIndex);
+    updateEstimatedHeightHint();
+
+    int firstChangedIndex = -1;
+    int lastChangedIndex = -1;
+    for (int i = 0; i < previousHeightHints.count(); ++i) {
+        const qreal previousHeightHint = previousHeightHints.at(i) > 0.0 ? previousHeightHints.at(i) : previousEstimatedHeightHint;
+        if (m_logicalHeightHintCache.at(firstIndex + i) != previousHeightHint) {
+            if (firstChangedIndex < 0) {
+                firstChangedIndex = firstIndex + i;
+            }
+            lastChangedIndex = firstIndex + i;
+        }
+    }
+
+    if (m_estimatedLogicalHeightHint != previousEstimatedHeightHint && hasEstimatedSizeHints()) {
+        // All items which still have an estimated height are affected
+        int lastEstimatedIndex = m_logicalHeightHintCache.count() - 1;
+        while (m_logicalHeightHintCache.at(lastEstimatedIndex) > 0.0) {
+            --lastEstimatedIndex;
+        }
+
+        if (firstChangedIndex < 0) {
+            firstChangedIndex = m_firstEstimatedIndex;
+            lastChangedIndex = lastEstimatedIndex;
+        } else {
+            firstChangedIndex = qMin(firstChangedIndex, m_firstEstimatedIndex);
+            lastChangedIndex = qMax(lastChangedIndex, lastEstimatedIndex);
+        }
+    }
+
+    if (firstChangedIndex < 0) {
+        return KItemRange();
+    }
+    return KItemRange(firstChangedIndex, lastChangedIndex - firstChangedIndex + 1);
+}
+
+KItemRange KItemListSizeHintResolver::resolveEstimatedSizeHints(int count)
+{
+    if (!hasEstimatedSizeHints()) {
+        return KItemRange();
+    }
+
+    const int firstIndex = m_firstEstimatedIndex;
+    const int lastIndex = qMin(firstIndex + count, m_logicalHeightHintCache.count()) - 1;
+    const KItemRange changedRange = resolveRange(firstIndex, lastIndex);
+    m_firstEstimatedIndex = lastIndex + 1;
+    return changedRange;
+}
+
+bool KItemListSizeHintResolver::hasEstimatedSizeHints()
+{
+    const int count = m_logicalHeightHintCache.count();
+    while (m_firstEstimatedIndex < count && m_logicalHeightHintCache.at(m_firstEstimatedIndex) > 0.0) {
+        ++m_firstEstimatedIndex;
+    }
+    return m_firstEstimatedIndex < count;
 }
 
 void KItemListSizeHintResolver::itemsInserted(const KItemRangeList& itemRanges)
@@ -81,6 +182,7 @@ void KItemListSizeHintResolver::itemsInserted(const KItemRangeList& itemRanges)
         }
     }
 
+    m_firstEstimatedIndex = 0;
     m_needsResolving = true;
 
     Q_ASSERT(m_logicalHeightHintCache.count() == m_itemListView->model()->count());
@@ -88,6 +190,10 @@ void KItemListSizeHintResolver::itemsInserted(const KItemRangeList& itemRanges)
 
 void KItemListSizeHintResolver::itemsRemoved(const KItemRangeList& itemRanges)
 {
+    foreach (const KItemRange& range, itemRanges) {
+        removeExactHeightHints(range.index, range.index + range.count - 1);
+    }
+
     const QVector<qreal>::iterator begin = m_logicalHeightHintCache.begin();
     const QVector<qreal>::iterator end = m_logicalHeightHintCache.end();
 
@@ -112,6 +218,7 @@ void KItemListSizeHintResolver::itemsRemoved(const KItemRangeList& itemRanges)
     }
 
     m_logicalHeightHintCache.erase(destIt, end);
+    m_firstEstimatedIndex = 0;
 
     // Note that the cache size might temporarily not match the model size if
     // this function is called from KItemListView::setModel() to empty the cache.
@@ -131,30 +238,86 @@ void KItemListSizeHintResolver::itemsMoved(const KItemRange& range, const QList<
     }
 
     m_logicalHeightHintCache = newLogicalHeightHintCache;
+    m_firstEstimatedIndex = 0;
 }
 
 void KItemListSizeHintResolver::itemsChanged(int index, int count, const QSet<QByteArray>& roles)
 {
     Q_UNUSED(roles)
+    removeExactHeightHints(index, index + count - 1);
     while (count) {
         m_logicalHeightHintCache[index] = 0.0;
         ++index;
         --count;
     }
 
+    m_firstEstimatedIndex = 0;
     m_needsResolving = true;
 }
 
 void KItemListSizeHintResolver::clearCache()
 {
     m_logicalHeightHintCache.fill(0.0);
+    m_estimatedLogicalHeightHint = 0.0;
+    m_exactLogicalHeightHintSum = 0.0;
+    m_exactLogicalHeightHintCount = 0;
+    m_firstEstimatedIndex = 0;
     m_needsResolving = true;
 }
 
 void KItemListSizeHintResolver::updateCache()
 {
     if (m_needsResolving) {
-        m_itemListView->calculateItemSizeHints(m_logicalHeightHintCache, m_logicalWidthHint);
+        // Only calculate the exact heights for a few items to get the width hint and
+        // a reasonable estimated height. KItemListView calls resolveRange()
+        // for the visible items.
+        const int lastIndex = qMin(m_logicalHeightHintCache.count(), EstimationSampleCount) - 1;
+        calculateHeightHints(0, lastIndex);
+        if (m_estimatedLogicalHeightHint <= 0.0) {
+            updateEstimatedHeightHint();
+        }
         m_needsResolving = false;
     }
 }
+
+void KItemListSizeHintResolver::calculateHeightHints(int firstIndex, int lastIndex)
+{
+    if (firstIndex > lastIndex) {
+        return;
+    }
+
+    removeExactHeightHints(firstIndex, lastIndex);
+    m_itemListView->calculateItemSizeHints(m_logicalHeightHintCache, m_logicalWidthHint, firstIndex, lastIndex);
+
+    for (int i = firstIndex; i <= lastIndex; ++i) {
+        const qreal logicalHeightHint = m_logicalHeightHintCache.at(i);
+        if (logicalHeightHint > 0.0) {
+            m_exactLogicalHeightHintSum += logicalHeightHint;
+            ++m_exactLogicalHeightHintCount;
+        }
+    }
+}
+
+void KItemListSizeHintResolver::removeExactHeightHints(int firstIndex, int lastIndex)
+{
+    for (int i = firstIndex; i <= lastIndex; ++i) {
+        const qreal logicalHeightHint = m_logicalHeightHintCache.at(i);
+        if (logicalHeightHint > 0.0) {
+            m_exactLogicalHeightHintSum -= logicalHeightHint;
+            --m_exactLogicalHeightHintCount;
+        }
+    }
+}
+
+void KItemListSizeHintResolver::updateEstimatedHeightHint()
+{
+    if (m_exactLogicalHeightHintCount <= 0) {
+        return;
+    }
+
+    const qreal averageHeightHint = m_exactLogicalHeightHintSum / m_exactLogicalHeightHintCount;
+    if (m_estimatedLogicalHeightHint <= 0.0
+        || qAbs(averageHeightHint - m_estimatedLogicalHeightHint) >= EstimatedHeightTolerance) {
+        m_estimatedLogicalHeightHint = averageHeightHint;
+    }
+}
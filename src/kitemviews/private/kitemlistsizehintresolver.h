@@ -30,6 +30,12 @@ class KItemListView;
 
 /**
  * @brief Calculates and caches the sizehints of items in KItemListView.
+ *
+ * Calculating the exact sizehint of an item might be expensive (e.g. for
+ * wrapped text in the icons mode). Exact sizehints are only calculated on
+ * demand with resolveRange(), which is done by KItemListView for the visible
+ * items. For all other items an estimated sizehint is returned, which gets
+ * replaced by the exact one in the background with resolveEstimatedSizeHints().
  */
 class DOLPHIN_EXPORT KItemListSizeHintResolver
 {
@@ -38,8 +44,44 @@ public:
     virtual ~KItemListSizeHintResolver();
     QSizeF maxSizeHint();
     QSizeF minSizeHint();
+
+    /**
+     * @return The exact sizehint of the item with the index \a index if it has
+     *         been calculated already, otherwise an estimated sizehint.
+     */
     QSizeF sizeHint(int index);
 
+    /**
+     * @return True if sizeHint() returns an estimated value for the item with
+     *         the index \a index.
+     */
+    bool isSizeHintEstimated(int index) const;
+
+    /**
+     * Calculates the exact sizehints for the items in the range
+     * [\a firstIndex, \a lastIndex]. Indexes outside the model are ignored.
+     *
+     * @return Range of the items whose sizehints have been changed and hence
+     *         must be relayouted. If the estimated sizehint has been changed,
+     *         all items that still have an estimated sizehint are part of the
+     *         range. An empty range is returned if no sizehint has been changed.
+     */
+    KItemRange resolveRange(int firstIndex, int lastIndex);
+
+    /**
+     * Calculates the exact sizehints for up to \a count items that only
+     * have an estimated sizehint yet.
+     *
+     * @return Range of the items whose sizehints have been changed
+     *         (see resolveRange()).
+     */
+    KItemRange resolveEstimatedSizeHints(int count);
+
+    /**
+     * @return True if at least one item only has an estimated sizehint.
+     */
+    bool hasEstimatedSizeHints();
+
     void itemsInserted(const KItemRangeList& itemRanges);
     void itemsRemoved(const KItemRangeList& itemRanges);
     void itemsMoved(const KItemRange& range, const QList<int>& movedToIndexes);
@@ -48,12 +90,37 @@ public:
     void clearCache();
     void updateCache();
 
+private:
+    /**
+     * Calculates the exact heights of the items in the range [\a firstIndex,
+     * \a lastIndex] and updates the sum of all exact heights.
+     */
+    void calculateHeightHints(int firstIndex, int lastIndex);
+
+    /**
+     * Removes the exact heights of the items in the range [\a firstIndex,
+     * \a lastIndex] from the sum of all exact heights.
+     */
+    void removeExactHeightHints(int firstIndex, int lastIndex);
+
+    /**
+     * Sets the estimated height to the average height of all items with
+     * exact heights. Small changes of the average are ignored, as each
+     * change of the estimated height requires to relayout all items with
+     * an estimated height.
+     */
+    void updateEstimatedHeightHint();
+
 private:
     const KItemListView* m_itemListView;
-    mutable QVector<qreal> m_logicalHeightHintCache;
+    mutable QVector<qreal> m_logicalHeightHintCache; // 0.0 for items without exact height
     mutable qreal m_logicalWidthHint;
     mutable qreal m_logicalHeightHint;
     mutable qreal m_minHeightHint;
+    qreal m_estimatedLogicalHeightHint;
+    qreal m_exactLogicalHeightHintSum; // Sum of the heights of all items with exact heights
+    int m_exactLogicalHeightHintCount;
+    int m_firstEstimatedIndex; // No item before this index has an estimated height
     bool m_needsResolving;
 };
 
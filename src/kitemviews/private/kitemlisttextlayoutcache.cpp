@@ -0,0 +1,148 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemlisttextlayoutcache.h"
+
+#include <QFontMetrics>
+#include <QMutexLocker>
+#include <QTextLayout>
+
+namespace {
+    // Maximum number of cached text layouts
+    const int MaximumCacheSize = 50000;
+}
+
+Q_GLOBAL_STATIC(KItemListTextLayoutCache, s_textLayoutCache)
+
+KItemListTextLayoutCache* KItemListTextLayoutCache::instance()
+{
+    return s_textLayoutCache();
+}
+
+KItemListTextLayoutCache::KItemListTextLayoutCache() :
+    m_mutex(),
+    m_cache(MaximumCacheSize)
+{
+}
+
+KItemListTextLayoutCache::~KItemListTextLayoutCache()
+{
+}
+
+KItemListTextLayoutCache::WrappedText KItemListTextLayoutCache::wrappedText(const QString& text, const QFont& font, qreal maxWidth, int maxTextLines)
+{
+    const Key key = {text, font.key(), maxWidth, maxTextLines};
+
+    {
+        QMutexLocker locker(&m_mutex);
+        const WrappedText* cachedText = m_cache.object(key);
+        if (cachedText) {
+            return *cachedText;
+        }
+    }
+
+    // Do the expensive layouting without holding the lock, so that other
+    // threads can use the cache meanwhile.
+    const WrappedText result = layoutText(text, font, maxWidth, maxTextLines);
+
+    QMutexLocker locker(&m_mutex);
+    m_cache.insert(key, new WrappedText(result));
+    return result;
+}
+
+void KItemListTextLayoutCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
+
+QString KItemListTextLayoutCache::elideRightKeepExtension(const QString& text, int elidingWidth, const QFontMetrics& fontMetrics)
+{
+    auto extensionIndex = text.lastIndexOf('.');
+    if (extensionIndex != -1) {
+        // has file extension
+        auto extensionLength = text.length() - extensionIndex;
+        auto extensionWidth = fontMetrics.width(text.right(extensionLength));
+        if (elidingWidth > extensionWidth && extensionLength < 6 && (float(extensionWidth) / float(elidingWidth)) < 0.3) {
+            // if we have room to display the file extension and the extension is not too long
+            QString ret = fontMetrics.elidedText(text.chopped(extensionLength),
+                                                 Qt::ElideRight,
+                                                 elidingWidth - extensionWidth);
+            ret.append(text.right(extensionLength));
+            return ret;
+        }
+    }
+    return fontMetrics.elidedText(text,Qt::ElideRight,
+                                  elidingWidth);
+}
+
+KItemListTextLayoutCache::WrappedText KItemListTextLayoutCache::layoutText(const QString& text, const QFont& font, qreal maxWidth, int maxTextLines)
+{
+    // QFontMetrics is not thread-safe, so a new instance is used for each call.
+    const QFontMetrics fontMetrics(font);
+
+    WrappedText result;
+    result.text = text;
+    result.width = 0;
+    result.height = 0;
+    result.lineCount = 0;
+
+    QTextOption textOption(Qt::AlignHCenter);
+    textOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+
+    QTextLayout layout(text, font);
+    layout.setTextOption(textOption);
+    layout.beginLayout();
+    QTextLine line;
+    while ((line = layout.createLine()).isValid()) {
+        line.setLineWidth(maxWidth);
+        result.width = qMax(result.width, line.naturalTextWidth());
+        result.height += line.height();
+
+        ++result.lineCount;
+        if (result.lineCount == maxTextLines) {
+            // The maximum number of textlines has been reached. If this is
+            // the case provide an elided text if necessary.
+            const int textLength = line.textStart() + line.textLength();
+            if (textLength < text.length()) {
+                // Elide the last line of the text
+                qreal elidingWidth = maxWidth;
+                qreal lastLineWidth;
+                do {
+                    QString lastTextLine = text.mid(line.textStart());
+                    lastTextLine = elideRightKeepExtension(lastTextLine, elidingWidth, fontMetrics);
+                    result.text = text.left(line.textStart()) + lastTextLine;
+
+                    lastLineWidth = fontMetrics.boundingRect(lastTextLine).width();
+
+                    // We do the text eliding in a loop with decreasing width (1 px / iteration)
+                    // to avoid problems related to different width calculation code paths
+                    // within Qt. (see bug 337104)
+                    elidingWidth -= 1.0;
+                } while (lastLineWidth > maxWidth);
+
+                result.width = qMax(result.width, lastLineWidth);
+            }
+            break;
+        }
+    }
+    layout.endLayout();
+
+    return result;
+}
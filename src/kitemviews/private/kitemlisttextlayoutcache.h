@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KITEMLISTTEXTLAYOUTCACHE_H
+#define KITEMLISTTEXTLAYOUTCACHE_H
+
+#include "dolphin_export.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QString>
+
+class QFont;
+class QFontMetrics;
+
+/**
+ * @brief Shared cache for the layout of wrapped item texts.
+ *
+ * Wrapping a text with QTextLayout is expensive. The same names are wrapped
+ * by the size hint calculation of KStandardItemListWidgetInformant, by each
+ * KStandardItemListWidget that shows the item, and again in each view that
+ * shows the same directory. The results are cached by text, font, maximum
+ * width and maximum number of lines. The least recently used results are
+ * dropped if the cache is full.
+ *
+ * All methods are thread-safe.
+ */
+class DOLPHIN_EXPORT KItemListTextLayoutCache
+{
+public:
+    struct WrappedText {
+        /// The text that should be shown. The last line is elided if the
+        /// text does not fit into the maximum number of lines.
+        QString text;
+        /// The maximum natural width of all lines
+        qreal width;
+        /// The sum of the heights of all lines
+        qreal height;
+        int lineCount;
+    };
+
+    static KItemListTextLayoutCache* instance();
+
+    KItemListTextLayoutCache();
+    ~KItemListTextLayoutCache();
+
+    /**
+     * @return The layout of \a text, which is wrapped at word boundaries or
+     *         anywhere into lines of the width \a maxWidth with the font \a font.
+     *         If \a maxTextLines is greater than 0, at most \a maxTextLines
+     *         lines are used.
+     */
+    WrappedText wrappedText(const QString& text, const QFont& font, qreal maxWidth, int maxTextLines);
+
+    void clear();
+
+    /**
+     * @return \a text elided at the right to fit into \a elidingWidth. If the
+     *         text has a short extension, the extension is kept visible.
+     */
+    static QString elideRightKeepExtension(const QString& text, int elidingWidth, const QFontMetrics& fontMetrics);
+
+private:
+    static WrappedText layoutText(const QString& text, const QFont& font, qreal maxWidth, int maxTextLines);
+
+private:
+    struct Key {
+        QString text;
+        QString font;
+        qreal maxWidth;
+        int maxTextLines;
+
+        bool operator==(const Key& other) const
+        {
+            return text == other.text && font == other.font &&
+                   maxWidth == other.maxWidth && maxTextLines == other.maxTextLines;
+        }
+    };
+    friend uint qHash(const Key& key, uint seed)
+    {
+        return qHash(key.text, seed) ^ qHash(key.font, seed) ^ qHash(key.maxWidth, seed) ^ uint(key.maxTextLines);
+    }
+
+    QMutex m_mutex;
+    QCache<Key, WrappedText> m_cache;
+
+    friend class KItemListTextLayoutCacheTest; // For unit testing
+};
+
+#endif
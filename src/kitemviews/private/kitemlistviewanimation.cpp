@@ -26,6 +26,7 @@ KItemListViewAnimation::KItemListViewAnimation(QObject* parent) :
     QObject(parent),
     m_scrollOrientation(Qt::Vertical),
     m_scrollOffset(0),
+    m_duration(200),
     m_animation()
 {
 }
@@ -109,12 +110,22 @@ qreal KItemListViewAnimation::scrollOffset() const
     return m_scrollOffset;
 }
 
+void KItemListViewAnimation::setDuration(int duration)
+{
+    m_duration = duration;
+}
+
+int KItemListViewAnimation::duration() const
+{
+    return m_duration;
+}
+
 void KItemListViewAnimation::start(QGraphicsWidget* widget, AnimationType type, const QVariant& endValue)
 {
     stop(widget, type);
 
     QPropertyAnimation* propertyAnim = nullptr;
-    const int animationDuration = widget->style()->styleHint(QStyle::SH_Widget_Animate) ? 200 : 1;
+    const int animationDuration = widget->style()->styleHint(QStyle::SH_Widget_Animate) ? m_duration : 1;
 
     switch (type) {
     case MovingAnimation: {
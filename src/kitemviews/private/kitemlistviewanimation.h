@@ -57,6 +57,14 @@ public:
     void setScrollOffset(qreal scrollOffset);
     qreal scrollOffset() const;
 
+    /**
+     * Sets the duration in milliseconds for animations that are started
+     * afterwards. The default duration is 200 ms. If the style turns off
+     * animations, the duration is ignored.
+     */
+    void setDuration(int duration);
+    int duration() const;
+
     /**
      * Starts the animation of the type \a type for the widget \a widget. If an animation
      * of the type is already running, this animation will be stopped before starting
@@ -96,6 +104,7 @@ private:
 
     Qt::Orientation m_scrollOrientation;
     qreal m_scrollOffset;
+    int m_duration;
     QHash<QGraphicsWidget*, QPropertyAnimation*> m_animation[AnimationTypeCount];
 };
 
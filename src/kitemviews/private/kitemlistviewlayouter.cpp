@@ -22,6 +22,11 @@
 #include "kitemlistsizehintresolver.h"
 #include "kitemviews/kitemmodelbase.h"
 
+#include <QtMath>
+
+#include <algorithm>
+#include <limits>
+
 // #define KITEMLISTVIEWLAYOUTER_DEBUG
 
 KItemListViewLayouter::KItemListViewLayouter(KItemListSizeHintResolver* sizeHintResolver, QObject* parent) :
@@ -46,6 +51,9 @@ KItemListViewLayouter::KItemListViewLayouter(KItemListSizeHintResolver* sizeHint
     m_columnCount(0),
     m_rowOffsets(),
     m_columnOffsets(),
+    m_firstDirtyIndex(-1),
+    m_lastDirtyIndex(-1),
+    m_groupsDirty(false),
     m_groupItemIndexes(),
     m_groupHeaderHeight(0),
     m_groupHeaderMargin(0),
@@ -250,6 +258,43 @@ QRectF KItemListViewLayouter::itemRect(int index) const
     return QRectF(pos, sizeHint);
 }
 
+int KItemListViewLayouter::indexAt(const QPointF& pos) const
+{
+    const_cast<KItemListViewLayouter*>(this)->doLayout();
+
+    foreach (const KItemRange& range, candidateItemRanges(QRectF(pos, QSizeF()))) {
+        for (int index = range.index; index < range.index + range.count; ++index) {
+            if (itemRect(index).contains(pos)) {
+                return index;
+            }
+        }
+    }
+
+    return -1;
+}
+
+KItemRangeList KItemListViewLayouter::itemRangesInRect(const QRectF& rect) const
+{
+    const_cast<KItemListViewLayouter*>(this)->doLayout();
+
+    KItemRangeList itemRanges;
+    foreach (const KItemRange& range, candidateItemRanges(rect)) {
+        for (int index = range.index; index < range.index + range.count; ++index) {
+            if (!itemRect(index).intersects(rect)) {
+                continue;
+            }
+
+            if (!itemRanges.isEmpty() && itemRanges.last().index + itemRanges.last().count == index) {
+                ++itemRanges.last().count;
+            } else {
+                itemRanges.append(KItemRange(index, 1));
+            }
+        }
+    }
+
+    return itemRanges;
+}
+
 QRectF KItemListViewLayouter::groupHeaderRect(int index) const
 {
     const_cast<KItemListViewLayouter*>(this)->doLayout();
@@ -338,7 +383,7 @@ int KItemListViewLayouter::maximumVisibleItems() const
 bool KItemListViewLayouter::isFirstGroupItem(int itemIndex) const
 {
     const_cast<KItemListViewLayouter*>(this)->doLayout();
-    return m_groupItemIndexes.contains(itemIndex);
+    return std::binary_search(m_groupItemIndexes.constBegin(), m_groupItemIndexes.constEnd(), itemIndex);
 }
 
 void KItemListViewLayouter::markAsDirty()
@@ -346,17 +391,90 @@ void KItemListViewLayouter::markAsDirty()
     m_dirty = true;
 }
 
+void KItemListViewLayouter::markItemsAsDirty(int firstIndex, int lastIndex)
+{
+    firstIndex = qMax(firstIndex, 0);
+    if (firstIndex > lastIndex) {
+        return;
+    }
+
+    if (m_firstDirtyIndex < 0) {
+        m_firstDirtyIndex = firstIndex;
+        m_lastDirtyIndex = lastIndex;
+    } else {
+        m_firstDirtyIndex = qMin(m_firstDirtyIndex, firstIndex);
+        m_lastDirtyIndex = qMax(m_lastDirtyIndex, lastIndex);
+    }
+}
+
+void KItemListViewLayouter::itemsInserted(const KItemRangeList& itemRanges)
+{
+    if (itemRanges.isEmpty()) {
+        return;
+    }
+
+    int insertedCount = 0;
+    foreach (const KItemRange& range, itemRanges) {
+        insertedCount += range.count;
+    }
+
+    // No item before the first range is moved. The items behind the last
+    // range are moved by insertedCount.
+    const int firstIndex = itemRanges.first().index;
+    const int lastIndex = itemRanges.last().index + insertedCount - 1;
+
+    if (m_firstDirtyIndex < 0) {
+        m_firstDirtyIndex = firstIndex;
+        m_lastDirtyIndex = lastIndex;
+    } else {
+        // The dirty range is related to the model before the insertion.
+        // Don't try to map it, just relayout all following items.
+        m_firstDirtyIndex = qMin(m_firstDirtyIndex, firstIndex);
+        m_lastDirtyIndex = std::numeric_limits<int>::max();
+    }
+}
+
+void KItemListViewLayouter::itemsRemoved(const KItemRangeList& itemRanges)
+{
+    if (itemRanges.isEmpty()) {
+        return;
+    }
+
+    int removedCount = 0;
+    foreach (const KItemRange& range, itemRanges) {
+        removedCount += range.count;
+    }
+
+    // The range of changed items is empty if only one range has been removed.
+    // The row of the item before the removed items is relayouted anyway.
+    const KItemRange& lastRange = itemRanges.last();
+    const int firstIndex = itemRanges.first().index;
+    const int lastIndex = lastRange.index + lastRange.count - removedCount - 1;
+
+    if (m_firstDirtyIndex < 0) {
+        m_firstDirtyIndex = firstIndex;
+        m_lastDirtyIndex = lastIndex;
+    } else {
+        m_firstDirtyIndex = qMin(m_firstDirtyIndex, firstIndex);
+        m_lastDirtyIndex = std::numeric_limits<int>::max();
+    }
+}
+
+void KItemListViewLayouter::markGroupsAsDirty()
+{
+    m_groupsDirty = true;
+}
 
 #ifndef QT_NO_DEBUG
-    bool KItemListViewLayouter::isDirty()
+    bool KItemListViewLayouter::isDirty() const
     {
-        return m_dirty;
+        return m_dirty || m_firstDirtyIndex >= 0 || m_groupsDirty;
     }
 #endif
 
 void KItemListViewLayouter::doLayout()
 {
-    if (m_dirty) {
+    if (m_dirty || m_firstDirtyIndex >= 0 || m_groupsDirty) {
 #ifdef KITEMLISTVIEWLAYOUTER_DEBUG
         QElapsedTimer timer;
         timer.start();
@@ -367,6 +485,7 @@ void KItemListViewLayouter::doLayout()
         QSizeF itemMargin = m_itemMargin;
         QSizeF size = m_size;
 
+        const QVector<int> previousGroupItemIndexes = m_groupItemIndexes;
         const bool grouped = createGroupHeaders();
 
         const bool horizontalScrolling = (m_scrollOrientation == Qt::Horizontal);
@@ -385,6 +504,10 @@ void KItemListViewLayouter::doLayout()
             }
         }
 
+        const qreal previousColumnWidth = m_columnWidth;
+        const qreal previousXPosInc = m_xPosInc;
+        const int previousColumnCount = m_columnCount;
+
         m_columnWidth = itemSize.width() + itemMargin.width();
         const qreal widthForColumns = size.width() - itemMargin.width();
         m_columnCount = qMax(1, int(widthForColumns / m_columnWidth));
@@ -401,8 +524,6 @@ void KItemListViewLayouter::doLayout()
             }
         }
 
-        m_itemInfos.resize(itemCount);
-
         // Calculate the offset of each column, i.e., the x-coordinate where the column starts.
         m_columnOffsets.resize(m_columnCount);
         qreal currentOffset = m_xPosInc;
@@ -418,29 +539,109 @@ void KItemListViewLayouter::doLayout()
             currentOffset += m_columnWidth;
         }
 
-        // Prepare the QVector which stores the y-coordinate for each new row.
-        int numberOfRows = (itemCount + m_columnCount - 1) / m_columnCount;
-        if (grouped && m_columnCount > 1) {
-            // In the worst case, a new row will be started for every group.
-            // We could calculate the exact number of rows now to prevent that we reserve
-            // too much memory, but the code required to do that might need much more
-            // memory than it would save in the average case.
-            numberOfRows += m_groupItemIndexes.count();
+        // The previous layout can be reused for the items before firstChangedIndex
+        // and for the rows after lastChangedIndex if only some items or groups
+        // have been changed.
+        const int itemCountDelta = itemCount - m_itemInfos.count();
+        bool incremental = !m_dirty
+                           && !m_itemInfos.isEmpty()
+                           && grouped == !previousGroupItemIndexes.isEmpty()
+                           && m_columnCount == previousColumnCount
+                           && m_columnWidth == previousColumnWidth
+                           && m_xPosInc == previousXPosInc
+                           && (m_firstDirtyIndex >= 0 || itemCountDelta == 0);
+
+        int firstChangedIndex = 0;
+        int lastChangedIndex = itemCount - 1;
+        if (incremental) {
+            if (m_firstDirtyIndex >= 0) {
+                firstChangedIndex = qMin(m_firstDirtyIndex, qMin(itemCount, m_itemInfos.count()));
+                lastChangedIndex = m_lastDirtyIndex;
+
+                // Move the information of the items after the dirty range to
+                // their new indexes. Only the information about the dirty items
+                // gets invalid.
+                if (itemCountDelta > 0) {
+                    m_itemInfos.insert(firstChangedIndex, itemCountDelta, ItemInfo());
+                } else if (itemCountDelta < 0) {
+                    m_itemInfos.remove(firstChangedIndex, -itemCountDelta);
+                }
+            } else {
+                firstChangedIndex = itemCount;
+                lastChangedIndex = -1;
+            }
+
+            // Take into account the groups which start at other items than before.
+            // As the groups are sorted, only the groups before the first and after
+            // the last differing group must be compared.
+            const int previousGroupCount = previousGroupItemIndexes.count();
+            const int groupCount = m_groupItemIndexes.count();
+
+            int first = 0;
+            while (first < previousGroupCount && first < groupCount
+                   && previousGroupItemIndexes[first] == m_groupItemIndexes[first]
+                   && m_groupItemIndexes[first] < firstChangedIndex) {
+                ++first;
+            }
+            if (first < previousGroupCount) {
+                firstChangedIndex = qMin(firstChangedIndex, previousGroupItemIndexes[first]);
+            }
+            if (first < groupCount) {
+                firstChangedIndex = qMin(firstChangedIndex, m_groupItemIndexes[first]);
+            }
+
+            int previousLast = previousGroupCount - 1;
+            int last = groupCount - 1;
+            while (previousLast >= 0 && last >= 0
+                   && previousGroupItemIndexes[previousLast] + itemCountDelta == m_groupItemIndexes[last]) {
+                --previousLast;
+                --last;
+            }
+            if (previousLast >= 0) {
+                lastChangedIndex = qMax(lastChangedIndex, previousGroupItemIndexes[previousLast] + itemCountDelta);
+            }
+            if (last >= 0) {
+                lastChangedIndex = qMax(lastChangedIndex, m_groupItemIndexes[last]);
+            }
+        } else {
+            m_itemInfos.resize(itemCount);
         }
-        m_rowOffsets.resize(numberOfRows);
 
-        qreal y = m_headerHeight + itemMargin.height();
+        // Start the layout with the row of the item before the first changed item,
+        // as the changed item might have been moved into this row.
+        int index = 0;
         int row = 0;
+        qreal y = m_headerHeight + itemMargin.height();
+        if (firstChangedIndex > 0) {
+            const ItemInfo& itemInfo = m_itemInfos.at(firstChangedIndex - 1);
+            index = firstChangedIndex - 1 - itemInfo.column;
+            row = itemInfo.row;
+            if (row > 0) {
+                y = m_rowOffsets.at(row);
+            }
+        }
+        const int firstRow = row;
 
-        int index = 0;
+        QVector<int>::const_iterator groupIt = std::lower_bound(m_groupItemIndexes.constBegin(), m_groupItemIndexes.constEnd(), index);
+        int nextGroupItemIndex = (groupIt != m_groupItemIndexes.constEnd()) ? *groupIt : itemCount;
+
+        // Stores the y-coordinates of the rows starting with firstRow.
+        QVector<qreal> rowOffsets;
+        rowOffsets.reserve((itemCount - index) / m_columnCount + 1);
+
+        bool rowsMoved = false;
         while (index < itemCount) {
             qreal maxItemHeight = itemSize.height();
 
-            if (grouped) {
-                if (m_groupItemIndexes.contains(index)) {
-                    // The item is the first item of a group.
-                    // Increase the y-position to provide space
-                    // for the group header.
+            if (index == nextGroupItemIndex) {
+                ++groupIt;
+                nextGroupItemIndex = (groupIt != m_groupItemIndexes.constEnd()) ? *groupIt : itemCount;
+
+                // The item is the first item of a group.
+                // Increase the y-position to provide space
+                // for the group header. The offset of the
+                // first relayouted row is known already.
+                if (row == 0 || row > firstRow) {
                     if (index > 0) {
                         // Only add a margin if there has been added another
                         // group already before
@@ -456,7 +657,19 @@ void KItemListViewLayouter::doLayout()
                 }
             }
 
-            m_rowOffsets[row] = y;
+            if (incremental && index > lastChangedIndex && m_itemInfos.at(index).column == 0) {
+                // The row starts with the same item like in the previous layout,
+                // and nothing has been changed after it. Only move the remaining
+                // rows of the previous layout.
+                const int previousRow = m_itemInfos.at(index).row;
+                const qreal offsetDelta = y - m_rowOffsets.at(previousRow);
+                moveRows(index, row - previousRow, offsetDelta);
+                m_maximumScrollOffset += offsetDelta;
+                rowsMoved = true;
+                break;
+            }
+
+            rowOffsets.append(y);
 
             int column = 0;
             while (index < itemCount && column < m_columnCount) {
@@ -494,7 +707,7 @@ void KItemListViewLayouter::doLayout()
                 ++index;
                 ++column;
 
-                if (grouped && m_groupItemIndexes.contains(index)) {
+                if (index == nextGroupItemIndex) {
                     // The item represents the first index of a group
                     // and must aligned in the first column
                     break;
@@ -505,18 +718,28 @@ void KItemListViewLayouter::doLayout()
             ++row;
         }
 
-        if (itemCount > 0) {
-            m_maximumScrollOffset = y;
-            m_maximumItemOffset = m_columnCount * m_columnWidth;
+        if (rowsMoved) {
+            std::copy(rowOffsets.constBegin(), rowOffsets.constEnd(), m_rowOffsets.begin() + firstRow);
         } else {
-            m_maximumScrollOffset = 0;
-            m_maximumItemOffset = 0;
+            if (firstRow == 0) {
+                m_rowOffsets.swap(rowOffsets);
+            } else {
+                m_rowOffsets.resize(row);
+                std::copy(rowOffsets.constBegin(), rowOffsets.constEnd(), m_rowOffsets.begin() + firstRow);
+            }
+            m_maximumScrollOffset = (itemCount > 0) ? y : 0;
         }
 
+        m_maximumItemOffset = (itemCount > 0) ? m_columnCount * m_columnWidth : 0;
+
 #ifdef KITEMLISTVIEWLAYOUTER_DEBUG
-        qCDebug(DolphinDebug) << "[TIME] doLayout() for " << m_model->count() << "items:" << timer.elapsed();
+        qCDebug(DolphinDebug) << "[TIME] doLayout() for " << m_model->count() << "items:" << timer.elapsed()
+                              << "relayouted rows:" << row - firstRow;
 #endif
         m_dirty = false;
+        m_firstDirtyIndex = -1;
+        m_lastDirtyIndex = -1;
+        m_groupsDirty = false;
     }
 
     updateVisibleIndexes();
@@ -528,7 +751,7 @@ void KItemListViewLayouter::updateVisibleIndexes()
         return;
     }
 
-    Q_ASSERT(!m_dirty);
+    Q_ASSERT(!isDirty());
 
     if (m_model->count() <= 0) {
         m_firstVisibleIndex = -1;
@@ -595,25 +818,140 @@ void KItemListViewLayouter::updateVisibleIndexes()
 
 bool KItemListViewLayouter::createGroupHeaders()
 {
+    m_groupItemIndexes.clear();
+
     if (!m_model->groupedSorting()) {
         return false;
     }
 
-    m_groupItemIndexes.clear();
-
     const QList<QPair<int, QVariant> > groups = m_model->groups();
     if (groups.isEmpty()) {
         return false;
     }
 
+    // The groups are sorted by their first item already.
+    m_groupItemIndexes.reserve(groups.count());
     for (int i = 0; i < groups.count(); ++i) {
         const int firstItemIndex = groups.at(i).first;
-        m_groupItemIndexes.insert(firstItemIndex);
+        m_groupItemIndexes.append(firstItemIndex);
     }
 
     return true;
 }
 
+void KItemListViewLayouter::moveRows(int index, int rowDelta, qreal offsetDelta)
+{
+    const int previousRow = m_itemInfos.at(index).row;
+    const int movedRowCount = m_itemInfos.last().row + 1 - previousRow;
+    const int row = previousRow + rowDelta;
+
+    if (rowDelta != 0) {
+        const int itemCount = m_itemInfos.count();
+        for (int i = index; i < itemCount; ++i) {
+            m_itemInfos[i].row += rowDelta;
+        }
+    }
+
+    // Move the row offsets from the end to the beginning if the rows are
+    // moved down, to assure that no offset gets overwritten before it has
+    // been moved itself.
+    if (rowDelta > 0) {
+        m_rowOffsets.resize(row + movedRowCount);
+        for (int i = movedRowCount - 1; i >= 0; --i) {
+            m_rowOffsets[row + i] = m_rowOffsets.at(previousRow + i) + offsetDelta;
+        }
+    } else {
+        if (rowDelta < 0 || offsetDelta != 0) {
+            for (int i = 0; i < movedRowCount; ++i) {
+                m_rowOffsets[row + i] = m_rowOffsets.at(previousRow + i) + offsetDelta;
+            }
+        }
+        m_rowOffsets.resize(row + movedRowCount);
+    }
+}
+
+KItemRangeList KItemListViewLayouter::candidateItemRanges(const QRectF& rect) const
+{
+    Q_ASSERT(!isDirty());
+
+    KItemRangeList candidates;
+    const int itemCount = m_itemInfos.count();
+    if (itemCount <= 0) {
+        return candidates;
+    }
+
+    // Map the rectangle to the logical coordinates, where the scroll
+    // direction is always vertical (see itemRect()).
+    qreal top;
+    qreal bottom;
+    qreal left;
+    qreal right;
+    if (m_scrollOrientation == Qt::Vertical) {
+        top = rect.top() + m_scrollOffset;
+        bottom = rect.bottom() + m_scrollOffset;
+        left = rect.left() + m_itemOffset;
+        right = rect.right() + m_itemOffset;
+    } else {
+        top = rect.left() + m_scrollOffset;
+        bottom = rect.right() + m_scrollOffset;
+        left = rect.top();
+        right = rect.bottom();
+    }
+
+    // The row offsets are sorted, and all items of a row end before the next
+    // row starts. Note that m_rowOffsets might contain more entries than rows.
+    const int rowCount = m_itemInfos.last().row + 1;
+    const QVector<qreal>::const_iterator rowsBegin = m_rowOffsets.constBegin();
+    const QVector<qreal>::const_iterator rowsEnd = rowsBegin + rowCount;
+    const int firstRow = qMax(0, int(std::upper_bound(rowsBegin, rowsEnd, top) - rowsBegin) - 1);
+    const int lastRow = int(std::upper_bound(rowsBegin, rowsEnd, bottom) - rowsBegin) - 1;
+    if (lastRow < firstRow) {
+        return candidates;
+    }
+
+    // All columns have the same width, and an item in the column c starts at
+    // m_columnOffsets[c]. Items which are wider than the column width (e.g.,
+    // in the Details view) are taken into account by using the item width.
+    int firstColumn = 0;
+    int lastColumn = m_columnCount - 1;
+    if (m_columnWidth > 0) {
+        const qreal columnsBegin = m_columnOffsets.first();
+        const qreal itemWidth = qMax(m_columnWidth, m_sizeHintResolver->sizeHint(0).width());
+        firstColumn = qMax(firstColumn, qFloor((left - itemWidth - columnsBegin) / m_columnWidth) + 1);
+        lastColumn = qMin(lastColumn, qFloor((right - columnsBegin) / m_columnWidth));
+    }
+    if (lastColumn < firstColumn) {
+        return candidates;
+    }
+
+    const auto rowLessThan = [](const ItemInfo& itemInfo, int row) {
+        return itemInfo.row < row;
+    };
+
+    const QVector<ItemInfo>::const_iterator itemsBegin = m_itemInfos.constBegin();
+    int rowStart = std::lower_bound(itemsBegin, m_itemInfos.constEnd(), firstRow, rowLessThan) - itemsBegin;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        // A row contains at most m_columnCount items, but it ends earlier if
+        // a new group starts.
+        const int maxRowEnd = qMin(rowStart + m_columnCount, itemCount);
+        const int rowEnd = std::lower_bound(itemsBegin + rowStart, itemsBegin + maxRowEnd, row + 1, rowLessThan) - itemsBegin;
+
+        const int first = rowStart + firstColumn;
+        const int last = qMin(rowStart + lastColumn, rowEnd - 1);
+        if (first <= last) {
+            if (!candidates.isEmpty() && candidates.last().index + candidates.last().count == first) {
+                candidates.last().count += last - first + 1;
+            } else {
+                candidates.append(KItemRange(first, last - first + 1));
+            }
+        }
+
+        rowStart = rowEnd;
+    }
+
+    return candidates;
+}
+
 qreal KItemListViewLayouter::minimumGroupHeaderWidth() const
 {
     return 100;
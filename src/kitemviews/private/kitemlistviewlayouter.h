@@ -21,10 +21,10 @@
 #define KITEMLISTVIEWLAYOUTER_H
 
 #include "dolphin_export.h"
+#include "kitemviews/kitemrange.h"
 
 #include <QObject>
 #include <QRectF>
-#include <QSet>
 #include <QSizeF>
 #include <QVector>
 
@@ -44,6 +44,12 @@ class KItemListSizeHintResolver;
  * marking the layouter as dirty (see markAsDirty()). This means that
  * changing properties of the layouter is not expensive, only the
  * first read of a property can get expensive.
+ *
+ * If only some items have been changed, inserted or removed (see
+ * markItemsAsDirty(), itemsInserted() and itemsRemoved()), the layout
+ * is only recalculated starting at the row of the first changed item,
+ * and it is stopped as soon as the rows are aligned like in the
+ * previous layout again.
  */
 class DOLPHIN_EXPORT KItemListViewLayouter : public QObject
 {
@@ -123,6 +129,21 @@ public:
      */
     QRectF itemRect(int index) const;
 
+    /**
+     * @return Index of the item whose rectangle (see itemRect()) contains
+     *         the position \a pos. -1 is returned if there is no such item.
+     *         Complexity: O(log(number of items)).
+     */
+    int indexAt(const QPointF& pos) const;
+
+    /**
+     * @return Ranges of all items whose rectangles (see itemRect()) intersect
+     *         with \a rect, in ascending order. Like itemRect(), \a rect is
+     *         related to the top/left of the KItemListView.
+     *         Complexity: O(log(number of items) + number of rows in \a rect).
+     */
+    KItemRangeList itemRangesInRect(const QRectF& rect) const;
+
     /**
      * @return Rectangle of the group header for the item with the
      *         index \a index. Note that the layouter does not check
@@ -162,6 +183,33 @@ public:
      */
     void markAsDirty();
 
+    /**
+     * Marks the items in the range [\a firstIndex, \a lastIndex] as dirty,
+     * e.g. because their size hints have been changed. Only the rows
+     * starting with the row of \a firstIndex will be relayouted.
+     */
+    void markItemsAsDirty(int firstIndex, int lastIndex);
+
+    /**
+     * Marks the layouter as dirty after \a itemRanges have been inserted
+     * into the model. The ranges are related to the model before the
+     * items have been inserted (see KItemModelBase::itemsInserted()).
+     */
+    void itemsInserted(const KItemRangeList& itemRanges);
+
+    /**
+     * Marks the layouter as dirty after \a itemRanges have been removed
+     * from the model. The ranges are related to the model before the
+     * items have been removed (see KItemModelBase::itemsRemoved()).
+     */
+    void itemsRemoved(const KItemRangeList& itemRanges);
+
+    /**
+     * Marks the groups as dirty. Only the rows starting with the first
+     * group that has been changed will be relayouted.
+     */
+    void markGroupsAsDirty();
+
     inline int columnCount() const
     {
         return m_columnCount;
@@ -173,7 +221,7 @@ public:
      *         not called yet doLayout(). Is enabled only in the debugging
      *         mode, as it is not useful to check the dirty state otherwise.
      */
-    bool isDirty();
+    bool isDirty() const;
 #endif
 
 private:
@@ -181,6 +229,22 @@ private:
     void updateVisibleIndexes();
     bool createGroupHeaders();
 
+    /**
+     * Helper method for doLayout(): Moves the rows of the previous layout that
+     * start with the row of the item \a index by \a rowDelta rows and by
+     * \a offsetDelta in the scroll direction. \a index must be the first
+     * item of a row, and m_itemInfos must already store the previous row
+     * for the items after the changed items.
+     */
+    void moveRows(int index, int rowDelta, qreal offsetDelta);
+
+    /**
+     * @return Ranges of the items which might intersect with \a rect. Only the
+     *         rows and columns of the grid are checked, the rectangles of the
+     *         returned items must still be checked by the caller.
+     */
+    KItemRangeList candidateItemRanges(const QRectF& rect) const;
+
     /**
      * @return Minimum width of group headers when grouping is enabled in the horizontal
      *         alignment mode. The header alignment is done like this:
@@ -220,9 +284,16 @@ private:
     QVector<qreal> m_rowOffsets;
     QVector<qreal> m_columnOffsets;
 
-    // Stores all item indexes that are the first item of a group.
-    // Assures fast access for KItemListViewLayouter::isFirstGroupItem().
-    QSet<int> m_groupItemIndexes;
+    // Range of the items which must be relayouted if m_dirty is false. The
+    // indexes are related to the current model. m_firstDirtyIndex is -1 if
+    // no item is dirty.
+    int m_firstDirtyIndex;
+    int m_lastDirtyIndex;
+    bool m_groupsDirty;
+
+    // Stores all item indexes that are the first item of a group in
+    // ascending order. Assures fast access for isFirstGroupItem().
+    QVector<int> m_groupItemIndexes;
     qreal m_groupHeaderHeight;
     qreal m_groupHeaderMargin;
 
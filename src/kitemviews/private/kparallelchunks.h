@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KPARALLELCHUNKS_H
+#define KPARALLELCHUNKS_H
+
+#include <QPair>
+#include <QVector>
+#include <QtConcurrentMap>
+
+/**
+ * Default number of items that are processed by one thread at once
+ * by processInChunks(). It fits to operations that take a few
+ * microseconds per item, like matching a name with a pattern.
+ */
+const int DefaultProcessingChunkSize = 1000;
+
+/**
+ * Invokes \a process(first, last) for consecutive chunks of the index range
+ * [0, \a count - 1] with up to \a chunkSize items. If the range consists of
+ * several chunks, they are processed in parallel by the threads of the global
+ * QThreadPool. The function returns after all chunks have been processed.
+ *
+ * \a process may be called from any thread, so it must only do reentrant
+ * operations and must only write to data that belongs to its own chunk.
+ */
+template<typename ProcessFunction>
+void processInChunks(int count, ProcessFunction process, int chunkSize = DefaultProcessingChunkSize)
+{
+    if (count <= chunkSize) {
+        // Starting threads is not worth it for a single chunk
+        if (count > 0) {
+            process(0, count - 1);
+        }
+        return;
+    }
+
+    QVector<QPair<int, int>> chunks;
+    chunks.reserve(count / chunkSize + 1);
+    for (int first = 0; first < count; first += chunkSize) {
+        chunks.append(qMakePair(first, qMin(first + chunkSize, count) - 1));
+    }
+
+    QtConcurrent::blockingMap(chunks, [&process](const QPair<int, int>& chunk) {
+        process(chunk.first, chunk.second);
+    });
+}
+
+#endif
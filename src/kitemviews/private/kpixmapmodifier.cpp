@@ -278,41 +278,69 @@ namespace {
 
             shadowBlur(image, 3, Qt::black);
 
-            QPixmap pixmap = QPixmap::fromImage(image);
-            m_tiles[TopLeftCorner]     = pixmap.copy(0, 0, 8, 8);
-            m_tiles[TopSide]           = pixmap.copy(8, 0, 8, 8);
-            m_tiles[TopRightCorner]    = pixmap.copy(16, 0, 8, 8);
-            m_tiles[LeftSide]          = pixmap.copy(0, 8, 8, 8);
-            m_tiles[RightSide]         = pixmap.copy(16, 8, 8, 8);
-            m_tiles[BottomLeftCorner]  = pixmap.copy(0, 16, 8, 8);
-            m_tiles[BottomSide]        = pixmap.copy(8, 16, 8, 8);
-            m_tiles[BottomRightCorner] = pixmap.copy(16, 16, 8, 8);
+            // The tiles are kept as QImage, so that frames can be painted
+            // outside the GUI thread.
+            m_tiles[TopLeftCorner]     = image.copy(0, 0, 8, 8);
+            m_tiles[TopSide]           = image.copy(8, 0, 8, 8);
+            m_tiles[TopRightCorner]    = image.copy(16, 0, 8, 8);
+            m_tiles[LeftSide]          = image.copy(0, 8, 8, 8);
+            m_tiles[RightSide]         = image.copy(16, 8, 8, 8);
+            m_tiles[BottomLeftCorner]  = image.copy(0, 16, 8, 8);
+            m_tiles[BottomSide]        = image.copy(8, 16, 8, 8);
+            m_tiles[BottomRightCorner] = image.copy(16, 16, 8, 8);
         }
 
-        void paint(QPainter* p, const QRect& r)
+        void paint(QPainter* p, const QRect& r) const
         {
-            p->drawPixmap(r.topLeft(), m_tiles[TopLeftCorner]);
+            p->drawImage(r.topLeft(), m_tiles[TopLeftCorner]);
             if (r.width() - 16 > 0) {
-                p->drawTiledPixmap(r.x() + 8, r.y(), r.width() - 16, 8, m_tiles[TopSide]);
+                drawTiled(p, QRect(r.x() + 8, r.y(), r.width() - 16, 8), m_tiles[TopSide]);
             }
-            p->drawPixmap(r.right() - 8 + 1, r.y(), m_tiles[TopRightCorner]);
+            p->drawImage(r.right() - 8 + 1, r.y(), m_tiles[TopRightCorner]);
             if (r.height() - 16 > 0) {
-                p->drawTiledPixmap(r.x(), r.y() + 8, 8, r.height() - 16,  m_tiles[LeftSide]);
-                p->drawTiledPixmap(r.right() - 8 + 1, r.y() + 8, 8, r.height() - 16, m_tiles[RightSide]);
+                drawTiled(p, QRect(r.x(), r.y() + 8, 8, r.height() - 16),  m_tiles[LeftSide]);
+                drawTiled(p, QRect(r.right() - 8 + 1, r.y() + 8, 8, r.height() - 16), m_tiles[RightSide]);
             }
-            p->drawPixmap(r.x(), r.bottom() - 8 + 1, m_tiles[BottomLeftCorner]);
+            p->drawImage(r.x(), r.bottom() - 8 + 1, m_tiles[BottomLeftCorner]);
             if (r.width() - 16 > 0) {
-                p->drawTiledPixmap(r.x() + 8, r.bottom() - 8 + 1, r.width() - 16, 8, m_tiles[BottomSide]);
+                drawTiled(p, QRect(r.x() + 8, r.bottom() - 8 + 1, r.width() - 16, 8), m_tiles[BottomSide]);
             }
-            p->drawPixmap(r.right() - 8 + 1, r.bottom() - 8 + 1, m_tiles[BottomRightCorner]);
+            p->drawImage(r.right() - 8 + 1, r.bottom() - 8 + 1, m_tiles[BottomRightCorner]);
 
             const QRect contentRect = r.adjusted(LeftMargin + 1, TopMargin + 1,
                                                  -(RightMargin + 1), -(BottomMargin + 1));
             p->fillRect(contentRect, Qt::transparent);
         }
 
-        QPixmap m_tiles[NumTiles];
+        QImage m_tiles[NumTiles];
+
+    private:
+        /** Equivalent of QPainter::drawTiledPixmap() for images. */
+        static void drawTiled(QPainter* p, const QRect& rect, const QImage& tile)
+        {
+            p->save();
+            p->setBrushOrigin(rect.topLeft());
+            p->fillRect(rect, QBrush(tile));
+            p->restore();
+        }
     };
+
+    /**
+     * @return \a image in the format which can be scaled with the optimized
+     *         code paths of QImage and be converted to a QPixmap without
+     *         another conversion.
+     */
+    QImage toPremultipliedImage(const QImage& image)
+    {
+        switch (image.format()) {
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32_Premultiplied:
+            return image;
+        default:
+            return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                 : QImage::Format_RGB32);
+        }
+    }
 }
 
 void KPixmapModifier::scale(QPixmap& pixmap, const QSize& scaledSize)
@@ -326,10 +354,29 @@ void KPixmapModifier::scale(QPixmap& pixmap, const QSize& scaledSize)
     pixmap.setDevicePixelRatio(dpr);
 }
 
+void KPixmapModifier::scale(QImage& image, const QSize& scaledSize)
+{
+    if (scaledSize.isEmpty()) {
+        image = QImage();
+        return;
+    }
+    const qreal dpr = image.devicePixelRatio();
+    image = toPremultipliedImage(image).scaled(scaledSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    image.setDevicePixelRatio(dpr);
+}
+
 void KPixmapModifier::applyFrame(QPixmap& icon, const QSize& scaledSize)
 {
-    static TileSet tileSet;
-    qreal dpr = qApp->devicePixelRatio();
+    QImage image = icon.toImage();
+    applyFrame(image, scaledSize, qApp->devicePixelRatio());
+    icon = QPixmap::fromImage(image);
+}
+
+void KPixmapModifier::applyFrame(QImage& icon, const QSize& scaledSize, qreal devicePixelRatio)
+{
+    // The initialization of function-local statics is thread-safe
+    static const TileSet tileSet;
+    const qreal dpr = devicePixelRatio;
 
     // Resize the icon to the maximum size minus the space required for the frame
     const QSize size(scaledSize.width() - TileSet::LeftMargin - TileSet::RightMargin,
@@ -337,8 +384,9 @@ void KPixmapModifier::applyFrame(QPixmap& icon, const QSize& scaledSize)
     scale(icon, size * dpr);
     icon.setDevicePixelRatio(dpr);
 
-    QPixmap framedIcon(icon.size().width() + (TileSet::LeftMargin + TileSet::RightMargin) * dpr,
-                       icon.size().height() + (TileSet::TopMargin + TileSet::BottomMargin) * dpr);
+    QImage framedIcon(icon.size().width() + (TileSet::LeftMargin + TileSet::RightMargin) * dpr,
+                      icon.size().height() + (TileSet::TopMargin + TileSet::BottomMargin) * dpr,
+                      QImage::Format_ARGB32_Premultiplied);
     framedIcon.setDevicePixelRatio(dpr);
     framedIcon.fill(Qt::transparent);
 
@@ -347,7 +395,8 @@ void KPixmapModifier::applyFrame(QPixmap& icon, const QSize& scaledSize)
     painter.setCompositionMode(QPainter::CompositionMode_Source);
     tileSet.paint(&painter, QRect(QPoint(0,0), framedIcon.size() / dpr));
     painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-    painter.drawPixmap(TileSet::LeftMargin, TileSet::TopMargin, icon);
+    painter.drawImage(TileSet::LeftMargin, TileSet::TopMargin, icon);
+    painter.end();
 
     icon = framedIcon;
 }
@@ -22,9 +22,15 @@
 
 #include "dolphin_export.h"
 
+class QImage;
 class QPixmap;
 class QSize;
 
+/**
+ * The methods for QPixmap may only be used in the GUI thread. The methods
+ * for QImage are thread-safe, so that e.g. previews can be post-processed
+ * in a worker thread.
+ */
 class DOLPHIN_EXPORT KPixmapModifier
 {
 public:
@@ -35,6 +41,13 @@ public:
      */
     static void scale(QPixmap& pixmap, const QSize& scaledSize);
 
+    /**
+     * Scale an image to a given size. The result has the format
+     * QImage::Format_ARGB32_Premultiplied or QImage::Format_RGB32.
+     * @arg scaledSize is in device pixels
+     */
+    static void scale(QImage& image, const QSize& scaledSize);
+
     /**
      * Resize and paint a frame round an icon
      * @arg scaledSize is in device-independent pixels
@@ -42,6 +55,14 @@ public:
      */
     static void applyFrame(QPixmap& icon, const QSize& scaledSize);
 
+    /**
+     * Resize and paint a frame round an icon
+     * @arg scaledSize is in device-independent pixels
+     * The returned image has the device pixel ratio \a devicePixelRatio
+     * and the format QImage::Format_ARGB32_Premultiplied.
+     */
+    static void applyFrame(QImage& icon, const QSize& scaledSize, qreal devicePixelRatio);
+
     /**
      * return and paint a frame round an icon
      * @arg framesize is in device-independent pixels
@@ -0,0 +1,140 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kthumbnailcache.h"
+
+#include <KFileItem>
+
+#include <QDateTime>
+
+namespace {
+    // Default memory budget in kilobytes. It is enough for about
+    // 800 previews with 256 x 256 pixels or 3200 with 128 x 128 pixels.
+    const int DefaultMaximumCost = 200 * 1024;
+}
+
+Q_GLOBAL_STATIC(KThumbnailCache, s_thumbnailCache)
+
+uint qHash(const KThumbnailCache::Key& key, uint seed)
+{
+    return qHash(key.url, seed) ^ qHash(key.modificationTime, seed) ^ qHash(key.fileSize, seed) ^
+           qHash(key.size.width() * 65536 + key.size.height(), seed) ^ uint(key.scaleType);
+}
+
+KThumbnailCache* KThumbnailCache::instance()
+{
+    return s_thumbnailCache();
+}
+
+KThumbnailCache::KThumbnailCache() :
+    m_cache(DefaultMaximumCost),
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+KThumbnailCache::~KThumbnailCache()
+{
+}
+
+QPixmap KThumbnailCache::pixmap(const KFileItem& item, const QSize& size, const QStringList& plugins,
+                                KIO::PreviewJob::ScaleType scaleType)
+{
+    const Entry* entry = m_cache.object(createKey(item, size, scaleType));
+    if (entry && pluginsAllowed(entry->plugins, plugins)) {
+        ++m_hits;
+        return entry->pixmap;
+    }
+
+    ++m_misses;
+    return QPixmap();
+}
+
+void KThumbnailCache::insert(const KFileItem& item, const QSize& size, const QStringList& plugins,
+                             const QPixmap& pixmap, KIO::PreviewJob::ScaleType scaleType)
+{
+    if (pixmap.isNull()) {
+        return;
+    }
+
+    const int cost = qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / 8 / 1024);
+    m_cache.insert(createKey(item, size, scaleType), new Entry{pixmap, plugins}, cost);
+}
+
+void KThumbnailCache::clear()
+{
+    m_cache.clear();
+}
+
+void KThumbnailCache::setMaximumCost(int kilobytes)
+{
+    m_cache.setMaxCost(kilobytes);
+}
+
+int KThumbnailCache::maximumCost() const
+{
+    return m_cache.maxCost();
+}
+
+KThumbnailCache::Statistics KThumbnailCache::statistics() const
+{
+    Statistics statistics;
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.count = m_cache.count();
+    statistics.cost = m_cache.totalCost();
+    statistics.maximumCost = m_cache.maxCost();
+    return statistics;
+}
+
+void KThumbnailCache::resetStatistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+}
+
+KThumbnailCache::Key KThumbnailCache::createKey(const KFileItem& item, const QSize& size, KIO::PreviewJob::ScaleType scaleType)
+{
+    const QDateTime modificationTime = item.time(KFileItem::ModificationTime);
+
+    const Key key = {
+        item.url(),
+        modificationTime.isValid() ? modificationTime.toMSecsSinceEpoch() : -1,
+        item.size(),
+        size,
+        scaleType
+    };
+    return key;
+}
+
+bool KThumbnailCache::pluginsAllowed(const QStringList& entryPlugins, const QStringList& plugins)
+{
+    // The lists are usually copies of the same list, which are compared
+    // without comparing the strings
+    if (entryPlugins == plugins) {
+        return true;
+    }
+
+    foreach (const QString& plugin, entryPlugins) {
+        if (!plugins.contains(plugin)) {
+            return false;
+        }
+    }
+    return true;
+}
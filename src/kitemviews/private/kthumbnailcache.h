@@ -0,0 +1,135 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef KTHUMBNAILCACHE_H
+#define KTHUMBNAILCACHE_H
+
+#include "dolphin_export.h"
+
+#include <KIO/PreviewJob>
+
+#include <QCache>
+#include <QPixmap>
+#include <QSize>
+#include <QStringList>
+#include <QUrl>
+
+class KFileItem;
+
+/**
+ * @brief Process-wide memory cache for the previews created by KIO::PreviewJob.
+ *
+ * KFileItemModelRolesUpdater, the tooltips and the Information Panel create
+ * previews for the same files, and each view, tab and revisit of a folder
+ * would otherwise decode or generate them again. The previews are stored as
+ * they are returned by KIO::PreviewJob, i.e., before frames or overlays are
+ * applied. They are identified by the URL, the modification time and the
+ * size of the file, the requested size and the scale type. Changed files get
+ * a new modification time or size, so outdated entries are never returned and
+ * are eventually dropped as least recently used entries.
+ *
+ * The views only use the preview plugins that are enabled in the settings,
+ * while the tooltips and the Information Panel use all available plugins.
+ * Therefore the plugins are not part of the identification. Instead, the
+ * plugins that have been passed to KIO::PreviewJob are stored together with
+ * the preview, and a preview is only returned if all of them are allowed
+ * by the caller. This assures that the plugin that has created the preview
+ * is allowed, although KIO::PreviewJob does not tell which plugin it used.
+ *
+ * The cache must only be used from the main thread.
+ */
+class DOLPHIN_EXPORT KThumbnailCache
+{
+public:
+    struct Statistics {
+        int hits;
+        int misses;
+        int count;      ///< Number of cached previews
+        int cost;       ///< Memory used by the cached previews in kilobytes
+        int maximumCost;
+    };
+
+    static KThumbnailCache* instance();
+
+    KThumbnailCache();
+    ~KThumbnailCache();
+
+    /**
+     * @return The cached preview for \a item that has been created with
+     *         the given parameters of KIO::PreviewJob and a subset of the
+     *         preview plugins \a plugins, or a null pixmap.
+     */
+    QPixmap pixmap(const KFileItem& item, const QSize& size, const QStringList& plugins,
+                   KIO::PreviewJob::ScaleType scaleType = KIO::PreviewJob::ScaledAndCached);
+
+    /**
+     * Stores the preview \a pixmap for \a item, which has been created with
+     * the given parameters of KIO::PreviewJob.
+     */
+    void insert(const KFileItem& item, const QSize& size, const QStringList& plugins,
+                const QPixmap& pixmap, KIO::PreviewJob::ScaleType scaleType = KIO::PreviewJob::ScaledAndCached);
+
+    void clear();
+
+    /**
+     * Sets the memory budget of the cache in kilobytes. If more memory is
+     * used, the least recently used previews are dropped.
+     */
+    void setMaximumCost(int kilobytes);
+    int maximumCost() const;
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+private:
+    struct Key {
+        QUrl url;
+        qint64 modificationTime;
+        KIO::filesize_t fileSize;
+        QSize size;
+        int scaleType;
+
+        bool operator==(const Key& other) const
+        {
+            return url == other.url && modificationTime == other.modificationTime &&
+                   fileSize == other.fileSize && size == other.size &&
+                   scaleType == other.scaleType;
+        }
+    };
+    friend uint qHash(const Key& key, uint seed);
+
+    struct Entry {
+        QPixmap pixmap;
+        QStringList plugins; // Plugins that have been passed to KIO::PreviewJob
+    };
+
+    static Key createKey(const KFileItem& item, const QSize& size, KIO::PreviewJob::ScaleType scaleType);
+
+    /**
+     * @return True if each plugin of \a entryPlugins is contained in \a plugins.
+     */
+    static bool pluginsAllowed(const QStringList& entryPlugins, const QStringList& plugins);
+
+private:
+    QCache<Key, Entry> m_cache;
+    int m_hits;
+    int m_misses;
+};
+
+#endif
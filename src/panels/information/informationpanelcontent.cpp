@@ -53,6 +53,8 @@
 #include <QPolygon>
 
 #include "dolphin_informationpanelsettings.h"
+#include "kitemviews/private/kpixmapmodifier.h"
+#include "kitemviews/private/kthumbnailcache.h"
 #include "phononwidget.h"
 #include "pixmapviewer.h"
 
@@ -192,16 +194,37 @@ void InformationPanelContent::refreshPixmapView()
     // can be shown within a short timeframe.
     m_outdatedPreviewTimer->start();
 
+    // Previews which fit into 256 x 256 pixels are requested in the same sizes
+    // like in the tooltips, so that they can be shared via the KThumbnailCache.
+    // showPreview() scales them down to the size of the preview widget.
     QStringList plugins = KIO::PreviewJob::availablePlugins();
+    QSize previewSize(m_preview->width(), m_preview->height());
+    KIO::PreviewJob::ScaleType scaleType = KIO::PreviewJob::Unscaled;
+    if (previewSize.width() <= 256 && previewSize.height() <= 256) {
+        previewSize = (previewSize.width() > 128) || (previewSize.height() > 128)
+                      ? QSize(256, 256) : QSize(128, 128);
+        scaleType = KIO::PreviewJob::ScaledAndCached;
+    }
+
+    const QPixmap cachedPreview = KThumbnailCache::instance()->pixmap(m_item, previewSize, plugins, scaleType);
+    if (!cachedPreview.isNull()) {
+        showPreview(m_item, cachedPreview);
+        return;
+    }
+
     m_previewJob = new KIO::PreviewJob(KFileItemList() << m_item,
-                                       QSize(m_preview->width(), m_preview->height()),
+                                       previewSize,
                                        &plugins);
-    m_previewJob->setScaleType(KIO::PreviewJob::Unscaled);
+    m_previewJob->setScaleType(scaleType);
     m_previewJob->setIgnoreMaximumSize(m_item.isLocalFile());
     if (m_previewJob->uiDelegate()) {
         KJobWidgets::setWindow(m_previewJob, this);
     }
 
+    connect(m_previewJob.data(), &KIO::PreviewJob::gotPreview,
+            this, [previewSize, plugins, scaleType](const KFileItem& item, const QPixmap& pixmap) {
+        KThumbnailCache::instance()->insert(item, previewSize, plugins, pixmap, scaleType);
+    });
     connect(m_previewJob.data(), &KIO::PreviewJob::gotPreview,
             this, &InformationPanelContent::showPreview);
     connect(m_previewJob.data(), &KIO::PreviewJob::failed,
@@ -233,13 +256,15 @@ void InformationPanelContent::refreshPreview()
             );
         } else {
 
-            refreshPixmapView();
-
             const QString mimeType = m_item.mimetype();
             const bool isAnimatedImage = m_preview->isAnimatedImage(itemUrl.toLocalFile());
             m_isVideo = !isAnimatedImage && mimeType.startsWith(QLatin1String("video/"));
             bool usePhonon = m_isVideo || mimeType.startsWith(QLatin1String("audio/"));
 
+            // m_isVideo must be known before, because a cached preview
+            // is shown immediately by refreshPixmapView().
+            refreshPixmapView();
+
             if (usePhonon) {
                 // change the cursor of the preview
                 m_preview->setCursor(Qt::PointingHandCursor);
@@ -365,6 +390,11 @@ void InformationPanelContent::showPreview(const KFileItem& item,
     m_outdatedPreviewTimer->stop();
 
     QPixmap p = pixmap;
+    if (p.width() > m_preview->width() || p.height() > m_preview->height()) {
+        // Previews in the size buckets of the KThumbnailCache might be
+        // larger than the preview widget (see refreshPixmapView()).
+        KPixmapModifier::scale(p, m_preview->size());
+    }
     KIconLoader::global()->drawOverlays(item.overlays(), p, KIconLoader::Desktop);
 
     if (m_isVideo) {
@@ -0,0 +1,45 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#ifndef BENCHMARKHELPER_H
+#define BENCHMARKHELPER_H
+
+#include <QList>
+
+/**
+ * Returns the item counts of \a counts which should be used for the data
+ * rows of a benchmark. Counts larger than 100000 are only used if the
+ * environment variable DOLPHIN_LARGE_BENCHMARKS is set (the "benchmark"
+ * target does this), such that running the unit tests with ctest does
+ * not take too long.
+ */
+inline QList<int> benchmarkItemCounts(const QList<int>& counts)
+{
+    const bool large = qEnvironmentVariableIsSet("DOLPHIN_LARGE_BENCHMARKS");
+
+    QList<int> result;
+    foreach (int count, counts) {
+        if (large || count <= 100000) {
+            result.append(count);
+        }
+    }
+    return result;
+}
+
+#endif
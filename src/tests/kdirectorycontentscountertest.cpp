@@ -0,0 +1,162 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemviews/kfileitemmodel.h"
+#include "kitemviews/private/kdirectorycontentscounter.h"
+#include "kitemviews/private/kdirectorysizecache.h"
+#include "testdir.h"
+
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+class KDirectoryContentsCounterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testCachedResult();
+    void testRefreshDirectory();
+    void testDirWatchDirty();
+
+private:
+    QString loadDirectory();
+    static void insertWrongCachedResult(const QString& path);
+
+private:
+    KFileItemModel* m_model;
+    KDirectoryContentsCounter* m_counter;
+    TestDir* m_testDir;
+};
+
+void KDirectoryContentsCounterTest::initTestCase()
+{
+    // Don't touch the cache of the user
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void KDirectoryContentsCounterTest::init()
+{
+    m_testDir = new TestDir();
+    m_testDir->createFiles({"a/1", "a/2"});
+    m_model = new KFileItemModel();
+    m_counter = new KDirectoryContentsCounter(m_model);
+}
+
+void KDirectoryContentsCounterTest::cleanup()
+{
+    delete m_counter;
+    m_counter = nullptr;
+
+    delete m_model;
+    m_model = nullptr;
+
+    delete m_testDir;
+    m_testDir = nullptr;
+}
+
+/**
+ * A valid cached result must be announced without counting
+ * the directory again.
+ */
+void KDirectoryContentsCounterTest::testCachedResult()
+{
+    const QString path = m_testDir->path() + QLatin1String("/a");
+    insertWrongCachedResult(path);
+
+    QSignalSpy resultSpy(m_counter, &KDirectoryContentsCounter::result);
+    m_counter->scanDirectory(path, KDirectoryContentsCounter::High);
+    QVERIFY(resultSpy.wait());
+    QCOMPARE(resultSpy.count(), 1);
+    QCOMPARE(resultSpy.first().at(1).toInt(), 42);
+
+    // The directory has not been queued for being counted again
+    QVERIFY(m_counter->m_runningPaths.isEmpty());
+    QVERIFY(m_counter->m_priorityQueue.isEmpty());
+    QVERIFY(m_counter->m_queue.isEmpty());
+}
+
+/**
+ * The cached results must not be used for the directories that have
+ * been shown when the user refreshed the directory.
+ */
+void KDirectoryContentsCounterTest::testRefreshDirectory()
+{
+    const QString path = loadDirectory();
+    insertWrongCachedResult(path);
+
+    QSignalSpy loadingCompletedSpy(m_model, &KFileItemModel::directoryLoadingCompleted);
+    m_model->refreshDirectory(m_testDir->url());
+    QVERIFY(loadingCompletedSpy.wait());
+
+    QSignalSpy resultSpy(m_counter, &KDirectoryContentsCounter::result);
+    m_counter->scanDirectory(path);
+    QVERIFY(resultSpy.wait());
+    QCOMPARE(resultSpy.count(), 1);
+    QCOMPARE(resultSpy.first().at(1).toInt(), 2);
+}
+
+/**
+ * A directory that has been reported as changed by KDirWatch must
+ * be counted again.
+ */
+void KDirectoryContentsCounterTest::testDirWatchDirty()
+{
+    const QString path = loadDirectory();
+    insertWrongCachedResult(path);
+
+    QSignalSpy resultSpy(m_counter, &KDirectoryContentsCounter::result);
+    m_counter->slotDirWatchDirty(path);
+    QVERIFY(resultSpy.wait());
+    QCOMPARE(resultSpy.count(), 1);
+    QCOMPARE(resultSpy.first().at(1).toInt(), 2);
+}
+
+/**
+ * Loads the test directory into the model.
+ * @return Path of the directory "a".
+ */
+QString KDirectoryContentsCounterTest::loadDirectory()
+{
+    QSignalSpy loadingCompletedSpy(m_model, &KFileItemModel::directoryLoadingCompleted);
+    m_model->loadDirectory(m_testDir->url());
+    if (!loadingCompletedSpy.wait()) {
+        return QString();
+    }
+    return m_model->fileItem(0).localPath();
+}
+
+/**
+ * Stores a result for \a path in KDirectorySizeCache that differs from
+ * the actual contents, such that it is visible whether the directory
+ * has been counted.
+ */
+void KDirectoryContentsCounterTest::insertWrongCachedResult(const QString& path)
+{
+    KDirectorySizeCache::instance()->insert(QFileInfo(path).canonicalFilePath(), 42, 4200);
+}
+
+QTEST_MAIN(KDirectoryContentsCounterTest)
+
+#include "kdirectorycontentscountertest.moc"
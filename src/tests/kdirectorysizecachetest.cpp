@@ -0,0 +1,258 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemviews/private/kdirectorysizecache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#ifndef Q_OS_WIN
+#include <utime.h>
+#endif
+
+class KDirectorySizeCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testRoundTrip();
+    void testChangedModificationTime();
+    void testChangedInode();
+    void testInvalidate();
+    void testEviction();
+
+private:
+    QString createDirectory(const QString& name);
+    static void setLastUsed(KDirectorySizeCache& cache, const QString& path, qint64 lastUsed);
+
+private:
+    QTemporaryDir* m_tempDir;
+    QString m_fileName;
+};
+
+void KDirectorySizeCacheTest::init()
+{
+    m_tempDir = new QTemporaryDir();
+    QVERIFY(m_tempDir->isValid());
+    m_fileName = m_tempDir->path() + QLatin1String("/directorysizes");
+}
+
+void KDirectorySizeCacheTest::cleanup()
+{
+    delete m_tempDir;
+    m_tempDir = nullptr;
+}
+
+void KDirectorySizeCacheTest::testRoundTrip()
+{
+    const QString a = createDirectory(QStringLiteral("a"));
+    const QString b = createDirectory(QStringLiteral("b"));
+
+    {
+        KDirectorySizeCache cache(m_fileName);
+        int count;
+        long size;
+        QVERIFY(!cache.value(a, count, size));
+
+        cache.insert(a, 3, 1000);
+        cache.insert(b, 0, 0);
+        QVERIFY(cache.value(a, count, size));
+        QCOMPARE(count, 3);
+        QCOMPARE(size, 1000L);
+
+        cache.save();
+    }
+
+    // The entries are available after loading the file again
+    KDirectorySizeCache cache(m_fileName);
+    int count;
+    long size;
+    QVERIFY(cache.value(a, count, size));
+    QCOMPARE(count, 3);
+    QCOMPARE(size, 1000L);
+    QVERIFY(cache.value(b, count, size));
+    QCOMPARE(count, 0);
+    QCOMPARE(size, 0L);
+
+    // A corrupt file is ignored
+    QFile file(m_fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("corrupt");
+    file.close();
+
+    KDirectorySizeCache corruptCache(m_fileName);
+    QVERIFY(!corruptCache.value(a, count, size));
+}
+
+/**
+ * Entries of directories whose modification time has been changed
+ * must not be returned.
+ */
+void KDirectorySizeCacheTest::testChangedModificationTime()
+{
+#ifdef Q_OS_WIN
+    QSKIP("Setting the modification time of directories is not supported");
+#else
+    const QString a = createDirectory(QStringLiteral("a"));
+
+    // Assure that adding a file changes the modification time, even if
+    // the file system only has a resolution of seconds
+    struct utimbuf times;
+    times.actime = 1000;
+    times.modtime = 1000;
+    QCOMPARE(utime(QFile::encodeName(a).constData(), &times), 0);
+
+    KDirectorySizeCache cache(m_fileName);
+    cache.insert(a, 0, 0);
+
+    int count;
+    long size;
+    QVERIFY(cache.value(a, count, size));
+
+    QFile file(a + QLatin1String("/file"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.close();
+
+    QVERIFY(!cache.value(a, count, size));
+
+    // The entry has been removed
+    cache.insert(a, 1, 0);
+    QVERIFY(cache.value(a, count, size));
+    QCOMPARE(count, 1);
+#endif
+}
+
+/**
+ * Entries of directories that have been replaced by another directory
+ * with the same path must not be returned.
+ */
+void KDirectorySizeCacheTest::testChangedInode()
+{
+#ifdef Q_OS_WIN
+    QSKIP("Inodes are not supported");
+#else
+    const QString a = createDirectory(QStringLiteral("a"));
+
+    KDirectorySizeCache cache(m_fileName);
+    cache.insert(a, 2, 100);
+
+    // Keep the old directory, such that its inode cannot be reused
+    // for the new directory
+    QVERIFY(QDir().rename(a, m_tempDir->path() + QLatin1String("/old")));
+    createDirectory(QStringLiteral("a"));
+
+    int count;
+    long size;
+    QVERIFY(!cache.value(a, count, size));
+
+    // Deleted directories are not returned either
+    cache.insert(a, 2, 100);
+    QVERIFY(QDir(a).removeRecursively());
+    QVERIFY(!cache.value(a, count, size));
+#endif
+}
+
+/**
+ * Invalidating a directory must remove the entries of all its ancestors,
+ * as their sizes include the size of the directory.
+ */
+void KDirectorySizeCacheTest::testInvalidate()
+{
+    const QString a = createDirectory(QStringLiteral("a"));
+    const QString b = createDirectory(QStringLiteral("a/b"));
+    const QString c = createDirectory(QStringLiteral("a/b/c"));
+    const QString d = createDirectory(QStringLiteral("a/d"));
+
+    KDirectorySizeCache cache(m_fileName);
+    cache.insert(a, 2, 300);
+    cache.insert(b, 1, 200);
+    cache.insert(c, 0, 0);
+    cache.insert(d, 0, 0);
+
+    cache.invalidate(b);
+
+    int count;
+    long size;
+    QVERIFY(!cache.value(a, count, size));
+    QVERIFY(!cache.value(b, count, size));
+    QVERIFY(cache.value(c, count, size));
+    QVERIFY(cache.value(d, count, size));
+}
+
+/**
+ * If the cache contains more entries than allowed, the least recently
+ * used ones must be dropped when saving.
+ */
+void KDirectorySizeCacheTest::testEviction()
+{
+    QStringList paths;
+    for (int i = 0; i < 5; ++i) {
+        paths.append(createDirectory(QString::number(i)));
+    }
+
+    {
+        KDirectorySizeCache cache(m_fileName);
+        cache.m_maximumEntryCount = 3;
+        for (int i = 0; i < paths.count(); ++i) {
+            cache.insert(paths.at(i), i, i);
+        }
+
+        // Use the entries in the order 4, 0, 3, 1, 2
+        setLastUsed(cache, paths.at(4), 1);
+        setLastUsed(cache, paths.at(0), 2);
+        setLastUsed(cache, paths.at(3), 3);
+        setLastUsed(cache, paths.at(1), 4);
+        setLastUsed(cache, paths.at(2), 5);
+
+        cache.save();
+    }
+
+    KDirectorySizeCache cache(m_fileName);
+    int count;
+    long size;
+    QVERIFY(!cache.value(paths.at(4), count, size));
+    QVERIFY(!cache.value(paths.at(0), count, size));
+    for (int i = 1; i <= 3; ++i) {
+        QVERIFY(cache.value(paths.at(i), count, size));
+        QCOMPARE(count, i);
+    }
+}
+
+QString KDirectorySizeCacheTest::createDirectory(const QString& name)
+{
+    const QString path = m_tempDir->path() + QLatin1Char('/') + name;
+    QDir().mkpath(path);
+    return QFileInfo(path).canonicalFilePath();
+}
+
+void KDirectorySizeCacheTest::setLastUsed(KDirectorySizeCache& cache, const QString& path, qint64 lastUsed)
+{
+    QVERIFY(cache.m_entries.contains(path));
+    cache.m_entries[path].lastUsed = lastUsed;
+}
+
+QTEST_MAIN(KDirectorySizeCacheTest)
+
+#include "kdirectorysizecachetest.moc"
@@ -21,8 +21,13 @@
 #include <QTest>
 #include <QSignalSpy>
 
+#include <KIO/UDSEntry>
+
 #include <random>
 
+#include <sys/stat.h>
+
+#include "benchmarkhelper.h"
 #include "kitemviews/kfileitemmodel.h"
 #include "kitemviews/private/kfileitemmodelsortalgorithm.h"
 
@@ -59,9 +64,17 @@ public:
 private slots:
     void insertAndRemoveManyItems_data();
     void insertAndRemoveManyItems();
+    void loadDirectory_data();
+    void loadDirectory();
+    void sortAndGroupManyItems_data();
+    void sortAndGroupManyItems();
+    void calculateGroups_data();
+    void calculateGroups();
 
 private:
     static KFileItemList createFileItemList(const QStringList& fileNames, const QString& urlPrefix = QLatin1String("file:///"));
+    static KFileItemList createFileItemListWithSizesAndTimes(int count);
+    static void fillModel(KFileItemModel& model, const QByteArray& sortRole, int count);
 };
 
 KFileItemModelBenchmark::KFileItemModelBenchmark()
@@ -204,6 +217,203 @@ void KFileItemModelBenchmark::insertAndRemoveManyItems()
     }
 }
 
+void KFileItemModelBenchmark::loadDirectory_data()
+{
+    QTest::addColumn<int>("itemCount");
+    QTest::addColumn<bool>("naturalSorting");
+
+    foreach (int n, benchmarkItemCounts({10000, 100000, 1000000})) {
+        const int bufferSize = 128;
+        char buffer[bufferSize];
+
+        snprintf(buffer, bufferSize, "natural sorting--n=%i", n);
+        QTest::newRow(buffer) << n << true;
+
+        snprintf(buffer, bufferSize, "plain sorting--n=%i", n);
+        QTest::newRow(buffer) << n << false;
+    }
+}
+
+/**
+ * Measures the time for loading a directory with many items into
+ * the model, which includes creating the item data and sorting.
+ */
+void KFileItemModelBenchmark::loadDirectory()
+{
+    QFETCH(int, itemCount);
+    QFETCH(bool, naturalSorting);
+
+    KFileItemModel model;
+    model.m_naturalSorting = naturalSorting;
+    model.setRoles({"text"});
+
+    const KFileItemList items = createFileItemListWithSizesAndTimes(itemCount);
+
+    QBENCHMARK {
+        model.slotClear();
+        model.slotItemsAdded(model.directory(), items);
+        model.slotCompleted();
+        QCOMPARE(model.count(), itemCount);
+    }
+
+    QVERIFY(model.isConsistent());
+}
+
+void KFileItemModelBenchmark::sortAndGroupManyItems_data()
+{
+    QTest::addColumn<int>("itemCount");
+    QTest::addColumn<QByteArray>("sortRole");
+    QTest::addColumn<bool>("naturalSorting");
+    QTest::addColumn<bool>("groupedSorting");
+
+    QList<QByteArray> sortRoles;
+    sortRoles << "text" << "size" << "modificationtime" << "creationtime" << "accesstime"
+              << "permissions" << "owner" << "group" << "type" << "rating";
+
+    foreach (int n, benchmarkItemCounts({100000, 1000000})) {
+        foreach (const QByteArray& role, sortRoles) {
+            const int bufferSize = 128;
+            char buffer[bufferSize];
+
+            snprintf(buffer, bufferSize, "sort by %s--n=%i", role.constData(), n);
+            QTest::newRow(buffer) << n << role << false << false;
+
+            snprintf(buffer, bufferSize, "natural sort by %s--n=%i", role.constData(), n);
+            QTest::newRow(buffer) << n << role << true << false;
+
+            snprintf(buffer, bufferSize, "sort and group by %s--n=%i", role.constData(), n);
+            QTest::newRow(buffer) << n << role << false << true;
+        }
+    }
+}
+
+void KFileItemModelBenchmark::sortAndGroupManyItems()
+{
+    QFETCH(int, itemCount);
+    QFETCH(QByteArray, sortRole);
+    QFETCH(bool, naturalSorting);
+    QFETCH(bool, groupedSorting);
+
+    KFileItemModel model;
+
+    // Natural sorting only affects the comparison of the names. For the
+    // other roles it is only used if the sort role values are equal.
+    model.m_naturalSorting = naturalSorting;
+    model.setRoles({"text"});
+    model.setGroupedSorting(groupedSorting);
+    fillModel(model, sortRole, itemCount);
+
+    QBENCHMARK {
+        // Changing the sort order results in resorting all items.
+        model.setSortOrder(model.sortOrder() == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder);
+        if (groupedSorting) {
+            QVERIFY(!model.groups().isEmpty());
+        }
+    }
+
+    QVERIFY(model.isConsistent());
+}
+
+void KFileItemModelBenchmark::calculateGroups_data()
+{
+    QTest::addColumn<int>("itemCount");
+    QTest::addColumn<QByteArray>("sortRole");
+
+    // One role for each kind of group values, see KFileItemModel::groupValue().
+    QList<QByteArray> sortRoles;
+    sortRoles << "text" << "size" << "modificationtime" << "permissions" << "rating" << "owner";
+
+    foreach (int n, benchmarkItemCounts({100000, 1000000})) {
+        foreach (const QByteArray& role, sortRoles) {
+            const int bufferSize = 128;
+            char buffer[bufferSize];
+
+            snprintf(buffer, bufferSize, "group by %s--n=%i", role.constData(), n);
+            QTest::newRow(buffer) << n << role;
+        }
+    }
+}
+
+/**
+ * Measures only the time for determining the groups of sorted items.
+ */
+void KFileItemModelBenchmark::calculateGroups()
+{
+    QFETCH(int, itemCount);
+    QFETCH(QByteArray, sortRole);
+
+    KFileItemModel model;
+    model.m_naturalSorting = false;
+    model.setRoles({"text"});
+    model.setGroupedSorting(true);
+    fillModel(model, sortRole, itemCount);
+
+    QBENCHMARK {
+        model.resetGroups();
+        QVERIFY(!model.groups().isEmpty());
+    }
+}
+
+/**
+ * Inserts \a count items into \a model, which is sorted by \a sortRole.
+ */
+void KFileItemModelBenchmark::fillModel(KFileItemModel& model, const QByteArray& sortRole, int count)
+{
+    model.setSortRole(sortRole);
+    model.slotItemsAdded(model.directory(), createFileItemListWithSizesAndTimes(count));
+    model.slotCompleted();
+    QCOMPARE(model.count(), count);
+
+    if (sortRole == "rating") {
+        // The rating is usually provided by Baloo. Set it directly to
+        // prevent that all items are resorted for each changed rating.
+        std::mt19937 generator(count);
+        std::uniform_int_distribution<int> ratingDistribution(0, 10);
+        for (int i = 0; i < count; ++i) {
+            model.m_itemData.at(i)->values.insert("rating", ratingDistribution(generator));
+        }
+        model.resortAllItems();
+    }
+}
+
+KFileItemList KFileItemModelBenchmark::createFileItemListWithSizesAndTimes(int count)
+{
+    std::mt19937 generator(count);
+    std::uniform_int_distribution<qint64> sizeDistribution(0, 20 * 1024 * 1024);
+    std::uniform_int_distribution<qint64> timeDistribution(0, 2000000000);
+    std::uniform_int_distribution<int> nameDistribution(0, count);
+    std::uniform_int_distribution<int> indexDistribution(0, 3);
+
+    const QStringList prefixes = {"IMG_", "Document ", "track", "backup-"};
+    const QStringList mimeTypes = {"image/jpeg", "application/pdf", "audio/x-vorbis+ogg", "application/x-compressed-tar"};
+    const QStringList users = {"root", "alice", "bob", "carol"};
+    const mode_t permissions[] = {0644, 0600, 0755, 0444};
+
+    const QUrl dirUrl = QUrl::fromLocalFile(QStringLiteral("/benchmark"));
+
+    KFileItemList result;
+    result.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        KIO::UDSEntry entry;
+        // Use names with numbers in random order, which makes natural
+        // sorting and the name groups more realistic.
+        const int index = indexDistribution(generator);
+        const QString name = prefixes.at(index) + QString::number(nameDistribution(generator)) + QLatin1Char('_') + QString::number(i);
+        entry.fastInsert(KIO::UDSEntry::UDS_NAME, name);
+        entry.fastInsert(KIO::UDSEntry::UDS_MIME_TYPE, mimeTypes.at(index));
+        entry.fastInsert(KIO::UDSEntry::UDS_FILE_TYPE, S_IFREG);
+        entry.fastInsert(KIO::UDSEntry::UDS_ACCESS, permissions[indexDistribution(generator)]);
+        entry.fastInsert(KIO::UDSEntry::UDS_USER, users.at(indexDistribution(generator)));
+        entry.fastInsert(KIO::UDSEntry::UDS_GROUP, users.at(indexDistribution(generator)));
+        entry.fastInsert(KIO::UDSEntry::UDS_SIZE, sizeDistribution(generator));
+        entry.fastInsert(KIO::UDSEntry::UDS_MODIFICATION_TIME, timeDistribution(generator));
+        entry.fastInsert(KIO::UDSEntry::UDS_CREATION_TIME, timeDistribution(generator));
+        entry.fastInsert(KIO::UDSEntry::UDS_ACCESS_TIME, timeDistribution(generator));
+        result << KFileItem(entry, dirUrl, true, true);
+    }
+    return result;
+}
+
 KFileItemList KFileItemModelBenchmark::createFileItemList(const QStringList& fileNames, const QString& prefix)
 {
     // Suppress 'file does not exist anymore' messages from KFileItemPrivate::init().
@@ -72,6 +72,9 @@ private slots:
     void testSetDataWithModifiedSortRole();
     void testChangeSortRole();
     void testResortAfterChangingName();
+    void testNaturalSortingAfterChangingName();
+    void testResortChangedItems();
+    void testIndexAfterInsertingAndRemovingItems();
     void testModelConsistencyWhenInsertingItems();
     void testItemRangeConsistencyWhenInsertingItems();
     void testExpandItems();
@@ -80,15 +83,20 @@ private slots:
     void testRemoveFilteredExpandedItems();
     void testSorting();
     void testIndexForKeyboardSearch();
+    void testIndexForKeyboardSearchAfterChanges();
     void testNameFilter();
+    void testNameFilterTyping();
     void testEmptyPath();
     void testRefreshExpandedItem();
     void testRemoveHiddenItems();
+    void testToggleHiddenItemsKeepsData();
     void collapseParentOfHiddenItems();
     void removeParentOfHiddenItems();
     void testGeneralParentChildRelationships();
     void testNameRoleGroups();
+    void testGroupsAfterInsertingAndRemovingItems();
     void testNameRoleGroupsWithExpandedItems();
+    void testGroupsChangedWithExpandedItems();
     void testInconsistentModel();
     void testChangeRolesForFilteredItems();
     void testChangeSortRoleWhileFiltering();
@@ -428,6 +436,98 @@ void KFileItemModelTest::testResortAfterChangingName()
     QCOMPARE(itemsInModel(), QStringList() << "a.txt" << "b.txt" << "c.txt");
 }
 
+void KFileItemModelTest::testNaturalSortingAfterChangingName()
+{
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+    QSignalSpy itemsMovedSpy(m_model, &KFileItemModel::itemsMoved);
+    QVERIFY(itemsMovedSpy.isValid());
+
+    m_model->m_naturalSorting = true;
+    m_model->resetSortKeys();
+
+    m_testDir->createFiles({"a1.txt", "a10.txt", "a2.txt"});
+
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "a1.txt" << "a2.txt" << "a10.txt");
+
+    // The cached sort key of the renamed item must not be used anymore.
+    QHash<QByteArray, QVariant> data;
+    data.insert("text", "a20.txt");
+    m_model->setData(0, data);
+
+    QVERIFY(itemsMovedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "a2.txt" << "a10.txt" << "a20.txt");
+    QVERIFY(m_model->isConsistent());
+}
+
+/**
+ * Verifies that only the items that have been changed are re-inserted
+ * when resorting, and that the resulting itemsMoved() signal is correct.
+ */
+void KFileItemModelTest::testResortChangedItems()
+{
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+    QSignalSpy itemsMovedSpy(m_model, &KFileItemModel::itemsMoved);
+    QVERIFY(itemsMovedSpy.isValid());
+
+    m_testDir->createFiles({"b0", "b1", "b2", "b3", "b4", "b5", "b6", "b7", "b8", "b9"});
+
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "b0" << "b1" << "b2" << "b3" << "b4" << "b5" << "b6" << "b7" << "b8" << "b9");
+
+    QHash<QByteArray, QVariant> data;
+    data.insert("text", "c");
+    m_model->setData(2, data);
+    data.insert("text", "a");
+    m_model->setData(7, data);
+    QCOMPARE(m_model->m_itemsToResort.count(), 2);
+
+    QVERIFY(itemsMovedSpy.wait());
+    QCOMPARE(itemsMovedSpy.count(), 1);
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "b0" << "b1" << "b3" << "b4" << "b5" << "b6" << "b8" << "b9" << "c");
+    QCOMPARE(itemsMovedSpy.first().at(0).value<KItemRange>(), KItemRange(0, 10));
+    QCOMPARE(itemsMovedSpy.first().at(1).value<QList<int> >(), QList<int>() << 1 << 2 << 9 << 3 << 4 << 5 << 6 << 0 << 7 << 8);
+    QVERIFY(m_model->m_itemsToResort.isEmpty());
+    QVERIFY(m_model->isConsistent());
+}
+
+void KFileItemModelTest::testIndexAfterInsertingAndRemovingItems()
+{
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+
+    m_testDir->createFiles({"b", "d", "f", "h"});
+
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "b" << "d" << "f" << "h");
+
+    // Populate the URL hash of the model.
+    const KFileItem itemH = m_model->fileItem(3);
+    QCOMPARE(m_model->index(itemH), 3);
+    QCOMPARE(m_model->m_items.count(), 4);
+
+    // The hash must be updated when inserting items, instead of being cleared.
+    m_testDir->createFiles({"a", "e"});
+    m_model->m_dirLister->updateDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "b" << "d" << "e" << "f" << "h");
+    QCOMPARE(m_model->m_items.count(), 6);
+    QCOMPARE(m_model->index(itemH), 5);
+
+    // The same applies to removing items.
+    m_model->slotItemsDeleted(KFileItemList() << m_model->fileItem(1) << m_model->fileItem(3));
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "d" << "f" << "h");
+    QCOMPARE(m_model->m_items.count(), 4);
+    QCOMPARE(m_model->index(itemH), 3);
+
+    for (int i = 0; i < m_model->count(); ++i) {
+        QCOMPARE(m_model->index(m_model->fileItem(i)), i);
+    }
+    QVERIFY(m_model->isConsistent());
+}
+
 void KFileItemModelTest::testModelConsistencyWhenInsertingItems()
 {
     QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
@@ -1000,6 +1100,56 @@ void KFileItemModelTest::testIndexForKeyboardSearch()
     // TODO: Maybe we should also test keyboard searches in directories which are not sorted by Name?
 }
 
+/**
+ * Verifies that the index used by indexForKeyboardSearch() is kept up to
+ * date when items are inserted, removed or renamed after it has been built.
+ */
+void KFileItemModelTest::testIndexForKeyboardSearchAfterChanges()
+{
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+    QSignalSpy itemsRemovedSpy(m_model, &KFileItemModel::itemsRemoved);
+
+    m_testDir->createFiles({"a", "b", "c"});
+
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(m_model->indexForKeyboardSearch("b", 0), 1);
+    QVERIFY(m_model->isConsistent());
+
+    // Insert items
+    m_testDir->createFiles({"B2", "d"});
+    m_model->m_dirLister->updateDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "b" << "B2" << "c" << "d");
+    QVERIFY(m_model->isConsistent());
+    QCOMPARE(m_model->indexForKeyboardSearch("b", 2), 2);
+    QCOMPARE(m_model->indexForKeyboardSearch("b2", 0), 2);
+    QCOMPARE(m_model->indexForKeyboardSearch("d", 0), 4);
+
+    // Remove items
+    m_testDir->removeFile("b");
+    m_model->m_dirLister->updateDirectory(m_testDir->url());
+    QVERIFY(itemsRemovedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "B2" << "c" << "d");
+    QVERIFY(m_model->isConsistent());
+    QCOMPARE(m_model->indexForKeyboardSearch("b", 0), 1);
+    QCOMPARE(m_model->indexForKeyboardSearch("b", 2), 1);
+    QCOMPARE(m_model->indexForKeyboardSearch("d", 0), 3);
+
+    // Rename an item
+    QSignalSpy itemsMovedSpy(m_model, &KFileItemModel::itemsMoved);
+    QHash<QByteArray, QVariant> data;
+    data.insert("text", "e");
+    m_model->setData(0, data);
+    QCOMPARE(m_model->indexForKeyboardSearch("a", 0), -1);
+    QCOMPARE(m_model->indexForKeyboardSearch("e", 0), 0);
+
+    QVERIFY(itemsMovedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "B2" << "c" << "d" << "e");
+    QVERIFY(m_model->isConsistent());
+    QCOMPARE(m_model->indexForKeyboardSearch("e", 0), 3);
+}
+
 void KFileItemModelTest::testNameFilter()
 {
     QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
@@ -1028,6 +1178,54 @@ void KFileItemModelTest::testNameFilter()
     QCOMPARE(m_model->count(), 5);
 }
 
+/**
+ * Verifies that the items are filtered correctly if the name filter is
+ * extended or shortened, like it happens while typing in the filter bar.
+ * In that case, only the shown or only the filtered items are checked.
+ */
+void KFileItemModelTest::testNameFilterTyping()
+{
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+
+    m_testDir->createFiles({"abc1", "Ab2", "b", "xab", "abd"});
+
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "Ab2" << "abc1" << "abd" << "b" << "xab");
+
+    m_model->setNameFilter("a");
+    QCOMPARE(itemsInModel(), QStringList() << "Ab2" << "abc1" << "abd" << "xab");
+    QVERIFY(m_model->isConsistent());
+
+    m_model->setNameFilter("ab");
+    QCOMPARE(itemsInModel(), QStringList() << "Ab2" << "abc1" << "abd" << "xab");
+
+    m_model->setNameFilter("abc");
+    QCOMPARE(itemsInModel(), QStringList() << "abc1");
+    QVERIFY(m_model->isConsistent());
+
+    m_model->setNameFilter("AB");
+    QCOMPARE(itemsInModel(), QStringList() << "Ab2" << "abc1" << "abd" << "xab");
+    QVERIFY(m_model->isConsistent());
+
+    m_model->setNameFilter("b");
+    QCOMPARE(itemsInModel(), QStringList() << "Ab2" << "abc1" << "abd" << "b" << "xab");
+    QVERIFY(m_model->isConsistent());
+
+    // Wildcard patterns require checking all items.
+    m_model->setNameFilter("*b");
+    QCOMPARE(itemsInModel(), QStringList() << "b" << "xab");
+    QVERIFY(m_model->isConsistent());
+
+    m_model->setNameFilter("ab");
+    QCOMPARE(itemsInModel(), QStringList() << "Ab2" << "abc1" << "abd" << "xab");
+    QVERIFY(m_model->isConsistent());
+
+    m_model->setNameFilter(QString());
+    QCOMPARE(itemsInModel(), QStringList() << "Ab2" << "abc1" << "abd" << "b" << "xab");
+    QVERIFY(m_model->isConsistent());
+}
+
 /**
  * Verifies that we do not crash when adding a KFileItem with an empty path.
  * Before this issue was fixed, KFileItemModel::expandedParentsCountCompare()
@@ -1136,6 +1334,47 @@ void KFileItemModelTest::testRemoveHiddenItems()
     m_model->setShowHiddenFiles(false);
 }
 
+/**
+ * Verifies that hidden items keep their data while they are not shown,
+ * and that hiding them works together with the name filter.
+ */
+void KFileItemModelTest::testToggleHiddenItemsKeepsData()
+{
+    m_testDir->createFiles({".a1", ".b1", "a2", "b2"});
+
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+
+    m_model->setShowHiddenFiles(true);
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << ".a1" << ".b1" << "a2" << "b2");
+
+    QHash<QByteArray, QVariant> rating;
+    rating.insert("rating", 4);
+    m_model->setData(0, rating);
+
+    m_model->setShowHiddenFiles(false);
+    QCOMPARE(itemsInModel(), QStringList() << "a2" << "b2");
+    QVERIFY(m_model->isConsistent());
+
+    m_model->setShowHiddenFiles(true);
+    QCOMPARE(itemsInModel(), QStringList() << ".a1" << ".b1" << "a2" << "b2");
+    QCOMPARE(m_model->data(0).value("rating").toInt(), 4);
+    QVERIFY(m_model->isConsistent());
+
+    m_model->setShowHiddenFiles(false);
+    m_model->setNameFilter("a");
+    QCOMPARE(itemsInModel(), QStringList() << "a2");
+
+    m_model->setShowHiddenFiles(true);
+    QCOMPARE(itemsInModel(), QStringList() << ".a1" << "a2");
+    QVERIFY(m_model->isConsistent());
+
+    m_model->setNameFilter(QString());
+    QCOMPARE(itemsInModel(), QStringList() << ".a1" << ".b1" << "a2" << "b2");
+    QVERIFY(m_model->isConsistent());
+}
+
 /**
  * Verify that filtered items are removed when their parent is collapsed.
  */
@@ -1336,6 +1575,8 @@ void KFileItemModelTest::testNameRoleGroups()
     QVERIFY(itemsMovedSpy.isValid());
     QSignalSpy groupsChangedSpy(m_model, &KFileItemModel::groupsChanged);
     QVERIFY(groupsChangedSpy.isValid());
+    QSignalSpy groupValuesChangedSpy(m_model, &KFileItemModel::groupValuesChanged);
+    QVERIFY(groupValuesChangedSpy.isValid());
 
     m_testDir->createFiles({"b.txt", "c.txt", "d.txt", "e.txt"});
 
@@ -1365,10 +1606,13 @@ void KFileItemModelTest::testNameRoleGroups()
     expectedGroups << QPair<int, QVariant>(3, QLatin1String("E"));
     QCOMPARE(m_model->groups(), expectedGroups);
 
-    // Rename c.txt to d.txt.
+    // Rename c.txt to d.txt. Only the value of the third group changes, which
+    // is reported immediately without determining all groups again.
     data.insert("text", "d.txt");
     m_model->setData(2, data);
-    QVERIFY(groupsChangedSpy.wait());
+    QCOMPARE(groupValuesChangedSpy.count(), 1);
+    QCOMPARE(groupValuesChangedSpy.takeFirst().first().value<KItemRangeList>(), KItemRangeList() << KItemRange(2, 1));
+    QVERIFY(groupsChangedSpy.isEmpty());
     QCOMPARE(itemsInModel(), QStringList() << "a.txt" << "b.txt" << "d.txt" << "e.txt");
 
     expectedGroups.clear();
@@ -1386,7 +1630,9 @@ void KFileItemModelTest::testNameRoleGroups()
     fileItemC.setUrl(urlC);
 
     m_model->slotRefreshItems({qMakePair(fileItemD, fileItemC)});
-    QVERIFY(groupsChangedSpy.wait());
+    QCOMPARE(groupValuesChangedSpy.count(), 1);
+    QCOMPARE(groupValuesChangedSpy.takeFirst().first().value<KItemRangeList>(), KItemRangeList() << KItemRange(2, 1));
+    QVERIFY(groupsChangedSpy.isEmpty());
     QCOMPARE(itemsInModel(), QStringList() << "a.txt" << "b.txt" << "c.txt" << "e.txt");
 
     expectedGroups.clear();
@@ -1397,6 +1643,50 @@ void KFileItemModelTest::testNameRoleGroups()
     QCOMPARE(m_model->groups(), expectedGroups);
 }
 
+void KFileItemModelTest::testGroupsAfterInsertingAndRemovingItems()
+{
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+
+    m_testDir->createFiles({"a1", "c1", "e1"});
+
+    m_model->setGroupedSorting(true);
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+
+    QList<QPair<int, QVariant> > expectedGroups;
+    expectedGroups << QPair<int, QVariant>(0, QLatin1String("A"));
+    expectedGroups << QPair<int, QVariant>(1, QLatin1String("C"));
+    expectedGroups << QPair<int, QVariant>(2, QLatin1String("E"));
+    QCOMPARE(m_model->groups(), expectedGroups);
+
+    // The groups are updated when inserting items...
+    m_testDir->createFiles({"b1", "c0", "e2"});
+    m_model->m_dirLister->updateDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "a1" << "b1" << "c0" << "c1" << "e1" << "e2");
+
+    expectedGroups.clear();
+    expectedGroups << QPair<int, QVariant>(0, QLatin1String("A"));
+    expectedGroups << QPair<int, QVariant>(1, QLatin1String("B"));
+    expectedGroups << QPair<int, QVariant>(2, QLatin1String("C"));
+    expectedGroups << QPair<int, QVariant>(4, QLatin1String("E"));
+    QCOMPARE(m_model->m_groups, expectedGroups);
+
+    // ...and when removing items.
+    m_model->slotItemsDeleted(KFileItemList() << m_model->fileItem(0) << m_model->fileItem(2) << m_model->fileItem(4));
+    QCOMPARE(itemsInModel(), QStringList() << "b1" << "c1" << "e2");
+
+    expectedGroups.clear();
+    expectedGroups << QPair<int, QVariant>(0, QLatin1String("B"));
+    expectedGroups << QPair<int, QVariant>(1, QLatin1String("C"));
+    expectedGroups << QPair<int, QVariant>(2, QLatin1String("E"));
+    QCOMPARE(m_model->m_groups, expectedGroups);
+
+    // The result must be the same as determining all groups again.
+    m_model->resetGroups();
+    QCOMPARE(m_model->groups(), expectedGroups);
+}
+
 void KFileItemModelTest::testNameRoleGroupsWithExpandedItems()
 {
     QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
@@ -1435,6 +1725,51 @@ void KFileItemModelTest::testNameRoleGroupsWithExpandedItems()
     QCOMPARE(m_model->groups(), expectedGroups);
 }
 
+/**
+ * The groups are determined from scratch if expanded items are changed. The
+ * groupsChanged() signal must be emitted only once for several changes,
+ * as each emission results in determining all groups again.
+ */
+void KFileItemModelTest::testGroupsChangedWithExpandedItems()
+{
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+    QSignalSpy groupsChangedSpy(m_model, &KFileItemModel::groupsChanged);
+    QVERIFY(groupsChangedSpy.isValid());
+
+    QSet<QByteArray> modelRoles = m_model->roles();
+    modelRoles << "isExpanded" << "isExpandable" << "expandedParentsCount";
+    m_model->setRoles(modelRoles);
+
+    m_testDir->createFiles({"a/b.txt", "a/d.txt", "e.txt"});
+
+    m_model->setGroupedSorting(true);
+    m_model->loadDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+
+    m_model->setExpanded(0, true);
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "b.txt" << "d.txt" << "e.txt");
+
+    QList<QPair<int, QVariant> > expectedGroups;
+    expectedGroups << QPair<int, QVariant>(0, QLatin1String("A"));
+    expectedGroups << QPair<int, QVariant>(3, QLatin1String("E"));
+    QCOMPARE(m_model->groups(), expectedGroups);
+    groupsChangedSpy.clear();
+
+    // Rename the children without changing their positions
+    QHash<QByteArray, QVariant> data;
+    data.insert("text", "bb.txt");
+    m_model->setData(1, data);
+    data.insert("text", "c.txt");
+    m_model->setData(2, data);
+    QCOMPARE(itemsInModel(), QStringList() << "a" << "bb.txt" << "c.txt" << "e.txt");
+    QVERIFY(groupsChangedSpy.isEmpty());
+
+    QVERIFY(groupsChangedSpy.wait());
+    QCOMPARE(groupsChangedSpy.count(), 1);
+    QCOMPARE(m_model->groups(), expectedGroups);
+}
+
 void KFileItemModelTest::testInconsistentModel()
 {
     QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
@@ -22,6 +22,7 @@
 #include "kitemviews/kfileitemmodel.h"
 #include "kitemviews/kitemlistcontroller.h"
 #include "kitemviews/kitemlistselectionmanager.h"
+#include "kitemviews/private/kfileitemmodeldirlister.h"
 #include "kitemviews/private/kitemlistviewlayouter.h"
 #include "testdir.h"
 
@@ -91,6 +92,10 @@ private slots:
     void testKeyboardNavigation_data();
     void testKeyboardNavigation();
     void testMouseClickActivation();
+    void testItemRangesInRect_data();
+    void testItemRangesInRect();
+    void testIncrementalLayout_data();
+    void testIncrementalLayout();
 
 private:
     /**
@@ -99,6 +104,12 @@ private:
      */
     void adjustGeometryForColumnCount(int count);
 
+    /**
+     * Verify that the current layout of the view is equal to the layout
+     * that is calculated from scratch.
+     */
+    void verifyLayout();
+
 private:
     KFileItemListView* m_view;
     KItemListController* m_controller;
@@ -640,6 +651,151 @@ void KItemListControllerTest::testMouseClickActivation()
     m_testStyle->setActivateItemOnSingleClick(restoreSettingsSingleClick);
 }
 
+void KItemListControllerTest::testItemRangesInRect_data()
+{
+    QTest::addColumn<KFileItemListView::ItemLayout>("layout");
+    QTest::addColumn<Qt::Orientation>("scrollOrientation");
+    QTest::addColumn<bool>("groupingEnabled");
+
+    QHash<KFileItemListView::ItemLayout, QString> layoutNames;
+    layoutNames.insert(KFileItemListView::IconsLayout, QStringLiteral("Icons"));
+    layoutNames.insert(KFileItemListView::CompactLayout, QStringLiteral("Compact"));
+    layoutNames.insert(KFileItemListView::DetailsLayout, QStringLiteral("Details"));
+
+    QHash<Qt::Orientation, QString> orientationNames;
+    orientationNames.insert(Qt::Horizontal, QStringLiteral("horizontal scroll bar"));
+    orientationNames.insert(Qt::Vertical, QStringLiteral("vertical scroll bar"));
+
+    foreach (const KFileItemListView::ItemLayout& layout, layoutNames.keys()) {
+        foreach (const Qt::Orientation& scrollOrientation, orientationNames.keys()) {
+            foreach (bool groupingEnabled, QList<bool>() << false << true) {
+                const QString testName =
+                        layoutNames[layout] + ", " +
+                        orientationNames[scrollOrientation] + ", " +
+                        (groupingEnabled ? "grouping enabled" : "grouping disabled");
+                QTest::newRow(testName.toUtf8().data()) << layout << scrollOrientation << groupingEnabled;
+            }
+        }
+    }
+}
+
+/**
+ * Verify that KItemListViewLayouter::itemRangesInRect() and indexAt() return
+ * the same items as checking the rectangles of all items.
+ */
+void KItemListControllerTest::testItemRangesInRect()
+{
+    QFETCH(KFileItemListView::ItemLayout, layout);
+    QFETCH(Qt::Orientation, scrollOrientation);
+    QFETCH(bool, groupingEnabled);
+
+    m_view->setItemLayout(layout);
+    m_view->setScrollOrientation(scrollOrientation);
+    m_model->setGroupedSorting(groupingEnabled);
+    adjustGeometryForColumnCount(3);
+
+    const KItemListViewLayouter* layouter = m_view->m_layouter;
+    const int itemCount = m_model->count();
+
+    QRectF boundingRect;
+    for (int index = 0; index < itemCount; ++index) {
+        boundingRect |= layouter->itemRect(index);
+    }
+
+    const qreal stepX = boundingRect.width() / 7;
+    const qreal stepY = boundingRect.height() / 7;
+    for (qreal x = boundingRect.left() - stepX; x < boundingRect.right(); x += stepX) {
+        for (qreal y = boundingRect.top() - stepY; y < boundingRect.bottom(); y += stepY) {
+            const QRectF rect(x, y, 2 * stepX, 3 * stepY);
+
+            KItemSet expectedItems;
+            for (int index = 0; index < itemCount; ++index) {
+                if (layouter->itemRect(index).intersects(rect)) {
+                    expectedItems.insert(index);
+                }
+            }
+
+            KItemSet items;
+            foreach (const KItemRange& range, layouter->itemRangesInRect(rect)) {
+                for (int index = range.index; index < range.index + range.count; ++index) {
+                    QVERIFY(!items.contains(index));
+                    items.insert(index);
+                }
+            }
+
+            QCOMPARE(items, expectedItems);
+        }
+    }
+
+    for (int index = 0; index < itemCount; ++index) {
+        const QRectF itemRect = layouter->itemRect(index);
+        QCOMPARE(layouter->indexAt(itemRect.center()), index);
+    }
+    QCOMPARE(layouter->indexAt(boundingRect.topLeft() - QPointF(1, 1)), -1);
+}
+
+void KItemListControllerTest::testIncrementalLayout_data()
+{
+    testItemRangesInRect_data();
+}
+
+/**
+ * Verify that the layout which is only recalculated for the inserted and
+ * removed items is equal to the layout which is calculated for all items.
+ */
+void KItemListControllerTest::testIncrementalLayout()
+{
+    QFETCH(KFileItemListView::ItemLayout, layout);
+    QFETCH(Qt::Orientation, scrollOrientation);
+    QFETCH(bool, groupingEnabled);
+
+    m_view->setItemLayout(layout);
+    m_view->setScrollOrientation(scrollOrientation);
+    m_model->setGroupedSorting(groupingEnabled);
+    adjustGeometryForColumnCount(3);
+    verifyLayout();
+
+    QSignalSpy itemsInsertedSpy(m_model, &KFileItemModel::itemsInserted);
+    QVERIFY(itemsInsertedSpy.isValid());
+    QSignalSpy itemsRemovedSpy(m_model, &KFileItemModel::itemsRemoved);
+    QVERIFY(itemsRemovedSpy.isValid());
+
+    // Insert items at the beginning, into existing groups, and as new groups.
+    const QStringList files = {"a0", "b2", "c2 long name", "cc", "d5", "f"};
+    const int itemCount = m_model->count();
+
+    m_testDir->createFiles(files);
+    m_model->m_dirLister->updateDirectory(m_testDir->url());
+    QVERIFY(itemsInsertedSpy.wait());
+    QCOMPARE(m_model->count(), itemCount + files.count());
+    verifyLayout();
+
+    m_testDir->removeFiles(files);
+    m_model->m_dirLister->updateDirectory(m_testDir->url());
+    QVERIFY(itemsRemovedSpy.wait());
+    QCOMPARE(m_model->count(), itemCount);
+    verifyLayout();
+}
+
+void KItemListControllerTest::verifyLayout()
+{
+    KItemListViewLayouter* layouter = m_view->m_layouter;
+    const int itemCount = m_model->count();
+
+    QVector<QRectF> itemRects;
+    for (int index = 0; index < itemCount; ++index) {
+        itemRects.append(layouter->itemRect(index));
+    }
+    const qreal maximumScrollOffset = layouter->maximumScrollOffset();
+
+    layouter->markAsDirty();
+
+    for (int index = 0; index < itemCount; ++index) {
+        QCOMPARE(layouter->itemRect(index), itemRects.at(index));
+    }
+    QCOMPARE(layouter->maximumScrollOffset(), maximumScrollOffset);
+}
+
 void KItemListControllerTest::adjustGeometryForColumnCount(int count)
 {
     const QSize size = m_view->itemSize().toSize();
@@ -0,0 +1,112 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemviews/private/kitemlistframetimemonitor.h"
+
+#include <QTest>
+
+namespace {
+    qint64 msecs(qreal value)
+    {
+        return qint64(value * 1000000);
+    }
+}
+
+class KItemListFrameTimeMonitorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testFastFrames();
+    void testSlowFrames();
+    void testVerySlowFrames();
+    void testRecovery();
+    void testReset();
+
+private:
+    static void addFrames(KItemListFrameTimeMonitor& monitor, qreal paintTime, qreal layoutTime, int count);
+};
+
+void KItemListFrameTimeMonitorTest::testFastFrames()
+{
+    KItemListFrameTimeMonitor monitor;
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::FullAnimations);
+
+    addFrames(monitor, 2, 1, 20);
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::FullAnimations);
+    QCOMPARE(monitor.paintTime(), qreal(2));
+    QCOMPARE(monitor.layoutTime(), qreal(1));
+    QCOMPARE(monitor.frameTime(), qreal(3));
+}
+
+void KItemListFrameTimeMonitorTest::testSlowFrames()
+{
+    KItemListFrameTimeMonitor monitor;
+    const int fullDuration = monitor.animationDuration();
+
+    addFrames(monitor, 10, 5, 20);
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::ShortAnimations);
+    QVERIFY(monitor.animationDuration() < fullDuration);
+}
+
+void KItemListFrameTimeMonitorTest::testVerySlowFrames()
+{
+    KItemListFrameTimeMonitor monitor;
+
+    // A single slow frame must not turn off the animations
+    monitor.addPaintTime(msecs(100));
+    monitor.addLayoutTime(msecs(100));
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::FullAnimations);
+
+    addFrames(monitor, 40, 20, 20);
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::NoAnimations);
+}
+
+void KItemListFrameTimeMonitorTest::testRecovery()
+{
+    KItemListFrameTimeMonitor monitor;
+    addFrames(monitor, 40, 20, 20);
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::NoAnimations);
+
+    addFrames(monitor, 1, 1, 50);
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::FullAnimations);
+}
+
+void KItemListFrameTimeMonitorTest::testReset()
+{
+    KItemListFrameTimeMonitor monitor;
+    addFrames(monitor, 40, 20, 20);
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::NoAnimations);
+
+    monitor.reset();
+    QCOMPARE(monitor.animationPolicy(), KItemListFrameTimeMonitor::FullAnimations);
+    QVERIFY(qFuzzyIsNull(monitor.frameTime()));
+}
+
+void KItemListFrameTimeMonitorTest::addFrames(KItemListFrameTimeMonitor& monitor, qreal paintTime, qreal layoutTime, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        monitor.addLayoutTime(msecs(layoutTime));
+        monitor.addPaintTime(msecs(paintTime));
+    }
+}
+
+QTEST_GUILESS_MAIN(KItemListFrameTimeMonitorTest)
+
+#include "kitemlistframetimemonitortest.moc"
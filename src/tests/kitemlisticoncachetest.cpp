@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemviews/private/kitemlisticoncache.h"
+
+#include <QTest>
+
+class KItemListIconCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testDistinctEntries();
+    void testSelectionColor();
+};
+
+/**
+ * The icon mode, the overlays and the device pixel ratio must result
+ * in different cache entries.
+ */
+void KItemListIconCacheTest::testDistinctEntries()
+{
+    KItemListIconCache cache;
+    const QString name = QStringLiteral("text-plain");
+    const QStringList noOverlays;
+
+    cache.cachedPixmap(name, noOverlays, 16, 1.0, QIcon::Normal, KItemListIconCache::NoEffect, QColor());
+    QCOMPARE(cache.m_cache.count(), 1);
+
+    // Requesting the same icon again is a cache hit
+    cache.cachedPixmap(name, noOverlays, 16, 1.0, QIcon::Normal, KItemListIconCache::NoEffect, QColor());
+    QCOMPARE(cache.m_cache.count(), 1);
+
+    cache.cachedPixmap(name, noOverlays, 16, 1.0, QIcon::Selected, KItemListIconCache::NoEffect, QColor());
+    QCOMPARE(cache.m_cache.count(), 2);
+
+    const QStringList overlays = {QStringLiteral("emblem-symbolic-link")};
+    cache.cachedPixmap(name, overlays, 16, 1.0, QIcon::Normal, KItemListIconCache::NoEffect, QColor());
+    QCOMPARE(cache.m_cache.count(), 3);
+
+    const QPixmap pixmap = cache.cachedPixmap(name, noOverlays, 16, 2.0, QIcon::Normal, KItemListIconCache::NoEffect, QColor());
+    QCOMPARE(cache.m_cache.count(), 4);
+    if (!pixmap.isNull()) {
+        QCOMPARE(pixmap.devicePixelRatio(), 2.0);
+    }
+
+    cache.cachedPixmap(name, noOverlays, 22, 1.0, QIcon::Normal, KItemListIconCache::NoEffect, QColor());
+    QCOMPARE(cache.m_cache.count(), 5);
+
+    cache.clear();
+    QCOMPARE(cache.m_cache.count(), 0);
+}
+
+/**
+ * The selection color must result in different cache entries, but only
+ * if it is used for the selection effect.
+ */
+void KItemListIconCacheTest::testSelectionColor()
+{
+    KItemListIconCache cache;
+    const QString name = QStringLiteral("text-plain");
+    const QStringList noOverlays;
+
+    // The pixmap without effects is cached too, as the effects are applied to it
+    cache.cachedPixmap(name, noOverlays, 16, 1.0, QIcon::Normal, KItemListIconCache::SelectedEffect, Qt::red);
+    QCOMPARE(cache.m_cache.count(), 2);
+
+    cache.cachedPixmap(name, noOverlays, 16, 1.0, QIcon::Normal, KItemListIconCache::SelectedEffect, Qt::blue);
+    QCOMPARE(cache.m_cache.count(), 3);
+
+    cache.cachedPixmap(name, noOverlays, 16, 1.0, QIcon::Normal, KItemListIconCache::SelectedEffect, Qt::red);
+    QCOMPARE(cache.m_cache.count(), 3);
+
+    cache.cachedPixmap(name, noOverlays, 16, 1.0, QIcon::Normal, KItemListIconCache::HiddenEffect, Qt::red);
+    QCOMPARE(cache.m_cache.count(), 4);
+    cache.cachedPixmap(name, noOverlays, 16, 1.0, QIcon::Normal, KItemListIconCache::HiddenEffect, Qt::blue);
+    QCOMPARE(cache.m_cache.count(), 4);
+}
+
+QTEST_MAIN(KItemListIconCacheTest)
+
+#include "kitemlisticoncachetest.moc"
@@ -319,7 +319,8 @@ namespace {
         RemoveItems,
         MoveItems,
         EndAnchoredSelection,
-        SetSelected
+        SetSelected,
+        SetSelectedItems
     };
 }
 
@@ -351,6 +352,9 @@ Q_DECLARE_METATYPE(QList<int>)
  *                                         data.at(1) provides the number of indices to be selected,
  *                                         data.at(2) provides the selection mode.
  *                                        \sa KItemListSelectionManager::setSelected()
+ *                        - SetSelectedItems -> data.at(0) provides the KItemSet of the indices to be selected,
+ *                                              data.at(1) provides the selection mode.
+ *                                             \sa KItemListSelectionManager::setSelected()
  * param data              A list of QVariants which will be cast to the arguments needed for the chosen ChangeType (see above).
  * param finalSelection    The expected final selection.
  *
@@ -405,6 +409,42 @@ void KItemListSelectionManagerTest::testChangeSelection_data()
         << QList<QVariant>{0, 10, QVariant::fromValue(KItemListSelectionManager::Toggle)}
         << (KItemSet() << 0 << 2 << 5 << 9);
 
+    QTest::newRow("Select item set")
+        << (KItemSet() << 1 << 3 << 4)
+        << 6 << 8
+        << (KItemSet() << 1 << 3 << 4 << 6 << 7 << 8)
+        << SetSelectedItems
+        << QList<QVariant>{QVariant::fromValue(KItemSet() << 0 << 4 << 10 << 12),
+                           QVariant::fromValue(KItemListSelectionManager::Select)}
+        << (KItemSet() << 0 << 1 << 3 << 4 << 6 << 7 << 8 << 10 << 12);
+
+    QTest::newRow("Deselect item set")
+        << (KItemSet() << 1 << 3 << 4)
+        << 6 << 8
+        << (KItemSet() << 1 << 3 << 4 << 6 << 7 << 8)
+        << SetSelectedItems
+        << QList<QVariant>{QVariant::fromValue(KItemSet() << 0 << 4 << 7 << 10),
+                           QVariant::fromValue(KItemListSelectionManager::Deselect)}
+        << (KItemSet() << 1 << 3 << 6 << 8);
+
+    QTest::newRow("Toggle item set")
+        << (KItemSet() << 1 << 3 << 4)
+        << 6 << 8
+        << (KItemSet() << 1 << 3 << 4 << 6 << 7 << 8)
+        << SetSelectedItems
+        << QList<QVariant>{QVariant::fromValue(KItemSet() << 0 << 4 << 7 << 10),
+                           QVariant::fromValue(KItemListSelectionManager::Toggle)}
+        << (KItemSet() << 0 << 1 << 3 << 6 << 8 << 10);
+
+    QTest::newRow("Select item set outside of the model")
+        << (KItemSet() << 1 << 3 << 4)
+        << 6 << 8
+        << (KItemSet() << 1 << 3 << 4 << 6 << 7 << 8)
+        << SetSelectedItems
+        << QList<QVariant>{QVariant::fromValue(KItemSet() << -5 << 2 << 100 << 1000),
+                           QVariant::fromValue(KItemListSelectionManager::Select)}
+        << (KItemSet() << 1 << 2 << 3 << 4 << 6 << 7 << 8);
+
     // Swap items 2, 3 and 4, 5
     QTest::newRow("Move items")
         << (KItemSet() << 0 << 1 << 2 << 3)
@@ -488,6 +528,10 @@ void KItemListSelectionManagerTest::testChangeSelection()
                                         data.at(1).value<int>(), // count
                                         data.at(2).value<KItemListSelectionManager::SelectionMode>());
         break;
+    case SetSelectedItems:
+        m_selectionManager->setSelected(data.at(0).value<KItemSet>(),
+                                        data.at(1).value<KItemListSelectionManager::SelectionMode>());
+        break;
     case NoChange:
         break;
     }
@@ -0,0 +1,131 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemviews/private/kitemlisttextlayoutcache.h"
+
+#include <QFont>
+#include <QTest>
+
+class KItemListTextLayoutCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testHitAndMiss();
+    void testChangedParameters();
+    void testEviction();
+
+private:
+    static bool isCached(KItemListTextLayoutCache& cache, const QString& text, const QFont& font, qreal maxWidth, int maxTextLines);
+    static void setCachedText(KItemListTextLayoutCache& cache, const QString& text, const QFont& font, qreal maxWidth, int maxTextLines,
+                              const QString& cachedText);
+};
+
+void KItemListTextLayoutCacheTest::testHitAndMiss()
+{
+    KItemListTextLayoutCache cache;
+    const QString text = QStringLiteral("A rather long file name that must be wrapped.txt");
+    const QFont font;
+
+    QVERIFY(!isCached(cache, text, font, 100, 2));
+    const KItemListTextLayoutCache::WrappedText wrappedText = cache.wrappedText(text, font, 100, 2);
+    QVERIFY(isCached(cache, text, font, 100, 2));
+    QVERIFY(wrappedText.lineCount > 0);
+    QVERIFY(wrappedText.lineCount <= 2);
+
+    // A hit returns the cached result without doing the layout again
+    setCachedText(cache, text, font, 100, 2, QStringLiteral("cached"));
+    QCOMPARE(cache.wrappedText(text, font, 100, 2).text, QStringLiteral("cached"));
+    QCOMPARE(cache.m_cache.count(), 1);
+
+    cache.clear();
+    QVERIFY(!isCached(cache, text, font, 100, 2));
+    QCOMPARE(cache.wrappedText(text, font, 100, 2).text, wrappedText.text);
+}
+
+/**
+ * A changed text, font, width or maximum number of lines must not
+ * result in a cache hit.
+ */
+void KItemListTextLayoutCacheTest::testChangedParameters()
+{
+    KItemListTextLayoutCache cache;
+    const QString text = QStringLiteral("A rather long file name that must be wrapped.txt");
+    QFont font;
+    font.setPointSize(10);
+
+    cache.wrappedText(text, font, 100, 2);
+    setCachedText(cache, text, font, 100, 2, QStringLiteral("cached"));
+
+    QVERIFY(cache.wrappedText(text + QLatin1Char('2'), font, 100, 2).text != QLatin1String("cached"));
+    QVERIFY(cache.wrappedText(text, font, 101, 2).text != QLatin1String("cached"));
+    QVERIFY(cache.wrappedText(text, font, 100, 3).text != QLatin1String("cached"));
+
+    QFont biggerFont = font;
+    biggerFont.setPointSize(12);
+    QVERIFY(cache.wrappedText(text, biggerFont, 100, 2).text != QLatin1String("cached"));
+
+    QFont boldFont = font;
+    boldFont.setBold(true);
+    QVERIFY(cache.wrappedText(text, boldFont, 100, 2).text != QLatin1String("cached"));
+
+    QCOMPARE(cache.m_cache.count(), 6);
+    QCOMPARE(cache.wrappedText(text, font, 100, 2).text, QStringLiteral("cached"));
+}
+
+/**
+ * The least recently used results must be dropped if the cache is full.
+ */
+void KItemListTextLayoutCacheTest::testEviction()
+{
+    KItemListTextLayoutCache cache;
+    cache.m_cache.setMaxCost(2);
+    const QFont font;
+
+    cache.wrappedText(QStringLiteral("a"), font, 100, 2);
+    cache.wrappedText(QStringLiteral("b"), font, 100, 2);
+    QCOMPARE(cache.m_cache.count(), 2);
+
+    // Use "a" again, such that "b" is the least recently used result
+    cache.wrappedText(QStringLiteral("a"), font, 100, 2);
+    cache.wrappedText(QStringLiteral("c"), font, 100, 2);
+    QCOMPARE(cache.m_cache.count(), 2);
+    QVERIFY(isCached(cache, QStringLiteral("a"), font, 100, 2));
+    QVERIFY(!isCached(cache, QStringLiteral("b"), font, 100, 2));
+    QVERIFY(isCached(cache, QStringLiteral("c"), font, 100, 2));
+}
+
+bool KItemListTextLayoutCacheTest::isCached(KItemListTextLayoutCache& cache, const QString& text, const QFont& font, qreal maxWidth, int maxTextLines)
+{
+    const KItemListTextLayoutCache::Key key = {text, font.key(), maxWidth, maxTextLines};
+    return cache.m_cache.contains(key);
+}
+
+void KItemListTextLayoutCacheTest::setCachedText(KItemListTextLayoutCache& cache, const QString& text, const QFont& font, qreal maxWidth, int maxTextLines,
+                                                 const QString& cachedText)
+{
+    const KItemListTextLayoutCache::Key key = {text, font.key(), maxWidth, maxTextLines};
+    KItemListTextLayoutCache::WrappedText* wrappedText = cache.m_cache.object(key);
+    QVERIFY(wrappedText);
+    wrappedText->text = cachedText;
+}
+
+QTEST_MAIN(KItemListTextLayoutCacheTest)
+
+#include "kitemlisttextlayoutcachetest.moc"
@@ -0,0 +1,286 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include <QTest>
+
+#include <random>
+
+#include "benchmarkhelper.h"
+#include "kitemviews/kfileitemlistview.h"
+#include "kitemviews/kfileitemmodel.h"
+#include "kitemviews/kitemlistcontainer.h"
+#include "kitemviews/kitemlistcontroller.h"
+#include "kitemviews/private/kitemlistsizehintresolver.h"
+#include "kitemviews/private/kitemlisttextlayoutcache.h"
+#include "kitemviews/private/kitemlistviewlayouter.h"
+
+void myMessageOutput(QtMsgType type, const QMessageLogContext& context, const QString& msg)
+{
+    Q_UNUSED(context)
+
+    switch (type) {
+    case QtDebugMsg:
+        break;
+    case QtWarningMsg:
+        break;
+    case QtCriticalMsg:
+        fprintf(stderr, "Critical: %s\n", msg.toLocal8Bit().data());
+        break;
+    case QtFatalMsg:
+        fprintf(stderr, "Fatal: %s\n", msg.toLocal8Bit().data());
+        abort();
+    default:
+       break;
+    }
+}
+
+Q_DECLARE_METATYPE(KStandardItemListView::ItemLayout)
+
+class KItemListViewBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    KItemListViewBenchmark();
+
+private slots:
+    void init();
+    void cleanup();
+
+    void firstLayout_data();
+    void firstLayout();
+    void refineAllSizeHints_data();
+    void refineAllSizeHints();
+    void resolveVisibleSizeHints_data();
+    void resolveVisibleSizeHints();
+    void doLayout_data();
+    void doLayout();
+
+private:
+    void fillModel(KStandardItemListView::ItemLayout layout, int count);
+    void addTestData();
+    static KFileItemList createFileItemList(int count);
+
+private:
+    KFileItemModel* m_model;
+    KFileItemListView* m_view;
+    KItemListContainer* m_container;
+};
+
+KItemListViewBenchmark::KItemListViewBenchmark() :
+    m_model(nullptr),
+    m_view(nullptr),
+    m_container(nullptr)
+{
+}
+
+void KItemListViewBenchmark::init()
+{
+    m_model = new KFileItemModel();
+
+    // Avoid overhead caused by natural sorting
+    // and determining the isDir/isLink roles.
+    m_model->m_naturalSorting = false;
+    m_model->setRoles({"text"});
+
+    m_view = new KFileItemListView();
+    KItemListController* controller = new KItemListController(m_model, m_view, this);
+    m_container = new KItemListContainer(controller);
+    m_container->resize(800, 600);
+    m_container->show();
+    QVERIFY(QTest::qWaitForWindowExposed(m_container));
+}
+
+void KItemListViewBenchmark::cleanup()
+{
+    delete m_container;
+    m_container = nullptr;
+    m_view = nullptr;
+
+    delete m_model;
+    m_model = nullptr;
+}
+
+void KItemListViewBenchmark::firstLayout_data()
+{
+    addTestData();
+}
+
+/**
+ * Measures the time from inserting all items into the model
+ * until the first layout of the view has been done.
+ */
+void KItemListViewBenchmark::firstLayout()
+{
+    QFETCH(KStandardItemListView::ItemLayout, layout);
+    QFETCH(int, count);
+
+    m_view->setItemLayout(layout);
+    const KFileItemList items = createFileItemList(count);
+
+    QBENCHMARK {
+        m_model->slotClear();
+        m_model->slotItemsAdded(m_model->directory(), items);
+        m_model->slotCompleted();
+        QCOMPARE(m_model->count(), count);
+        QVERIFY(m_view->lastVisibleIndex() >= 0);
+    }
+}
+
+void KItemListViewBenchmark::refineAllSizeHints_data()
+{
+    addTestData();
+}
+
+/**
+ * Measures the time for replacing the estimated size hints of all items
+ * by exact ones in the same steps as KItemListView does while the
+ * application is idle.
+ */
+void KItemListViewBenchmark::refineAllSizeHints()
+{
+    QFETCH(KStandardItemListView::ItemLayout, layout);
+    QFETCH(int, count);
+
+    fillModel(layout, count);
+
+    KItemListSizeHintResolver* resolver = m_view->m_sizeHintResolver;
+
+    QBENCHMARK {
+        // Measure the texts again instead of taking them from the cache.
+        KItemListTextLayoutCache::instance()->clear();
+        resolver->clearCache();
+        while (resolver->hasEstimatedSizeHints()) {
+            m_view->slotSizeHintRefinementTimerFinished();
+        }
+        QVERIFY(!resolver->isSizeHintEstimated(count - 1));
+    }
+}
+
+void KItemListViewBenchmark::resolveVisibleSizeHints_data()
+{
+    addTestData();
+}
+
+/**
+ * Measures the time for resolving the size hints which are required
+ * for the first layout: The size hints of a few sample items and
+ * the exact size hints of the visible items.
+ */
+void KItemListViewBenchmark::resolveVisibleSizeHints()
+{
+    QFETCH(KStandardItemListView::ItemLayout, layout);
+    QFETCH(int, count);
+
+    fillModel(layout, count);
+
+    KItemListSizeHintResolver* resolver = m_view->m_sizeHintResolver;
+    const int lastVisibleIndex = m_view->lastVisibleIndex();
+    QVERIFY(lastVisibleIndex >= 0);
+
+    QBENCHMARK {
+        resolver->clearCache();
+        resolver->resolveRange(0, lastVisibleIndex);
+        QVERIFY(!resolver->isSizeHintEstimated(lastVisibleIndex));
+    }
+}
+
+void KItemListViewBenchmark::doLayout_data()
+{
+    addTestData();
+}
+
+/**
+ * Measures KItemListViewLayouter::doLayout() without any changed size hints.
+ */
+void KItemListViewBenchmark::doLayout()
+{
+    QFETCH(KStandardItemListView::ItemLayout, layout);
+    QFETCH(int, count);
+
+    fillModel(layout, count);
+
+    KItemListViewLayouter* layouter = m_view->m_layouter;
+
+    QBENCHMARK {
+        layouter->markAsDirty();
+        // Invokes KItemListViewLayouter::doLayout()
+        QVERIFY(layouter->lastVisibleIndex() >= 0);
+    }
+}
+
+void KItemListViewBenchmark::fillModel(KStandardItemListView::ItemLayout layout, int count)
+{
+    m_view->setItemLayout(layout);
+    m_model->slotItemsAdded(m_model->directory(), createFileItemList(count));
+    m_model->slotCompleted();
+    QCOMPARE(m_model->count(), count);
+}
+
+void KItemListViewBenchmark::addTestData()
+{
+    QTest::addColumn<KStandardItemListView::ItemLayout>("layout");
+    QTest::addColumn<int>("count");
+
+    const int bufferSize = 128;
+    char buffer[bufferSize];
+
+    foreach (int count, benchmarkItemCounts({10000, 100000, 500000, 1000000})) {
+        snprintf(buffer, bufferSize, "Icons--n=%i", count);
+        QTest::newRow(buffer) << KStandardItemListView::IconsLayout << count;
+
+        snprintf(buffer, bufferSize, "Compact--n=%i", count);
+        QTest::newRow(buffer) << KStandardItemListView::CompactLayout << count;
+
+        snprintf(buffer, bufferSize, "Details--n=%i", count);
+        QTest::newRow(buffer) << KStandardItemListView::DetailsLayout << count;
+    }
+}
+
+KFileItemList KItemListViewBenchmark::createFileItemList(int count)
+{
+    // Suppress 'file does not exist anymore' messages from KFileItemPrivate::init().
+    qInstallMessageHandler(myMessageOutput);
+
+    // Use names of different lengths, such that some of them must be wrapped
+    // in the icons layout.
+    const QStringList words = {"Holiday", "photo", "report", "2020", "final", "draft",
+                               "a", "very", "long", "description", "of", "the", "content"};
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> wordCount(1, 8);
+    std::uniform_int_distribution<int> wordIndex(0, words.count() - 1);
+
+    KFileItemList result;
+    result.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QString name = QString::number(i);
+        const int n = wordCount(generator);
+        for (int j = 0; j < n; ++j) {
+            name += QLatin1Char(' ') + words.at(wordIndex(generator));
+        }
+        name += QLatin1String(".txt");
+
+        result << KFileItem(QUrl::fromLocalFile(QLatin1String("/") + name), QString(), KFileItem::Unknown);
+    }
+    return result;
+}
+
+QTEST_MAIN(KItemListViewBenchmark)
+
+#include "kitemlistviewbenchmark.moc"
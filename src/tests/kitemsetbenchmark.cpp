@@ -0,0 +1,290 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+
+#include "benchmarkhelper.h"
+#include "kitemviews/kitemset.h"
+
+#include <QTest>
+
+#include <random>
+
+/**
+ * Benchmarks the KItemSet operations which are used by the selection manager.
+ *
+ * All benchmarks are run with items that form a single range (e.g., after
+ * "Select All"), with every other item (the worst case for a range based set),
+ * and with randomly distributed items (e.g., after selecting files by pattern).
+ *
+ * Except for insert(), which shows how the set chooses its layout itself,
+ * every benchmark is run with both the range layout and the bitmap layout
+ * of KItemSet.
+ */
+class KItemSetBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void insert_data();
+    void insert();
+    void contains_data();
+    void contains();
+    void iterate_data();
+    void iterate();
+    void count_data();
+    void count();
+    void unite_data();
+    void unite();
+    void symmetricDifference_data();
+    void symmetricDifference();
+    void remove_data();
+    void remove();
+
+private:
+    static void addTestData(bool compareLayouts = true);
+    static KItemSet createItemSet(const QVector<int>& items, bool bitmap);
+};
+
+Q_DECLARE_METATYPE(QVector<int>)
+
+void KItemSetBenchmark::insert_data()
+{
+    addTestData(false);
+}
+
+void KItemSetBenchmark::insert()
+{
+    QFETCH(QVector<int>, items);
+
+    QBENCHMARK {
+        KItemSet set;
+        foreach (int i, items) {
+            set.insert(i);
+        }
+        QCOMPARE(set.count(), items.count());
+    }
+}
+
+void KItemSetBenchmark::contains_data()
+{
+    addTestData();
+}
+
+void KItemSetBenchmark::contains()
+{
+    QFETCH(QVector<int>, items);
+    QFETCH(int, itemCount);
+    QFETCH(bool, bitmap);
+
+    const KItemSet set = createItemSet(items, bitmap);
+
+    QBENCHMARK {
+        int result = 0;
+        for (int i = 0; i < itemCount; ++i) {
+            if (set.contains(i)) {
+                ++result;
+            }
+        }
+        QCOMPARE(result, items.count());
+    }
+}
+
+void KItemSetBenchmark::iterate_data()
+{
+    addTestData();
+}
+
+void KItemSetBenchmark::iterate()
+{
+    QFETCH(QVector<int>, items);
+    QFETCH(bool, bitmap);
+
+    const KItemSet set = createItemSet(items, bitmap);
+
+    QBENCHMARK {
+        qint64 sum = 0;
+        for (int i : set) {
+            sum += i;
+        }
+        QVERIFY(sum >= 0);
+    }
+}
+
+void KItemSetBenchmark::count_data()
+{
+    addTestData();
+}
+
+void KItemSetBenchmark::count()
+{
+    QFETCH(QVector<int>, items);
+    QFETCH(bool, bitmap);
+
+    const KItemSet set = createItemSet(items, bitmap);
+
+    QBENCHMARK {
+        QCOMPARE(set.count(), items.count());
+    }
+}
+
+void KItemSetBenchmark::unite_data()
+{
+    addTestData();
+}
+
+/**
+ * Measures the union of the set with a set which contains the first half of
+ * all items, like KItemListSelectionManager::selectedItems() does when
+ * combining the selection with the current anchored selection.
+ */
+void KItemSetBenchmark::unite()
+{
+    QFETCH(QVector<int>, items);
+    QFETCH(int, itemCount);
+    QFETCH(bool, bitmap);
+
+    const KItemSet set = createItemSet(items, bitmap);
+    KItemSet firstHalf;
+    for (int i = 0; i < itemCount / 2; ++i) {
+        firstHalf.insert(i);
+    }
+
+    QBENCHMARK {
+        const KItemSet result = set + firstHalf;
+        QVERIFY(result.count() >= firstHalf.count());
+    }
+}
+
+void KItemSetBenchmark::symmetricDifference_data()
+{
+    addTestData();
+}
+
+/**
+ * Measures the symmetric difference with the set of all items, which is
+ * what "Invert Selection" does.
+ */
+void KItemSetBenchmark::symmetricDifference()
+{
+    QFETCH(QVector<int>, items);
+    QFETCH(int, itemCount);
+    QFETCH(bool, bitmap);
+
+    const KItemSet set = createItemSet(items, bitmap);
+    KItemSet all;
+    all.m_itemRanges << KItemRange(0, itemCount);
+
+    QBENCHMARK {
+        const KItemSet result = set ^ all;
+        QCOMPARE(result.count(), itemCount - items.count());
+    }
+}
+
+void KItemSetBenchmark::remove_data()
+{
+    addTestData();
+}
+
+void KItemSetBenchmark::remove()
+{
+    QFETCH(QVector<int>, items);
+    QFETCH(bool, bitmap);
+
+    const KItemSet set = createItemSet(items, bitmap);
+
+    QBENCHMARK {
+        KItemSet copy = set;
+        // Remove the items in descending order, such that the benchmark
+        // measures finding the items rather than moving the ranges.
+        for (int j = items.count() - 1; j >= 0; --j) {
+            copy.remove(items.at(j));
+        }
+        QVERIFY(copy.isEmpty());
+    }
+}
+
+void KItemSetBenchmark::addTestData(bool compareLayouts)
+{
+    QTest::addColumn<QVector<int> >("items");
+    QTest::addColumn<int>("itemCount");
+    QTest::addColumn<bool>("bitmap");
+
+    foreach (int n, benchmarkItemCounts({10000, 100000, 1000000})) {
+        QVector<int> all;
+        QVector<int> everyOther;
+        QVector<int> random;
+        all.reserve(n);
+        everyOther.reserve(n / 2);
+        random.reserve(n / 10);
+
+        std::mt19937 generator(n);
+        std::uniform_int_distribution<int> distribution(0, 9);
+
+        for (int i = 0; i < n; ++i) {
+            all.append(i);
+            if (i % 2 == 0) {
+                everyOther.append(i);
+            }
+            if (distribution(generator) == 0) {
+                random.append(i);
+            }
+        }
+
+        const int bufferSize = 128;
+        char buffer[bufferSize];
+
+        const QList<bool> layouts = compareLayouts ? QList<bool>({false, true}) : QList<bool>({false});
+        foreach (bool bitmap, layouts) {
+            const char* layout = compareLayouts ? (bitmap ? ", bitmap" : ", ranges") : "";
+
+            snprintf(buffer, bufferSize, "all%s--n=%i", layout, n);
+            QTest::newRow(buffer) << all << n << bitmap;
+
+            snprintf(buffer, bufferSize, "every other%s--n=%i", layout, n);
+            QTest::newRow(buffer) << everyOther << n << bitmap;
+
+            snprintf(buffer, bufferSize, "random 10%%%s--n=%i", layout, n);
+            QTest::newRow(buffer) << random << n << bitmap;
+        }
+    }
+}
+
+/**
+ * Creates a set which contains the given items and uses the bitmap layout
+ * if \a bitmap is true, and the range layout otherwise.
+ */
+KItemSet KItemSetBenchmark::createItemSet(const QVector<int>& items, bool bitmap)
+{
+    KItemSet result;
+    foreach (int i, items) {
+        result.insert(i);
+    }
+
+    if (bitmap && result.m_layout == KItemSet::RangeLayout) {
+        result.convertToBitmap();
+    } else if (!bitmap && result.m_layout == KItemSet::BitmapLayout) {
+        result.convertToRanges();
+    }
+
+    return result;
+}
+
+QTEST_GUILESS_MAIN(KItemSetBenchmark)
+
+#include "kitemsetbenchmark.moc"
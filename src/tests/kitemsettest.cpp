@@ -116,6 +116,7 @@ private slots:
     */
     void testSymmetricDifference_data();
     void testSymmetricDifference();
+    void testBitmapLayout();
 
 private:
     QHash<const char*, KItemRangeList> m_testCases;
@@ -604,6 +605,87 @@ void KItemSetTest::testSymmetricDifference()
     QCOMPARE(itemSet2 ^ symmetricDifference, itemSet1);
 }
 
+/**
+ * Verify that a KItemSet with many scattered items switches to the bitmap
+ * layout, and that it behaves exactly like the equivalent QSet<int>.
+ */
+void KItemSetTest::testBitmapLayout()
+{
+    KItemSet itemSet;
+    QSet<int> itemsQSet;
+    for (int i = -500; i < 1500; i += 2) {
+        itemSet.insert(i);
+        itemsQSet.insert(i);
+    }
+
+    QVERIFY(itemSet.m_layout == KItemSet::BitmapLayout);
+    QVERIFY(itemSet.isValid());
+    QCOMPARE(itemSet.count(), itemsQSet.count());
+    QCOMPARE(KItemSet2QSet(itemSet), itemsQSet);
+    QCOMPARE(itemSet.first(), -500);
+    QCOMPARE(itemSet.last(), 1498);
+    QCOMPARE(*itemSet.constBegin(), -500);
+    QCOMPARE(*(--itemSet.constEnd()), 1498);
+
+    // Insert items outside of the bitmap.
+    QCOMPARE(*itemSet.insert(2000), 2000);
+    QCOMPARE(*itemSet.insert(-1000), -1000);
+    itemsQSet << 2000 << -1000;
+    QVERIFY(itemSet.m_layout == KItemSet::BitmapLayout);
+    QVERIFY(itemSet.isValid());
+    QCOMPARE(KItemSet2QSet(itemSet), itemsQSet);
+
+    // Erasing an item returns an iterator to the next item.
+    const KItemSet::iterator it = itemSet.erase(itemSet.find(0));
+    itemsQSet.remove(0);
+    QCOMPARE(*it, 2);
+    QVERIFY(!itemSet.contains(0));
+    QVERIFY(!itemSet.contains(1));
+    QVERIFY(itemSet.isValid());
+    QCOMPARE(KItemSet2QSet(itemSet), itemsQSet);
+
+    // Sets with the same items are equal, no matter which layout they use.
+    KItemSet rangeLayoutCopy(itemSet);
+    rangeLayoutCopy.convertToRanges();
+    QVERIFY(rangeLayoutCopy.m_layout == KItemSet::RangeLayout);
+    QVERIFY(rangeLayoutCopy.isValid());
+    QCOMPARE(rangeLayoutCopy, itemSet);
+    QCOMPARE(itemSet, rangeLayoutCopy);
+
+    // Combine the set with a set that uses the range layout.
+    KItemSet rangeSet;
+    QSet<int> rangeQSet;
+    for (int i = 0; i < 1000; ++i) {
+        rangeSet.insert(i);
+        rangeQSet.insert(i);
+    }
+    QVERIFY(rangeSet.m_layout == KItemSet::RangeLayout);
+
+    const KItemSet sum = itemSet + rangeSet;
+    QVERIFY(sum.isValid());
+    QCOMPARE(KItemSet2QSet(sum), itemsQSet + rangeQSet);
+
+    const KItemSet symmetricDifference = itemSet ^ rangeSet;
+    QVERIFY(symmetricDifference.isValid());
+    QCOMPARE(KItemSet2QSet(symmetricDifference), (itemsQSet - rangeQSet) + (rangeQSet - itemsQSet));
+    QCOMPARE(symmetricDifference ^ rangeSet, itemSet);
+    QVERIFY((itemSet ^ itemSet).isEmpty());
+
+    // A set which consists of a single range switches back to the range layout.
+    KItemSet allItems;
+    for (int i = -1000; i <= 2000; ++i) {
+        allItems.insert(i);
+    }
+    const KItemSet allItemsSum = itemSet + (itemSet ^ allItems);
+    QVERIFY(allItemsSum.m_layout == KItemSet::RangeLayout);
+    QVERIFY(allItemsSum.isValid());
+    QCOMPARE(allItemsSum, allItems);
+
+    itemSet.clear();
+    QVERIFY(itemSet.isEmpty());
+    QCOMPARE(itemSet.count(), 0);
+    QVERIFY(itemSet.begin() == itemSet.end());
+}
 
 QTEST_GUILESS_MAIN(KItemSetTest)
 
@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemviews/private/kpixmapmodifier.h"
+
+#include <QImage>
+#include <QTest>
+#include <QtConcurrentMap>
+
+/**
+ * Benchmarks the post-processing of previews by KPixmapModifier, which is
+ * done in worker threads by KFileItemModelRolesUpdater.
+ *
+ * The source images have the typical sizes of previews that are generated
+ * for the different zoom levels, and of large photos.
+ */
+class KPixmapModifierBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void scale_data();
+    void scale();
+    void applyFrame_data();
+    void applyFrame();
+    void applyFrameParallel_data();
+    void applyFrameParallel();
+
+private:
+    static void addTestData();
+    static QImage createImage(const QSize& size);
+};
+
+void KPixmapModifierBenchmark::scale_data()
+{
+    addTestData();
+}
+
+void KPixmapModifierBenchmark::scale()
+{
+    QFETCH(QSize, imageSize);
+    QFETCH(QSize, iconSize);
+
+    const QImage image = createImage(imageSize);
+
+    QBENCHMARK {
+        QImage scaledImage = image;
+        KPixmapModifier::scale(scaledImage, iconSize);
+        QVERIFY(!scaledImage.isNull());
+    }
+}
+
+void KPixmapModifierBenchmark::applyFrame_data()
+{
+    addTestData();
+}
+
+void KPixmapModifierBenchmark::applyFrame()
+{
+    QFETCH(QSize, imageSize);
+    QFETCH(QSize, iconSize);
+
+    const QImage image = createImage(imageSize);
+
+    QBENCHMARK {
+        QImage framedImage = image;
+        KPixmapModifier::applyFrame(framedImage, iconSize, 1.0);
+        QVERIFY(framedImage.width() <= iconSize.width());
+    }
+}
+
+void KPixmapModifierBenchmark::applyFrameParallel_data()
+{
+    addTestData();
+}
+
+void KPixmapModifierBenchmark::applyFrameParallel()
+{
+    QFETCH(QSize, imageSize);
+    QFETCH(QSize, iconSize);
+
+    // Frame as many previews as a typical preview job delivers for one page
+    const QVector<QImage> images(50, createImage(imageSize));
+
+    QBENCHMARK {
+        QVector<QImage> framedImages = images;
+        QtConcurrent::blockingMap(framedImages, [iconSize](QImage& image) {
+            KPixmapModifier::applyFrame(image, iconSize, 1.0);
+        });
+        QVERIFY(framedImages.first().width() <= iconSize.width());
+    }
+}
+
+void KPixmapModifierBenchmark::addTestData()
+{
+    QTest::addColumn<QSize>("imageSize");
+    QTest::addColumn<QSize>("iconSize");
+
+    const QList<QSize> imageSizes = {QSize(256, 192), QSize(1024, 768), QSize(4000, 3000)};
+    const QList<int> iconSizes = {48, 128, 256};
+
+    foreach (const QSize& imageSize, imageSizes) {
+        foreach (int iconSize, iconSizes) {
+            const QByteArray name = QByteArray::number(imageSize.width()) + 'x' + QByteArray::number(imageSize.height()) +
+                                    " to " + QByteArray::number(iconSize);
+            QTest::newRow(name.constData()) << imageSize << QSize(iconSize, iconSize);
+        }
+    }
+}
+
+QImage KPixmapModifierBenchmark::createImage(const QSize& size)
+{
+    // Previews of photos have no alpha channel
+    QImage image(size, QImage::Format_RGB32);
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            line[x] = qRgb(x % 256, y % 256, (x + y) % 256);
+        }
+    }
+    return image;
+}
+
+QTEST_GUILESS_MAIN(KPixmapModifierBenchmark)
+
+#include "kpixmapmodifierbenchmark.moc"
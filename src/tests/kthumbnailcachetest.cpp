@@ -0,0 +1,197 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA            *
+ ***************************************************************************/
+
+#include "kitemviews/private/kthumbnailcache.h"
+
+#include <KFileItem>
+#include <KIO/UDSEntry>
+
+#include <QTest>
+
+class KThumbnailCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testHitAndMiss();
+    void testChangedFile();
+    void testPreviewParameters();
+    void testPlugins();
+    void testMaximumCost();
+
+private:
+    static KFileItem createItem(const QString& name, qint64 modificationTime, KIO::filesize_t size);
+    static QPixmap createPixmap(const QColor& color);
+};
+
+void KThumbnailCacheTest::testHitAndMiss()
+{
+    KThumbnailCache cache;
+    const KFileItem item = createItem(QStringLiteral("a.png"), 1000, 100);
+    const QSize size(128, 128);
+    const QStringList plugins = {QStringLiteral("imagethumbnail")};
+
+    QVERIFY(cache.pixmap(item, size, plugins).isNull());
+    QCOMPARE(cache.statistics().misses, 1);
+    QCOMPARE(cache.statistics().hits, 0);
+
+    const QPixmap pixmap = createPixmap(Qt::red);
+    cache.insert(item, size, plugins, pixmap);
+    QCOMPARE(cache.statistics().count, 1);
+
+    const QPixmap cachedPixmap = cache.pixmap(item, size, plugins);
+    QCOMPARE(cachedPixmap.cacheKey(), pixmap.cacheKey());
+    QCOMPARE(cache.statistics().hits, 1);
+    QCOMPARE(cache.statistics().misses, 1);
+
+    // The same file is found for an equal item
+    QVERIFY(!cache.pixmap(createItem(QStringLiteral("a.png"), 1000, 100), size, plugins).isNull());
+    QVERIFY(cache.pixmap(createItem(QStringLiteral("b.png"), 1000, 100), size, plugins).isNull());
+
+    // Null pixmaps are not stored
+    cache.insert(createItem(QStringLiteral("c.png"), 1000, 100), size, plugins, QPixmap());
+    QCOMPARE(cache.statistics().count, 1);
+
+    cache.clear();
+    QVERIFY(cache.pixmap(item, size, plugins).isNull());
+    QCOMPARE(cache.statistics().count, 0);
+
+    cache.resetStatistics();
+    QCOMPARE(cache.statistics().hits, 0);
+    QCOMPARE(cache.statistics().misses, 0);
+}
+
+/**
+ * Previews of files whose modification time or size has been changed
+ * must not be returned.
+ */
+void KThumbnailCacheTest::testChangedFile()
+{
+    KThumbnailCache cache;
+    const QSize size(128, 128);
+    const QStringList plugins = {QStringLiteral("imagethumbnail")};
+
+    cache.insert(createItem(QStringLiteral("a.png"), 1000, 100), size, plugins, createPixmap(Qt::red));
+    QVERIFY(!cache.pixmap(createItem(QStringLiteral("a.png"), 1000, 100), size, plugins).isNull());
+    QVERIFY(cache.pixmap(createItem(QStringLiteral("a.png"), 2000, 100), size, plugins).isNull());
+    QVERIFY(cache.pixmap(createItem(QStringLiteral("a.png"), 1000, 200), size, plugins).isNull());
+}
+
+void KThumbnailCacheTest::testPreviewParameters()
+{
+    KThumbnailCache cache;
+    const KFileItem item = createItem(QStringLiteral("a.png"), 1000, 100);
+    const QSize size(128, 128);
+    const QStringList plugins = {QStringLiteral("imagethumbnail")};
+
+    cache.insert(item, size, plugins, createPixmap(Qt::red));
+
+    QVERIFY(cache.pixmap(item, QSize(256, 256), plugins).isNull());
+    QVERIFY(cache.pixmap(item, size, plugins, KIO::PreviewJob::Unscaled).isNull());
+
+    const QPixmap unscaledPixmap = createPixmap(Qt::blue);
+    cache.insert(item, size, plugins, unscaledPixmap, KIO::PreviewJob::Unscaled);
+    QCOMPARE(cache.statistics().count, 2);
+    QCOMPARE(cache.pixmap(item, size, plugins, KIO::PreviewJob::Unscaled).cacheKey(), unscaledPixmap.cacheKey());
+}
+
+/**
+ * A preview must be shared by callers that allow all plugins which have
+ * been used for creating it, e.g., by the views and the tooltips.
+ */
+void KThumbnailCacheTest::testPlugins()
+{
+    KThumbnailCache cache;
+    const KFileItem item = createItem(QStringLiteral("a.png"), 1000, 100);
+    const QSize size(128, 128);
+    const QStringList enabledPlugins = {QStringLiteral("imagethumbnail"), QStringLiteral("svgthumbnail")};
+    const QStringList availablePlugins = {QStringLiteral("textthumbnail"), QStringLiteral("svgthumbnail"),
+                                          QStringLiteral("imagethumbnail")};
+
+    const QPixmap pixmap = createPixmap(Qt::red);
+    cache.insert(item, size, enabledPlugins, pixmap);
+    QCOMPARE(cache.pixmap(item, size, availablePlugins).cacheKey(), pixmap.cacheKey());
+
+    // The order of the plugins is irrelevant
+    const QStringList reversedPlugins = {QStringLiteral("svgthumbnail"), QStringLiteral("imagethumbnail")};
+    QVERIFY(!cache.pixmap(item, size, reversedPlugins).isNull());
+
+    // The preview might have been created by a plugin that is not allowed
+    QVERIFY(cache.pixmap(item, size, {QStringLiteral("imagethumbnail")}).isNull());
+
+    // A preview created with more plugins replaces the existing one
+    cache.insert(item, size, availablePlugins, createPixmap(Qt::blue));
+    QCOMPARE(cache.statistics().count, 1);
+    QVERIFY(cache.pixmap(item, size, enabledPlugins).isNull());
+    QVERIFY(!cache.pixmap(item, size, availablePlugins).isNull());
+}
+
+void KThumbnailCacheTest::testMaximumCost()
+{
+    KThumbnailCache cache;
+    const QSize size(128, 128);
+    const QStringList plugins = {QStringLiteral("imagethumbnail")};
+
+    // Each pixmap needs 16 kilobytes
+    cache.setMaximumCost(40);
+    QCOMPARE(cache.maximumCost(), 40);
+
+    const KFileItem a = createItem(QStringLiteral("a.png"), 1000, 100);
+    const KFileItem b = createItem(QStringLiteral("b.png"), 1000, 100);
+    const KFileItem c = createItem(QStringLiteral("c.png"), 1000, 100);
+
+    cache.insert(a, size, plugins, createPixmap(Qt::red));
+    cache.insert(b, size, plugins, createPixmap(Qt::green));
+    QCOMPARE(cache.statistics().cost, 32);
+
+    // Use 'a', so that 'b' is the least recently used preview
+    QVERIFY(!cache.pixmap(a, size, plugins).isNull());
+
+    cache.insert(c, size, plugins, createPixmap(Qt::blue));
+    QCOMPARE(cache.statistics().count, 2);
+    QVERIFY(cache.statistics().cost <= cache.maximumCost());
+    QVERIFY(!cache.pixmap(a, size, plugins).isNull());
+    QVERIFY(cache.pixmap(b, size, plugins).isNull());
+    QVERIFY(!cache.pixmap(c, size, plugins).isNull());
+
+    cache.setMaximumCost(20);
+    QCOMPARE(cache.statistics().count, 1);
+}
+
+KFileItem KThumbnailCacheTest::createItem(const QString& name, qint64 modificationTime, KIO::filesize_t size)
+{
+    KIO::UDSEntry entry;
+    entry.fastInsert(KIO::UDSEntry::UDS_NAME, name);
+    entry.fastInsert(KIO::UDSEntry::UDS_FILE_TYPE, 0100000);    // S_IFREG might not be defined on non-Unix platforms.
+    entry.fastInsert(KIO::UDSEntry::UDS_ACCESS, 0644);
+    entry.fastInsert(KIO::UDSEntry::UDS_SIZE, size);
+    entry.fastInsert(KIO::UDSEntry::UDS_MODIFICATION_TIME, modificationTime);
+    return KFileItem(entry, QUrl::fromLocalFile(QStringLiteral("/thumbnailcachetest")), false, true);
+}
+
+QPixmap KThumbnailCacheTest::createPixmap(const QColor& color)
+{
+    QImage image(64, 64, QImage::Format_ARGB32);
+    image.fill(color);
+    return QPixmap::fromImage(image);
+}
+
+QTEST_MAIN(KThumbnailCacheTest)
+
+#include "kthumbnailcachetest.moc"
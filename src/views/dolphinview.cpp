@@ -31,6 +31,7 @@
 #include "kitemviews/kitemlistcontroller.h"
 #include "kitemviews/kitemlistheader.h"
 #include "kitemviews/kitemlistselectionmanager.h"
+#include "kitemviews/private/kparallelchunks.h"
 #include "versioncontrol/versioncontrolobserver.h"
 #include "viewproperties.h"
 #include "views/tooltips/tooltipmanager.h"
@@ -52,6 +53,7 @@
 #include <KIO/PasteJob>
 #include <KIO/PreviewJob>
 #include <KIO/RenameFileDialog>
+#include <KIO/StatJob>
 #include <KJobWidgets>
 #include <KLocalizedString>
 #include <KMessageBox>
@@ -95,7 +97,11 @@ DolphinView::DolphinView(const QUrl& url, QWidget* parent) :
     m_clearSelectionBeforeSelectingNewItems(false),
     m_markFirstNewlySelectedItemAsCurrent(false),
     m_versionControlObserver(nullptr),
-    m_twoClicksRenamingTimer(nullptr)
+    m_twoClicksRenamingTimer(nullptr),
+    m_recursiveSizeJob(nullptr),
+    m_recursiveSizeOutdated(false),
+    m_recursiveSizeKnown(false),
+    m_recursiveSize(0)
 {
     m_topLayout = new QVBoxLayout(this);
     m_topLayout->setSpacing(0);
@@ -155,8 +161,8 @@ DolphinView::DolphinView(const QUrl& url, QWidget* parent) :
     connect(m_model, &KFileItemModel::directorySortingProgress,   this, &DolphinView::directorySortingProgress);
     connect(m_model, &KFileItemModel::itemsChanged,
             this, &DolphinView::slotItemsChanged);
-    connect(m_model, &KFileItemModel::itemsRemoved,    this, &DolphinView::itemCountChanged);
-    connect(m_model, &KFileItemModel::itemsInserted,   this, &DolphinView::itemCountChanged);
+    connect(m_model, &KFileItemModel::itemsRemoved,    this, &DolphinView::slotItemCountChanged);
+    connect(m_model, &KFileItemModel::itemsInserted,   this, &DolphinView::slotItemCountChanged);
     connect(m_model, &KFileItemModel::infoMessage,            this, &DolphinView::infoMessage);
     connect(m_model, &KFileItemModel::errorMessage,           this, &DolphinView::errorMessage);
     connect(m_model, &KFileItemModel::directoryRedirection, this, &DolphinView::slotDirectoryRedirection);
@@ -371,16 +377,31 @@ void DolphinView::selectItems(const QRegularExpression &regexp, bool enabled)
                                                         : KItemListSelectionManager::Deselect;
     KItemListSelectionManager* selectionManager = m_container->controller()->selectionManager();
 
-    for (int index = 0; index < m_model->count(); index++) {
-        const KFileItem item = m_model->fileItem(index);
-        if (regexp.match(item.text()).hasMatch()) {
-            // An alternative approach would be to store the matching items in a KItemSet and
-            // select them in one go after the loop, but we'd need a new function
-            // KItemListSelectionManager::setSelected(KItemSet, SelectionMode mode)
-            // for that.
-            selectionManager->setSelected(index, 1, mode);
+    // The texts are copied first, because the worker threads must not access the model.
+    const int count = m_model->count();
+    QVector<QString> texts(count);
+    for (int index = 0; index < count; ++index) {
+        texts[index] = m_model->fileItem(index).text();
+    }
+
+    QVector<bool> matches(count);
+    bool* matchesData = matches.data();
+    auto match = [&texts, matchesData, &regexp](int first, int last) {
+        for (int index = first; index <= last; ++index) {
+            matchesData[index] = regexp.match(texts.at(index)).hasMatch();
+        }
+    };
+
+    processInChunks(count, match);
+
+    KItemSet matchingItems;
+    for (int index = 0; index < count; ++index) {
+        if (matches.at(index)) {
+            matchingItems.insert(index);
         }
     }
+
+    selectionManager->setSelected(matchingItems, mode);
 }
 
 void DolphinView::setZoomLevel(int level)
@@ -1518,29 +1539,48 @@ void DolphinView::calculateItemCount(int& fileCount,
                                      int& folderCount,
                                      KIO::filesize_t& totalFileSize) const
 {
-    const int itemCount = m_model->count();
-
-    bool countFileSize = true;
+    fileCount = m_model->fileCount();
+    folderCount = m_model->folderCount();
 
     // In case we have a precomputed value
-    const auto job = KIO::statDetails(m_model->rootItem().url(), KIO::StatJob::SourceSide, KIO::StatRecursiveSize);
-    job->exec();
-    const auto entry =  job->statResult();
-    if (entry.contains(KIO::UDSEntry::UDS_RECURSIVE_SIZE)) {
-        totalFileSize = static_cast<KIO::filesize_t>(entry.numberValue(KIO::UDSEntry::UDS_RECURSIVE_SIZE));
-        countFileSize = false;
+    totalFileSize = m_recursiveSizeKnown ? m_recursiveSize : m_model->totalFileSize();
+}
+
+void DolphinView::updateRecursiveSize()
+{
+    if (m_recursiveSizeJob) {
+        m_recursiveSizeOutdated = true;
+        return;
     }
 
-    for (int i = 0; i < itemCount; ++i) {
-        const KFileItem item = m_model->fileItem(i);
-        if (item.isDir()) {
-            ++folderCount;
-        } else {
-            ++fileCount;
-            if (countFileSize) {
-                totalFileSize += item.size();
-            }
-        }
+    const QUrl url = m_model->rootItem().url();
+    if (!url.isValid()) {
+        return;
+    }
+
+    m_recursiveSizeOutdated = false;
+    m_recursiveSizeJob = KIO::statDetails(url, KIO::StatJob::SourceSide, KIO::StatRecursiveSize, KIO::HideProgressInfo);
+    connect(m_recursiveSizeJob, &KJob::result, this, &DolphinView::slotRecursiveSizeJobResult);
+}
+
+void DolphinView::slotRecursiveSizeJobResult(KJob* job)
+{
+    Q_ASSERT(job == m_recursiveSizeJob);
+    m_recursiveSizeJob = nullptr;
+
+    const bool wasKnown = m_recursiveSizeKnown;
+    const KIO::filesize_t previousSize = m_recursiveSize;
+
+    const KIO::UDSEntry entry = static_cast<KIO::StatJob*>(job)->statResult();
+    m_recursiveSizeKnown = !job->error() && entry.contains(KIO::UDSEntry::UDS_RECURSIVE_SIZE);
+    m_recursiveSize = m_recursiveSizeKnown ? static_cast<KIO::filesize_t>(entry.numberValue(KIO::UDSEntry::UDS_RECURSIVE_SIZE)) : 0;
+
+    if (wasKnown != m_recursiveSizeKnown || previousSize != m_recursiveSize) {
+        emit statusBarTextChanged();
+    }
+
+    if (m_recursiveSizeOutdated && m_recursiveSizeKnown) {
+        updateRecursiveSize();
     }
 }
 
@@ -1596,6 +1636,15 @@ void DolphinView::slotRenamingResult(KJob* job)
 
 void DolphinView::slotDirectoryLoadingStarted()
 {
+    // The recursive size of the previous folder is not valid anymore
+    if (m_recursiveSizeJob) {
+        m_recursiveSizeJob->kill();
+        m_recursiveSizeJob = nullptr;
+    }
+    m_recursiveSizeOutdated = false;
+    m_recursiveSizeKnown = false;
+    m_recursiveSize = 0;
+
     // Disable the writestate temporary until it can be determined in a fast way
     // in DolphinView::slotDirectoryLoadingCompleted()
     if (m_isFolderWritable) {
@@ -1615,6 +1664,7 @@ void DolphinView::slotDirectoryLoadingCompleted()
     emit directoryLoadingCompleted();
 
     updateWritableState();
+    updateRecursiveSize();
 }
 
 void DolphinView::slotItemsChanged()
@@ -1622,6 +1672,17 @@ void DolphinView::slotItemsChanged()
     m_assureVisibleCurrentIndex = false;
 }
 
+void DolphinView::slotItemCountChanged()
+{
+    // Only KIO-slaves which have provided a recursive size before are asked
+    // again, so that no stat job is started for each change of most folders.
+    if (m_recursiveSizeKnown) {
+        updateRecursiveSize();
+    }
+
+    emit itemCountChanged();
+}
+
 void DolphinView::slotSortOrderChangedByHeader(Qt::SortOrder current, Qt::SortOrder previous)
 {
     Q_UNUSED(previous)
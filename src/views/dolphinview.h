@@ -254,6 +254,9 @@ public:
     /**
      * Returns a textual representation of the state of the current
      * folder or selected items, suitable for use in the status bar.
+     * If the folder is not selected, the text is built from counters
+     * that are maintained incrementally and does not block. The signal
+     * statusBarTextChanged() indicates that the text should be updated.
      */
     QString statusBarText() const;
 
@@ -437,6 +440,13 @@ signals:
      */
     void itemCountChanged();
 
+    /**
+     * Is emitted if the information provided by statusBarText() has
+     * changed without a change of the items, e.g. if the recursive
+     * size of the folder has been determined asynchronously.
+     */
+    void statusBarTextChanged();
+
     /**
      * Is emitted if a new tab should be opened for the URL \a url.
      */
@@ -696,6 +706,19 @@ private slots:
      */
     void slotItemsChanged();
 
+    /**
+     * Is invoked when items of KFileItemModel have been inserted or removed.
+     * Emits itemCountChanged() and requests an update of the recursive size
+     * of the folder if it is provided by the KIO-slave.
+     */
+    void slotItemCountChanged();
+
+    /**
+     * Is invoked when the stat job started by updateRecursiveSize()
+     * has been finished.
+     */
+    void slotRecursiveSizeJobResult(KJob* job);
+
     /**
      * Is invoked when the sort order has been changed by the user by clicking
      * on a header item. The view properties of the directory will get updated.
@@ -738,9 +761,18 @@ private slots:
      * It is recommend using this method instead of asking the
      * directory lister or the model directly, as it takes
      * filtering and hierarchical previews into account.
+     * The runtime complexity is O(1).
      */
     void calculateItemCount(int& fileCount, int& folderCount, KIO::filesize_t& totalFileSize) const;
 
+    /**
+     * Starts an asynchronous stat job that determines the recursive size
+     * of the current folder (UDS_RECURSIVE_SIZE). Only some KIO-slaves
+     * provide this information. If a job is running already, a new job
+     * is started as soon as the running job has been finished.
+     */
+    void updateRecursiveSize();
+
     void slotTwoClicksRenamingTimerTimeout();
 
 private:
@@ -845,6 +877,12 @@ private:
     QTimer* m_twoClicksRenamingTimer;
     QUrl m_twoClicksRenamingItemUrl;
 
+    // Recursive size of the folder as provided by the KIO-slave, see updateRecursiveSize()
+    KIO::StatJob* m_recursiveSizeJob;
+    bool m_recursiveSizeOutdated;
+    bool m_recursiveSizeKnown;
+    KIO::filesize_t m_recursiveSize;
+
     // For unit tests
     friend class TestBase;
     friend class DolphinDetailsViewTest;
@@ -20,6 +20,7 @@
 #include "tooltipmanager.h"
 
 #include "dolphinfilemetadatawidget.h"
+#include "kitemviews/private/kthumbnailcache.h"
 
 #include <KIO/JobUiDelegate>
 #include <KIO/PreviewJob>
@@ -146,14 +147,25 @@ void ToolTipManager::startContentRetrieval()
     m_fileMetaDataWidget->setPreview(QPixmap());
 
     QStringList plugins = KIO::PreviewJob::availablePlugins();
+    const QSize previewSize(256, 256);
+    const QPixmap cachedPreview = KThumbnailCache::instance()->pixmap(m_item, previewSize, plugins);
+    if (!cachedPreview.isNull()) {
+        setPreviewPix(m_item, cachedPreview);
+        return;
+    }
+
     KIO::PreviewJob* job = new KIO::PreviewJob(KFileItemList() << m_item,
-                                               QSize(256, 256),
+                                               previewSize,
                                                &plugins);
     job->setIgnoreMaximumSize(m_item.isLocalFile());
     if (job->uiDelegate()) {
         KJobWidgets::setWindow(job, qApp->activeWindow());
     }
 
+    connect(job, &KIO::PreviewJob::gotPreview,
+            this, [previewSize, plugins](const KFileItem& item, const QPixmap& pixmap) {
+        KThumbnailCache::instance()->insert(item, previewSize, plugins, pixmap);
+    });
     connect(job, &KIO::PreviewJob::gotPreview,
             this, &ToolTipManager::setPreviewPix);
     connect(job, &KIO::PreviewJob::failed,